@@ -16,7 +16,10 @@ layout(binding = 3) uniform sampler2D metalRoughSampler;
 
 void main()
 {
-    vec3 normalMap = texture(normalSampler, fragTexCoord).xyz * 2.0 - 1.0;
+    // Only x and y are stored when the texture is BC5 compressed, z of a unit tangent space normal is never negative
+    vec3 normalMap;
+    normalMap.xy = texture(normalSampler, fragTexCoord).xy * 2.0 - 1.0;
+    normalMap.z = sqrt(max(1.0 - dot(normalMap.xy, normalMap.xy), 0.0));
 
     vec3 T = normalize(fragTangent);
     vec3 N = normalize(fragNormal);
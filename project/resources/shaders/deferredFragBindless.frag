@@ -0,0 +1,38 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragTangent;
+layout(location = 3) in vec3 fragBitangent;
+layout(location = 4) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out vec4 outMetalRough;
+
+// Every material texture, the draw's own are picked by the indices pushed with it
+layout(set = 1, binding = 0) uniform sampler2D materialTextures[];
+
+layout(push_constant) uniform PushConstants {
+    layout(offset = 32) uvec4 material;
+} pushConstants;
+
+void main()
+{
+    // Only x and y are stored when the texture is BC5 compressed, z of a unit tangent space normal is never negative
+    vec3 normalMap;
+    normalMap.xy = texture(materialTextures[pushConstants.material.y], fragTexCoord).xy * 2.0 - 1.0;
+    normalMap.z = sqrt(max(1.0 - dot(normalMap.xy, normalMap.xy), 0.0));
+
+    vec3 T = normalize(fragTangent);
+    vec3 N = normalize(fragNormal);
+    vec3 B = normalize(fragBitangent);
+
+    mat3 TBN = mat3(T, B, N);
+    vec3 worldNormal = normalize(TBN * normalMap);
+
+    outNormal = vec4(worldNormal * 0.5 + 0.5, 1.0);
+    outAlbedo = texture(materialTextures[pushConstants.material.x], fragTexCoord);
+    outMetalRough = texture(materialTextures[pushConstants.material.z], fragTexCoord);
+}
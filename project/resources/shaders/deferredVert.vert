@@ -13,6 +13,9 @@ layout(location = 2) in vec4 inTangent;
 layout(location = 3) in vec3 inColor;
 layout(location = 4) in vec2 inTexCoord;
 
+// Per-instance node transform
+layout(location = 5) in mat4 inInstanceModel;
+
 layout(location = 0) out vec3 fragPosition;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec3 fragTangent;
@@ -21,8 +24,9 @@ layout(location = 4) out vec2 fragTexCoord;
 
 void main()
 {
-    fragPosition = vec3(ubo.model * vec4(inPosition, 1.0));
-    mat3 normalMatrix = transpose(inverse(mat3(ubo.model)));
+    mat4 model = ubo.model * inInstanceModel;
+    fragPosition = vec3(model * vec4(inPosition, 1.0));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
     fragNormal = normalize(normalMatrix * inNormal);
     fragTangent = normalize(normalMatrix * inTangent.xyz);
     fragBitangent = normalize(cross(fragNormal, fragTangent) * inTangent.w);
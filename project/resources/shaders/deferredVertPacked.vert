@@ -0,0 +1,46 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// PackedPosition and PackedAttributes, positions are within the mesh's bounding cube and the instance transform maps them back
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTangent;
+layout(location = 4) in vec2 inTexCoord;
+
+// Per-instance node transform times the mesh's dequantization
+layout(location = 5) in mat4 inInstanceModel;
+
+layout(location = 0) out vec3 fragPosition;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragTangent;
+layout(location = 3) out vec3 fragBitangent;
+layout(location = 4) out vec2 fragTexCoord;
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 v = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -fold : fold;
+    v.y += v.y >= 0.0 ? -fold : fold;
+    return normalize(v);
+}
+
+void main()
+{
+    mat4 model = ubo.model * inInstanceModel;
+    fragPosition = vec3(model * vec4(inPosition.xyz, 1.0));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    fragNormal = normalize(normalMatrix * DecodeOctahedral(inNormal));
+    fragTangent = normalize(normalMatrix * DecodeOctahedral(inTangent));
+    // The sign is stored as 0 or 1 in the position's w
+    float tangentSign = inPosition.w * 2.0 - 1.0;
+    fragBitangent = normalize(cross(fragNormal, fragTangent) * tangentSign);
+    fragTexCoord = inTexCoord;
+    gl_Position = ubo.proj * ubo.view * vec4(fragPosition, 1.0);
+}
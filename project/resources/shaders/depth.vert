@@ -2,6 +2,9 @@
 
 layout(location = 0) in vec3 inPosition;
 
+// Per-instance node transform
+layout(location = 5) in mat4 inInstanceModel;
+
 layout(set = 0, binding = 0) uniform UniformBufferObject
 {
     mat4 model;
@@ -11,5 +14,5 @@ layout(set = 0, binding = 0) uniform UniformBufferObject
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * ubo.model * inInstanceModel * vec4(inPosition, 1.0);
 }
\ No newline at end of file
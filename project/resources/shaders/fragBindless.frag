@@ -0,0 +1,23 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// Every material texture, the draw's own are picked by the indices pushed with it
+layout(set = 1, binding = 0) uniform sampler2D materialTextures[];
+
+layout(push_constant) uniform PushConstants {
+    layout(offset = 32) uvec4 material;
+} pushConstants;
+
+void main()
+{
+    vec4 texColor = texture(materialTextures[pushConstants.material.x], fragTexCoord);
+
+    if (texColor.a < 0.5)
+        discard;
+
+    outColor = texColor;
+}
@@ -13,10 +13,13 @@ layout(location = 2) in vec4 inTangent;
 layout(location = 3) in vec3 inColor;
 layout(location = 4) in vec2 inTexCoord;
 
+// Per-instance node transform
+layout(location = 5) in mat4 inInstanceModel;
+
 layout(location = 0) out vec2 fragTexCoord;
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * ubo.model * inInstanceModel * vec4(inPosition, 1.0);
     fragTexCoord = inTexCoord;
 }
@@ -0,0 +1,23 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// PackedPosition within the mesh's bounding cube, the instance transform maps it back
+layout(location = 0) in vec4 inPosition;
+layout(location = 4) in vec2 inTexCoord;
+
+// Per-instance node transform times the mesh's dequantization
+layout(location = 5) in mat4 inInstanceModel;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main()
+{
+    gl_Position = ubo.proj * ubo.view * ubo.model * inInstanceModel * vec4(inPosition.xyz, 1.0);
+    fragTexCoord = inTexCoord;
+}
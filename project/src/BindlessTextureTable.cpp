@@ -0,0 +1,121 @@
+#include "BindlessTextureTable.h"
+#include "LogicalDevice.h"
+#include "Texture.h"
+#include <stdexcept>
+
+BindlessTextureTable::BindlessTextureTable(LogicalDevice* pDevice, uint32_t capacity)
+	: m_pDevice{ pDevice }
+	, m_Capacity{ capacity }
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = m_Capacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// Slots that were never written are fine as long as no draw indexes them
+	const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(m_pDevice->GetVkDevice(), &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = m_Capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(m_pDevice->GetVkDevice(), &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_DescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(m_pDevice->GetVkDevice(), &allocInfo, &m_DescriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate bindless descriptor set!");
+	}
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+	// Frees the set with it
+	vkDestroyDescriptorPool(m_pDevice->GetVkDevice(), m_DescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_pDevice->GetVkDevice(), m_DescriptorSetLayout, nullptr);
+}
+
+void BindlessTextureTable::Add(Texture* pTexture)
+{
+	uint32_t index = 0;
+
+	if (!m_FreeIndices.empty())
+	{
+		index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else if (m_NextIndex < m_Capacity)
+	{
+		index = m_NextIndex++;
+	}
+	else
+	{
+		throw std::runtime_error("bindless texture table is full!");
+	}
+
+	pTexture->SetBindlessIndex(index);
+	Write(index, pTexture);
+}
+
+void BindlessTextureTable::Update(Texture* pTexture)
+{
+	Write(pTexture->GetBindlessIndex(), pTexture);
+}
+
+void BindlessTextureTable::Remove(Texture* pTexture)
+{
+	m_FreeIndices.push_back(pTexture->GetBindlessIndex());
+	pTexture->SetBindlessIndex(Texture::m_InvalidBindlessIndex);
+}
+
+void BindlessTextureTable::Write(uint32_t index, Texture* pTexture)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = *pTexture->GetImageView();
+	imageInfo.sampler = *pTexture->GetSampler();
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_DescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_pDevice->GetVkDevice(), 1, &descriptorWrite, 0, nullptr);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+class LogicalDevice;
+class Texture;
+
+// Every material texture in one runtime sized sampler2D array, a single set bound once per frame
+// Slots are written while the set is bound, frames in flight never read a slot that is added or rewritten
+class BindlessTextureTable
+{
+public:
+	BindlessTextureTable(LogicalDevice* pDevice, uint32_t capacity);
+	~BindlessTextureTable();
+
+	BindlessTextureTable(const BindlessTextureTable&) = delete;
+	BindlessTextureTable(BindlessTextureTable&&) noexcept = delete;
+	BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+	BindlessTextureTable& operator=(BindlessTextureTable&&) noexcept = delete;
+
+	VkDescriptorSetLayout* GetDescriptorSetLayout() { return &m_DescriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+
+	// Writes the texture into a free slot and stores the slot on it
+	void Add(Texture* pTexture);
+	// Rewrites the texture's slot, e.g. after its sampler changed, no frame in flight may use it
+	void Update(Texture* pTexture);
+	// Frees the texture's slot for reuse, no frame in flight may use it
+	void Remove(Texture* pTexture);
+
+	uint32_t GetCapacity() const { return m_Capacity; }
+	uint32_t GetCount() const { return m_NextIndex - static_cast<uint32_t>(m_FreeIndices.size()); }
+
+private:
+	LogicalDevice* m_pDevice;
+	uint32_t m_Capacity;
+
+	VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+
+	// Slots below m_NextIndex have been handed out, released ones are reused first
+	uint32_t m_NextIndex = 0;
+	std::vector<uint32_t> m_FreeIndices;
+
+	void Write(uint32_t index, Texture* pTexture);
+};
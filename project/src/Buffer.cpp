@@ -1,7 +1,6 @@
 #include "Buffer.h"
 #include "LogicalDevice.h"
-#include "PhysicalDevice.h"
-#include "CommandBuffers.h"
+#include "UploadContext.h"
 #include "Model.h"
 #include <stdexcept>
 
@@ -10,25 +9,10 @@ Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlag
 	, m_Usage(usage)
 	, m_Properties(properties)
 	, m_Buffer(VK_NULL_HANDLE)
-	, m_Memory(VK_NULL_HANDLE)
 	, m_pDevice(pDevice)
 	, m_pCommandPool(pCommandPool)
 {
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(m_pDevice, m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, 0, m_Size, 0, &data);
-	memcpy(data, pData, (size_t)m_Size);
-	vkUnmapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory);
-
-	CreateBuffer(m_pDevice, m_Size, m_Usage, m_Properties, m_Buffer, m_Memory);
-
-	CopyBuffer(stagingBuffer, m_Size);
-
-	vkDestroyBuffer(m_pDevice->GetVkDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, nullptr);
+	CreateStagedBuffer(pData);
 }
 
 Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const Vertex* pData, LogicalDevice* pDevice, CommandPool* pCommandPool)
@@ -36,25 +20,21 @@ Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlag
 	, m_Usage(usage)
 	, m_Properties(properties)
 	, m_Buffer(VK_NULL_HANDLE)
-	, m_Memory(VK_NULL_HANDLE)
 	, m_pDevice(pDevice)
 	, m_pCommandPool(pCommandPool)
 {
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(m_pDevice, m_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, 0, m_Size, 0, &data);
-	memcpy(data, pData, (size_t)m_Size);
-	vkUnmapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory);
-
-	CreateBuffer(m_pDevice, m_Size, m_Usage, m_Properties, m_Buffer, m_Memory);
-
-	CopyBuffer(stagingBuffer, m_Size);
+	CreateStagedBuffer(pData);
+}
 
-	vkDestroyBuffer(m_pDevice->GetVkDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, nullptr);
+Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const InstanceData* pData, LogicalDevice* pDevice, CommandPool* pCommandPool)
+	: m_Size(size)
+	, m_Usage(usage)
+	, m_Properties(properties)
+	, m_Buffer(VK_NULL_HANDLE)
+	, m_pDevice(pDevice)
+	, m_pCommandPool(pCommandPool)
+{
+	CreateStagedBuffer(pData);
 }
 
 Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, LogicalDevice* pDevice, CommandPool* pCommandPool, void** uniformBufferMapped)
@@ -62,13 +42,24 @@ Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlag
 	, m_Usage(usage)
 	, m_Properties(properties)
 	, m_Buffer(VK_NULL_HANDLE)
-	, m_Memory(VK_NULL_HANDLE)
 	, m_pDevice(pDevice)
 	, m_pCommandPool(pCommandPool)
 {
-	Buffer::CreateBuffer(m_pDevice, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Memory);
+	Buffer::CreateBuffer(m_pDevice, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Allocation, MemoryCategory::Uniform);
+
+	// The block it lives in stays mapped
+	*uniformBufferMapped = m_Allocation.pMapped;
+}
 
-	vkMapMemory(m_pDevice->GetVkDevice(), m_Memory, 0, size, 0, uniformBufferMapped);
+Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, LogicalDevice* pDevice, CommandPool* pCommandPool)
+	: m_Size(size)
+	, m_Usage(usage)
+	, m_Properties(properties)
+	, m_Buffer(VK_NULL_HANDLE)
+	, m_pDevice(pDevice)
+	, m_pCommandPool(pCommandPool)
+{
+	CreateBuffer(m_pDevice, m_Size, m_Usage, m_Properties, m_Buffer, m_Allocation, MemoryCategory::Geometry);
 }
 
 Buffer::~Buffer()
@@ -77,64 +68,75 @@ Buffer::~Buffer()
 	{
 		vkDestroyBuffer(m_pDevice->GetVkDevice(), m_Buffer, nullptr);
 	}
-	if (m_Memory != VK_NULL_HANDLE)
-	{
-		vkFreeMemory(m_pDevice->GetVkDevice(), m_Memory, nullptr);
-	}
+	m_pDevice->GetMemoryAllocator()->Free(m_Allocation);
 }
 
-void Buffer::CopyBuffer(VkBuffer srcBuffer, VkDeviceSize size)
+void Buffer::CreateStagedBuffer(const void* pData)
 {
-	VkCommandBuffer commandBuffer = CommandBuffers::BeginSingleTimeCommands(m_pDevice, m_pCommandPool);
-
-	VkBufferCopy copyRegion{};
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, m_Buffer, 1, &copyRegion);
+	CreateBuffer(m_pDevice, m_Size, m_Usage, m_Properties, m_Buffer, m_Allocation, MemoryCategory::Geometry);
 
-	CommandBuffers::EndSingleTimeCommands(m_pDevice, m_pCommandPool, commandBuffer);
+	Upload(pData, m_Size, 0);
 }
 
-void Buffer::CreateBuffer(LogicalDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void Buffer::Upload(const void* pData, VkDeviceSize size, VkDeviceSize offset, UploadContext* pUploadContext)
 {
-	VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = size;
-	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (size == 0)
+	{
+		return;
+	}
 
-	if (vkCreateBuffer(pDevice->GetVkDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+	if (offset + size > m_Size)
 	{
-		throw std::runtime_error("failed to create vertex buffer!");
+		throw std::runtime_error("buffer upload out of range!");
+	}
+
+	if (!pUploadContext)
+	{
+		pUploadContext = m_pDevice->GetUploadContext();
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(pDevice->GetVkDevice(), buffer, &memRequirements);
+	pUploadContext->UploadBuffer(m_Buffer, pData, size, offset);
+	pUploadContext->ReleaseBuffer(m_Buffer, offset, size);
+}
+
+void Buffer::UploadStaging(const UploadContext::Staging& staging, VkDeviceSize size, VkDeviceSize offset, UploadContext* pUploadContext)
+{
+	if (size == 0)
+	{
+		return;
+	}
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(pDevice, memRequirements.memoryTypeBits, properties);
+	if (offset + size > m_Size)
+	{
+		throw std::runtime_error("buffer upload out of range!");
+	}
 
-	if (vkAllocateMemory(pDevice->GetVkDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+	if (!pUploadContext)
 	{
-		throw std::runtime_error("failed to allocate vertex buffer memory!");
+		pUploadContext = m_pDevice->GetUploadContext();
 	}
 
-	vkBindBufferMemory(pDevice->GetVkDevice(), buffer, bufferMemory, 0);
+	pUploadContext->CopyStaging(staging, m_Buffer, size, offset);
+	pUploadContext->ReleaseBuffer(m_Buffer, offset, size);
+}
+
+void Buffer::CopyBuffer(VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	m_pDevice->GetUploadContext()->CopyBuffer(srcBuffer, m_Buffer, size, 0, dstOffset);
 }
 
-uint32_t Buffer::FindMemoryType(LogicalDevice* pDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+void Buffer::CreateBuffer(LogicalDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& allocation, MemoryCategory category)
 {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), &memProperties);
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+	if (vkCreateBuffer(pDevice->GetVkDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
 	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-		{
-			return i;
-		}
+		throw std::runtime_error("failed to create vertex buffer!");
 	}
 
-	throw std::runtime_error("failed to find suitable memory type!");
+	allocation = pDevice->GetMemoryAllocator()->AllocateForBuffer(buffer, properties, category);
 }
\ No newline at end of file
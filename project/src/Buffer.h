@@ -1,6 +1,8 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include "Structs.h"
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
 
 class LogicalDevice;
 class CommandPool;
@@ -11,21 +13,36 @@ class Buffer
 public:
 	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const uint32_t* data, LogicalDevice* pDevice, CommandPool* pCommandPool);
 	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const Vertex* data, LogicalDevice* pDevice, CommandPool* pCommandPool);
+	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const InstanceData* data, LogicalDevice* pDevice, CommandPool* pCommandPool);
 	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, LogicalDevice* pDevice, CommandPool* pCommandPool, void** uniformBufferMapped);
+	// Leaves the contents undefined, fill it with Upload, usage needs VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	// Every buffer but the uniform ones holds geometry or instances
+	Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, LogicalDevice* pDevice, CommandPool* pCommandPool);
 	~Buffer();
 	VkBuffer& GetBuffer() { return m_Buffer; }
-	VkDeviceMemory& GetMemory() { return m_Memory; }
-	void CopyBuffer(VkBuffer srcBuffer, VkDeviceSize size);
+	const MemoryAllocation& GetAllocation() const { return m_Allocation; }
+	VkDeviceSize GetSize() const { return m_Size; }
+	// Both record into the device's upload context and return without waiting
+	// Anything submitted to the graphics queue after its next flush sees the data, wait for its ticket to touch the old contents
+	void CopyBuffer(VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	// Writes size bytes at offset through the staging ring, pData may be freed when this returns
+	// Goes through pUploadContext instead when given, which releases the range to the graphics family if it runs on another one
+	void Upload(const void* pData, VkDeviceSize size, VkDeviceSize offset, UploadContext* pUploadContext = nullptr);
+	// Same as Upload from staging of pUploadContext the caller already wrote, skips copying the data into the ring
+	void UploadStaging(const UploadContext::Staging& staging, VkDeviceSize size, VkDeviceSize offset, UploadContext* pUploadContext = nullptr);
 
-	static void CreateBuffer(LogicalDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	static uint32_t FindMemoryType(LogicalDevice* pDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	// Binds the buffer to memory from the device's allocator, host visible memory comes mapped
+	static void CreateBuffer(LogicalDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& allocation, MemoryCategory category);
 
 private:
 	LogicalDevice* m_pDevice;
 	CommandPool* m_pCommandPool;
 	VkBuffer m_Buffer;
-	VkDeviceMemory m_Memory;
+	MemoryAllocation m_Allocation;
 	VkDeviceSize m_Size;
 	VkBufferUsageFlags m_Usage;
 	VkMemoryPropertyFlags m_Properties;
+
+	// Creates the buffer and fills it through the staging ring
+	void CreateStagedBuffer(const void* pData);
 };
\ No newline at end of file
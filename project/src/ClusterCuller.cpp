@@ -0,0 +1,177 @@
+#include "ClusterCuller.h"
+#include "Model.h"
+#include <algorithm>
+
+void ClusterCuller::Update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale)
+{
+	m_CameraPosition = cameraPosition;
+	m_ProjectionScale = projectionScale;
+
+	// Gribb/Hartmann plane extraction, glm is column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	auto row = [&viewProjection](int i)
+	{
+		return glm::vec4{ viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+	};
+
+	m_Planes[0] = row(3) + row(0); // Left
+	m_Planes[1] = row(3) - row(0); // Right
+	m_Planes[2] = row(3) + row(1); // Bottom
+	m_Planes[3] = row(3) - row(1); // Top
+	m_Planes[4] = row(2);          // Near, depth is [0, 1]
+	m_Planes[5] = row(3) - row(2); // Far
+
+	for (glm::vec4& plane : m_Planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+void ClusterCuller::AppendDraws(Model* pModel, std::vector<DrawCommand>& draws)
+{
+	const std::vector<Meshlet>& meshlets = pModel->GetMeshlets();
+
+	if (meshlets.empty() || pModel->GetLods().empty())
+	{
+		AppendFullDraw(pModel, draws);
+		return;
+	}
+
+	const std::vector<glm::mat4>& instances = pModel->GetInstances();
+
+	for (uint32_t instance{}; instance < instances.size(); ++instance)
+	{
+		const glm::mat4& transform = instances[instance];
+
+		// Bounds scale with the largest axis so non uniform scaling stays conservative for the sphere
+		const glm::vec3 axisLengths{ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) };
+		const float scale = std::max({ axisLengths.x, axisLengths.y, axisLengths.z });
+
+		// Non uniform scaling bends normals and widens or narrows the cone, it is only tested without it
+		const float minimumScale = std::min({ axisLengths.x, axisLengths.y, axisLengths.z });
+		const bool isTestingCone = scale - minimumScale <= scale * 1e-3f;
+
+		DrawCommand draw{ pModel, 0, 0, pModel->GetFirstInstance() + instance, 1 };
+
+		const MeshLod& lod = pModel->GetLods()[SelectLod(pModel, transform, scale)];
+
+		for (uint32_t m = lod.firstMeshlet; m < lod.firstMeshlet + lod.meshletCount; ++m)
+		{
+			const Meshlet& meshlet = meshlets[m];
+			++m_TestedMeshlets;
+
+			if (!IsVisible(meshlet, transform, scale, isTestingCone))
+			{
+				continue;
+			}
+
+			++m_VisibleMeshlets;
+
+			const uint32_t firstIndex = pModel->GetFirstIndex() + meshlet.firstIndex;
+
+			if (draw.indexCount > 0 && draw.firstIndex + draw.indexCount == firstIndex)
+			{
+				draw.indexCount += meshlet.indexCount;
+				continue;
+			}
+
+			if (draw.indexCount > 0)
+			{
+				AppendDraw(draw, draws);
+			}
+
+			draw.firstIndex = firstIndex;
+			draw.indexCount = meshlet.indexCount;
+		}
+
+		if (draw.indexCount > 0)
+		{
+			AppendDraw(draw, draws);
+		}
+	}
+}
+
+void ClusterCuller::AppendFullDraw(Model* pModel, std::vector<DrawCommand>& draws)
+{
+	const uint32_t indexCount = pModel->GetLods().empty() ? pModel->GetIndexCount() : pModel->GetLods()[0].indexCount;
+
+	AppendDraw({ pModel, pModel->GetFirstIndex(), indexCount, pModel->GetFirstInstance(), pModel->GetInstanceCount() }, draws);
+}
+
+uint32_t ClusterCuller::SelectLod(const Model* pModel, const glm::mat4& transform, float scale) const
+{
+	const std::vector<MeshLod>& lods = pModel->GetLods();
+
+	if (!m_IsSelectingLods || lods.size() < 2)
+	{
+		return 0;
+	}
+
+	const glm::vec4& sphere = pModel->GetBoundingSphere();
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+
+	// Distance to the nearest point of the bounds, inside them nothing may be simplified
+	const float distance = glm::length(center - m_CameraPosition) - sphere.w * scale;
+
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	const float pixelsPerUnit = m_ProjectionScale * scale / distance;
+
+	for (uint32_t level = static_cast<uint32_t>(lods.size()) - 1; level > 0; --level)
+	{
+		if (lods[level].error * pixelsPerUnit <= m_LodErrorThreshold)
+		{
+			return level;
+		}
+	}
+
+	return 0;
+}
+
+bool ClusterCuller::IsVisible(const Meshlet& meshlet, const glm::mat4& transform, float scale, bool isTestingCone) const
+{
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.center, 1.0f));
+	const float radius = meshlet.radius * scale;
+
+	for (const glm::vec4& plane : m_Planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+
+	if (!isTestingCone || meshlet.coneCutoff >= 1.0f)
+	{
+		return true;
+	}
+
+	// Back facing when the camera lies inside the negative cone, tested against the sphere so the apex is not needed
+	// Rotation and uniform scale only, so the axis transforms like any direction
+	const glm::vec3 axis = glm::normalize(glm::vec3(transform * glm::vec4(meshlet.coneAxis, 0.0f)));
+	const glm::vec3 toCenter = center - m_CameraPosition;
+
+	return glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + radius;
+}
+
+void ClusterCuller::AppendDraw(const DrawCommand& draw, std::vector<DrawCommand>& draws)
+{
+	m_SubmittedTriangles += static_cast<uint64_t>(draw.indexCount / 3) * draw.instanceCount;
+
+	// The same range on the next instance extends the previous draw instead of adding one
+	if (!draws.empty())
+	{
+		DrawCommand& last = draws.back();
+
+		if (last.pModel == draw.pModel && last.firstIndex == draw.firstIndex && last.indexCount == draw.indexCount
+			&& last.firstInstance + last.instanceCount == draw.firstInstance)
+		{
+			last.instanceCount += draw.instanceCount;
+			return;
+		}
+	}
+
+	draws.push_back(draw);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+class Model;
+
+// One vkCmdDrawIndexed, firstIndex is absolute in the shared index buffer
+struct DrawCommand
+{
+	Model* pModel;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+// Rejects meshlets that are outside the view frustum or face away from the camera
+class ClusterCuller
+{
+public:
+	// viewProjection must be the unflipped camera matrices, instance transforms are treated as world transforms
+	// projectionScale converts a size at distance 1 to pixels, projection[1][1] * viewport height / 2
+	void Update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float projectionScale);
+
+	// Coarsest level whose error stays below this many pixels on screen is drawn
+	void SetLodErrorThreshold(float pixels) { m_LodErrorThreshold = pixels; }
+	// When off every instance draws level 0
+	void SetLodSelection(bool isSelecting) { m_IsSelectingLods = isSelecting; }
+
+	// Appends the visible meshlets of every instance, neighbouring meshlets are merged into a single draw
+	void AppendDraws(Model* pModel, std::vector<DrawCommand>& draws);
+	// Draws level 0 of every instance in one command, for when culling is off
+	void AppendFullDraw(Model* pModel, std::vector<DrawCommand>& draws);
+
+	void ResetStats() { m_TestedMeshlets = 0; m_VisibleMeshlets = 0; m_SubmittedTriangles = 0; }
+	uint32_t GetTestedMeshletCount() const { return m_TestedMeshlets; }
+	uint32_t GetVisibleMeshletCount() const { return m_VisibleMeshlets; }
+	uint64_t GetSubmittedTriangleCount() const { return m_SubmittedTriangles; }
+
+private:
+	// xyz is the inward facing normal, w the distance
+	glm::vec4 m_Planes[6]{};
+	glm::vec3 m_CameraPosition{};
+	float m_ProjectionScale = 1.0f;
+	float m_LodErrorThreshold = 1.0f;
+	bool m_IsSelectingLods = true;
+
+	uint32_t m_TestedMeshlets = 0;
+	uint32_t m_VisibleMeshlets = 0;
+	uint64_t m_SubmittedTriangles = 0;
+
+	uint32_t SelectLod(const Model* pModel, const glm::mat4& transform, float scale) const;
+	bool IsVisible(const Meshlet& meshlet, const glm::mat4& transform, float scale, bool isTestingCone) const;
+	void AppendDraw(const DrawCommand& draw, std::vector<DrawCommand>& draws);
+};
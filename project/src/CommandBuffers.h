@@ -13,9 +13,6 @@ public:
 	CommandPool* GetCommandPool() const { return m_pCommandPool; }
 	std::vector<VkCommandBuffer>& GetCommandBuffers() { return m_CommandBuffers; }
 
-	static VkCommandBuffer BeginSingleTimeCommands(LogicalDevice* pDevice, CommandPool* pCommandPool);
-	static void EndSingleTimeCommands(LogicalDevice* pDevice, CommandPool* pCommandPool, VkCommandBuffer commandBuffer);
-
 private:
 	LogicalDevice* m_pDevice;
 	CommandPool* m_pCommandPool;
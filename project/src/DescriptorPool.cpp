@@ -11,7 +11,7 @@ DescriptorPool::DescriptorPool(int maxFramesInFlight, int modelCount, LogicalDev
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = static_cast<uint32_t>(setCount);
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(setCount);
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(setCount * m_SamplersPerSet);
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1,5 +1,6 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <cstdint>
 
 class LogicalDevice;
 
@@ -13,4 +14,7 @@ public:
 private:
 	VkDescriptorPool m_DescriptorPool;
 	LogicalDevice* m_pDevice;
+
+	// Three material textures and the three G-buffer images
+	static const uint32_t m_SamplersPerSet = 6;
 };
\ No newline at end of file
@@ -7,6 +7,11 @@
 #include <array>
 
 DescriptorSets::DescriptorSets(int maxFramesInFlight, LogicalDevice* pDevice, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorPool* descriptorPool, std::vector<Buffer*> uniformBuffers, Model* pModel, Texture* pAlbedoImage, Texture* pNormalImage, Texture* pMetalRoughImage)
+	: DescriptorSets(maxFramesInFlight, pDevice, descriptorSetLayout, descriptorPool, uniformBuffers, pModel->GetDiffuseTexture(), pModel->GetNormalTexture(), pModel->GetMetalRoughTexture(), pAlbedoImage, pNormalImage, pMetalRoughImage)
+{
+}
+
+DescriptorSets::DescriptorSets(int maxFramesInFlight, LogicalDevice* pDevice, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorPool* descriptorPool, std::vector<Buffer*> uniformBuffers, Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough, Texture* pAlbedoImage, Texture* pNormalImage, Texture* pMetalRoughImage)
 	: m_pDevice(pDevice)
 {
     std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, *descriptorSetLayout);
@@ -31,18 +36,18 @@ DescriptorSets::DescriptorSets(int maxFramesInFlight, LogicalDevice* pDevice, Vk
 
         VkDescriptorImageInfo imageInfo{};
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = *pModel->GetDiffuseTexture()->GetImageView();
-		imageInfo.sampler = *pModel->GetDiffuseTexture()->GetSampler();
+		imageInfo.imageView = *pDiffuse->GetImageView();
+		imageInfo.sampler = *pDiffuse->GetSampler();
 
 		VkDescriptorImageInfo normalImageInfo{};
 		normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		normalImageInfo.imageView = *pModel->GetNormalTexture()->GetImageView();
-		normalImageInfo.sampler = *pModel->GetNormalTexture()->GetSampler();
+		normalImageInfo.imageView = *pNormal->GetImageView();
+		normalImageInfo.sampler = *pNormal->GetSampler();
 
 		VkDescriptorImageInfo metalRoughImageInfo{};
 		metalRoughImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		metalRoughImageInfo.imageView = *pModel->GetMetalRoughTexture()->GetImageView();
-		metalRoughImageInfo.sampler = *pModel->GetMetalRoughTexture()->GetSampler();
+		metalRoughImageInfo.imageView = *pMetalRough->GetImageView();
+		metalRoughImageInfo.sampler = *pMetalRough->GetSampler();
 
 		VkDescriptorImageInfo albedoInfo{};
 		albedoInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -173,3 +178,57 @@ void DescriptorSets::UpdateDescriptorSets(Texture* pAlbedoImage, Texture* pNorma
 		vkUpdateDescriptorSets(m_pDevice->GetVkDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 	}
 }
+
+void DescriptorSets::UpdateMaterial(Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough)
+{
+	for (size_t i{}; i < m_DescriptorSets.size(); ++i)
+	{
+		UpdateMaterial(i, pDiffuse, pNormal, pMetalRough);
+	}
+}
+
+void DescriptorSets::UpdateMaterial(size_t frame, Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough)
+{
+	VkDescriptorImageInfo diffuseInfo{};
+	diffuseInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	diffuseInfo.imageView = *pDiffuse->GetImageView();
+	diffuseInfo.sampler = *pDiffuse->GetSampler();
+
+	VkDescriptorImageInfo normalInfo{};
+	normalInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	normalInfo.imageView = *pNormal->GetImageView();
+	normalInfo.sampler = *pNormal->GetSampler();
+
+	VkDescriptorImageInfo metalRoughInfo{};
+	metalRoughInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	metalRoughInfo.imageView = *pMetalRough->GetImageView();
+	metalRoughInfo.sampler = *pMetalRough->GetSampler();
+
+	std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet = m_DescriptorSets[frame];
+	descriptorWrites[0].dstBinding = 1;
+	descriptorWrites[0].dstArrayElement = 0;
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[0].descriptorCount = 1;
+	descriptorWrites[0].pImageInfo = &diffuseInfo;
+
+	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet = m_DescriptorSets[frame];
+	descriptorWrites[1].dstBinding = 2;
+	descriptorWrites[1].dstArrayElement = 0;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[1].descriptorCount = 1;
+	descriptorWrites[1].pImageInfo = &normalInfo;
+
+	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet = m_DescriptorSets[frame];
+	descriptorWrites[2].dstBinding = 3;
+	descriptorWrites[2].dstArrayElement = 0;
+	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[2].descriptorCount = 1;
+	descriptorWrites[2].pImageInfo = &metalRoughInfo;
+
+	vkUpdateDescriptorSets(m_pDevice->GetVkDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -11,9 +11,15 @@ class DescriptorSets
 {
 public:
 	DescriptorSets(int maxFramesInFlight, LogicalDevice* pDevice, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorPool* descriptorPool, std::vector<Buffer*> uniformBuffers, Model* pModel, Texture* pAlbedoImage, Texture* pNormalImage, Texture* pPosImage);
+	// Material textures passed explicitly, e.g. placeholders while the model's own are still loading
+	DescriptorSets(int maxFramesInFlight, LogicalDevice* pDevice, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorPool* descriptorPool, std::vector<Buffer*> uniformBuffers, Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough, Texture* pAlbedoImage, Texture* pNormalImage, Texture* pMetalRoughImage);
 	~DescriptorSets();
 	std::vector<VkDescriptorSet>& GetDescriptorSets() { return m_DescriptorSets; }
 	void UpdateDescriptorSets(Texture* pAlbedoImage, Texture* pNormalImage, Texture* pMetalRoughImage);
+	// Rewrites the material bindings of every frame, none of the sets may be in use by a pending command buffer
+	void UpdateMaterial(Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough);
+	// Rewrites the material bindings of one frame's set only, whose command buffer must have finished
+	void UpdateMaterial(size_t frame, Texture* pDiffuse, Texture* pNormal, Texture* pMetalRough);
 
 private:
 	LogicalDevice* m_pDevice;
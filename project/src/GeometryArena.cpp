@@ -0,0 +1,397 @@
+#include "GeometryArena.h"
+#include "LogicalDevice.h"
+#include "Buffer.h"
+#include "Model.h"
+#include "UploadContext.h"
+#include "VertexPacker.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+GeometryArena::GeometryArena(LogicalDevice* pDevice, CommandPool* pCommandPool, uint32_t framesInFlight, VertexFormat vertexFormat)
+	: m_pDevice{ pDevice }
+	, m_pCommandPool{ pCommandPool }
+	, m_FramesInFlight{ framesInFlight }
+	, m_VertexFormat{ vertexFormat }
+	, m_PositionStride{ VertexStreams::GetPositionStride(vertexFormat) }
+	, m_AttributeStride{ VertexStreams::GetAttributeStride(vertexFormat) }
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+	for (Block* pBlock : m_pBlocks)
+	{
+		if (pBlock)
+		{
+			delete pBlock->pIndexBuffer;
+			delete pBlock->pAttributeBuffer;
+			delete pBlock->pPositionBuffer;
+			delete pBlock;
+		}
+	}
+}
+
+void GeometryArena::Add(const std::vector<Model*>& models, UploadContext* pUploadContext, const Vertex* pVertices, const uint32_t* pIndices)
+{
+	std::vector<StreamCopy> vertexCopies;
+	std::vector<StreamCopy> indexCopies;
+	vertexCopies.reserve(models.size());
+	indexCopies.reserve(models.size());
+
+	for (Model* pModel : models)
+	{
+		// Read before placing the model moves its offsets into the arena
+		const Vertex* pModelVertices = pVertices ? pVertices + pModel->GetVertexOffset() : pModel->GetVertices().data();
+		const uint32_t* pModelIndices = pIndices ? pIndices + pModel->GetFirstIndex() : pModel->GetIndices().data();
+
+		const uint32_t block = Place(pModel);
+
+		vertexCopies.push_back({ block, pModel->GetVertexOffset(), pModel->GetVertexCount(), pModelVertices, pModel });
+		indexCopies.push_back({ block, pModel->GetFirstIndex(), pModel->GetIndexCount(), pModelIndices, pModel });
+	}
+
+	UploadVertices(vertexCopies, pUploadContext);
+	UploadIndices(indexCopies, pUploadContext);
+}
+
+void GeometryArena::Remove(Model* pModel)
+{
+	const uint32_t block = pModel->GetGeometryBlock();
+
+	if (block == m_InvalidBlock)
+	{
+		return;
+	}
+
+	m_RetiredRanges.push_back({ block, pModel->GetVertexOffset(), pModel->GetVertexCount(), pModel->GetFirstIndex(), pModel->GetIndexCount(), m_FrameNumber });
+	pModel->SetGeometryBlock(m_InvalidBlock);
+}
+
+void GeometryArena::BeginFrame()
+{
+	++m_FrameNumber;
+
+	// Every frame that could have drawn the ranges has waited for its fence framesInFlight frames later
+	auto retiredEnd = std::remove_if(m_RetiredRanges.begin(), m_RetiredRanges.end(), [this](const RetiredRange& retired)
+	{
+		if (retired.frame + m_FramesInFlight > m_FrameNumber)
+		{
+			return false;
+		}
+
+		Block* pBlock = m_pBlocks[retired.block];
+		FreeRange(pBlock->freeVertices, retired.vertexOffset, retired.vertexCount);
+		FreeRange(pBlock->freeIndices, retired.firstIndex, retired.indexCount);
+		--pBlock->modelCount;
+
+		// The first block stays, models come and go from it the most
+		if (pBlock->modelCount == 0 && retired.block > 0)
+		{
+			delete pBlock->pIndexBuffer;
+			delete pBlock->pAttributeBuffer;
+			delete pBlock->pPositionBuffer;
+			delete pBlock;
+			m_pBlocks[retired.block] = nullptr;
+		}
+
+		return true;
+	});
+
+	m_RetiredRanges.erase(retiredEnd, m_RetiredRanges.end());
+}
+
+void GeometryArena::Bind(VkCommandBuffer commandBuffer, uint32_t block, bool positionsOnly) const
+{
+	const Block* pBlock = m_pBlocks[block];
+
+	VkBuffer positionBuffer = pBlock->pPositionBuffer->GetBuffer();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, VertexStreams::m_PositionBinding, 1, &positionBuffer, &offset);
+
+	if (!positionsOnly)
+	{
+		VkBuffer attributeBuffer = pBlock->pAttributeBuffer->GetBuffer();
+		vkCmdBindVertexBuffers(commandBuffer, VertexStreams::m_AttributeBinding, 1, &attributeBuffer, &offset);
+	}
+
+	vkCmdBindIndexBuffer(commandBuffer, pBlock->pIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryArena::PrintStats() const
+{
+	uint32_t blockCount = 0;
+	uint32_t modelCount = 0;
+	uint64_t vertexCapacity = 0;
+	uint64_t indexCapacity = 0;
+	uint64_t freeVertices = 0;
+	uint64_t freeIndices = 0;
+	uint32_t freeRangeCount = 0;
+
+	for (const Block* pBlock : m_pBlocks)
+	{
+		if (!pBlock)
+		{
+			continue;
+		}
+
+		++blockCount;
+		modelCount += pBlock->modelCount;
+		vertexCapacity += pBlock->vertexCapacity;
+		indexCapacity += pBlock->indexCapacity;
+		freeRangeCount += static_cast<uint32_t>(pBlock->freeVertices.size() + pBlock->freeIndices.size());
+
+		for (const auto& [offset, count] : pBlock->freeVertices)
+		{
+			freeVertices += count;
+		}
+
+		for (const auto& [offset, count] : pBlock->freeIndices)
+		{
+			freeIndices += count;
+		}
+	}
+
+	std::cout << "Geometry arena: " << m_PositionStride << " byte positions and " << m_AttributeStride << " byte attributes, " << modelCount << " models in " << blockCount << " blocks, "
+		<< vertexCapacity - freeVertices << " of " << vertexCapacity << " vertices and " << indexCapacity - freeIndices << " of " << indexCapacity << " indices used, "
+		<< freeRangeCount << " free ranges, " << m_RetiredRanges.size() << " ranges waiting for frames in flight\n";
+}
+
+uint32_t GeometryArena::Place(Model* pModel)
+{
+	const uint32_t vertexCount = pModel->GetVertexCount();
+	const uint32_t indexCount = pModel->GetIndexCount();
+
+	uint32_t vertexOffset = 0;
+	uint32_t firstIndex = 0;
+	uint32_t block = m_InvalidBlock;
+
+	for (uint32_t i{}; i < m_pBlocks.size() && block == m_InvalidBlock; ++i)
+	{
+		Block* pBlock = m_pBlocks[i];
+
+		if (!pBlock || !AllocateRange(pBlock->freeVertices, vertexCount, vertexOffset))
+		{
+			continue;
+		}
+
+		// Both ranges have to be in the same block
+		if (!AllocateRange(pBlock->freeIndices, indexCount, firstIndex))
+		{
+			FreeRange(pBlock->freeVertices, vertexOffset, vertexCount);
+			continue;
+		}
+
+		block = i;
+	}
+
+	// Grows by another block, what is already placed stays where it is
+	if (block == m_InvalidBlock)
+	{
+		block = CreateBlock(std::max(m_BlockVertexCount, vertexCount), std::max(m_BlockIndexCount, indexCount));
+
+		Block* pBlock = m_pBlocks[block];
+		AllocateRange(pBlock->freeVertices, vertexCount, vertexOffset);
+		AllocateRange(pBlock->freeIndices, indexCount, firstIndex);
+	}
+
+	++m_pBlocks[block]->modelCount;
+
+	pModel->SetGeometryBlock(block);
+	pModel->SetVertexOffset(vertexOffset);
+	pModel->SetFirstIndex(firstIndex);
+
+	return block;
+}
+
+uint32_t GeometryArena::CreateBlock(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	Block* pBlock = new Block{};
+	pBlock->vertexCapacity = vertexCapacity;
+	pBlock->indexCapacity = indexCapacity;
+	pBlock->freeVertices[0] = vertexCapacity;
+	pBlock->freeIndices[0] = indexCapacity;
+
+	pBlock->pPositionBuffer = new Buffer(m_PositionStride * static_cast<VkDeviceSize>(vertexCapacity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pDevice, m_pCommandPool);
+	pBlock->pAttributeBuffer = new Buffer(m_AttributeStride * static_cast<VkDeviceSize>(vertexCapacity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pDevice, m_pCommandPool);
+	pBlock->pIndexBuffer = new Buffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pDevice, m_pCommandPool);
+
+	// Reuses the slot of a destroyed block
+	auto it = std::find(m_pBlocks.begin(), m_pBlocks.end(), nullptr);
+
+	if (it != m_pBlocks.end())
+	{
+		*it = pBlock;
+		return static_cast<uint32_t>(it - m_pBlocks.begin());
+	}
+
+	m_pBlocks.push_back(pBlock);
+	return static_cast<uint32_t>(m_pBlocks.size() - 1);
+}
+
+bool GeometryArena::AllocateRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t count, uint32_t& offset)
+{
+	if (count == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	auto best = freeRanges.end();
+
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second >= count && (best == freeRanges.end() || it->second < best->second))
+		{
+			best = it;
+		}
+	}
+
+	if (best == freeRanges.end())
+	{
+		return false;
+	}
+
+	offset = best->first;
+	const uint32_t remaining = best->second - count;
+	freeRanges.erase(best);
+
+	if (remaining > 0)
+	{
+		freeRanges[offset + count] = remaining;
+	}
+
+	return true;
+}
+
+void GeometryArena::FreeRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto next = freeRanges.lower_bound(offset);
+
+	// Merges with the free range right behind it
+	if (next != freeRanges.end() && offset + count == next->first)
+	{
+		count += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// And with the one right before it
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += count;
+			return;
+		}
+	}
+
+	freeRanges[offset] = count;
+}
+
+void GeometryArena::SortCopies(std::vector<StreamCopy>& copies)
+{
+	std::sort(copies.begin(), copies.end(), [](const StreamCopy& a, const StreamCopy& b)
+	{
+		return a.block != b.block ? a.block < b.block : a.offset < b.offset;
+	});
+}
+
+size_t GeometryArena::FindRun(const std::vector<StreamCopy>& copies, size_t first, uint32_t& runCount)
+{
+	// Copies that continue each other in the same block go up as one
+	size_t last = first + 1;
+	runCount = copies[first].count;
+
+	while (last < copies.size() && copies[last].block == copies[first].block && copies[last].offset == copies[first].offset + runCount)
+	{
+		runCount += copies[last].count;
+		++last;
+	}
+
+	return last;
+}
+
+void GeometryArena::UploadVertices(std::vector<StreamCopy>& copies, UploadContext* pUploadContext)
+{
+	SortCopies(copies);
+
+	for (size_t first{}; first < copies.size();)
+	{
+		uint32_t runCount = 0;
+		const size_t last = FindRun(copies, first, runCount);
+
+		if (runCount == 0)
+		{
+			first = last;
+			continue;
+		}
+
+		// Both streams of the run are packed straight into one staging allocation, written completely before anything else allocates
+		const VkDeviceSize positionSize = static_cast<VkDeviceSize>(m_PositionStride) * runCount;
+		const VkDeviceSize attributeOffset = (positionSize + UploadContext::m_DefaultAlignment - 1) / UploadContext::m_DefaultAlignment * UploadContext::m_DefaultAlignment;
+		const VkDeviceSize attributeSize = static_cast<VkDeviceSize>(m_AttributeStride) * runCount;
+
+		const UploadContext::Staging positionStaging = pUploadContext->AllocateStaging(attributeOffset + attributeSize);
+		const UploadContext::Staging attributeStaging{ positionStaging.pData + attributeOffset, positionStaging.buffer, positionStaging.offset + attributeOffset };
+
+		size_t packedCount = 0;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			const StreamCopy& copy = copies[i];
+			const glm::vec4 dequantization = VertexPacker::Pack(m_VertexFormat, static_cast<const Vertex*>(copy.pData), copy.count,
+				positionStaging.pData + packedCount * m_PositionStride, attributeStaging.pData + packedCount * m_AttributeStride);
+
+			copy.pModel->SetDequantization(dequantization);
+			packedCount += copy.count;
+		}
+
+		Block* pBlock = m_pBlocks[copies[first].block];
+		const VkDeviceSize vertexOffset = copies[first].offset;
+		pBlock->pPositionBuffer->UploadStaging(positionStaging, positionSize, m_PositionStride * vertexOffset, pUploadContext);
+		pBlock->pAttributeBuffer->UploadStaging(attributeStaging, attributeSize, m_AttributeStride * vertexOffset, pUploadContext);
+
+		first = last;
+	}
+}
+
+void GeometryArena::UploadIndices(std::vector<StreamCopy>& copies, UploadContext* pUploadContext)
+{
+	SortCopies(copies);
+
+	for (size_t first{}; first < copies.size();)
+	{
+		uint32_t runCount = 0;
+		const size_t last = FindRun(copies, first, runCount);
+
+		if (runCount == 0)
+		{
+			first = last;
+			continue;
+		}
+
+		const VkDeviceSize size = sizeof(uint32_t) * static_cast<VkDeviceSize>(runCount);
+		const UploadContext::Staging staging = pUploadContext->AllocateStaging(size);
+		unsigned char* pDst = staging.pData;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			const size_t copySize = sizeof(uint32_t) * static_cast<size_t>(copies[i].count);
+			std::memcpy(pDst, copies[i].pData, copySize);
+			pDst += copySize;
+		}
+
+		Block* pBlock = m_pBlocks[copies[first].block];
+		pBlock->pIndexBuffer->UploadStaging(staging, size, sizeof(uint32_t) * static_cast<VkDeviceSize>(copies[first].offset), pUploadContext);
+
+		first = last;
+	}
+}
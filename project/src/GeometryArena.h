@@ -0,0 +1,112 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "Structs.h"
+#include <vector>
+#include <map>
+#include <cstdint>
+
+class LogicalDevice;
+class CommandPool;
+class Buffer;
+class Model;
+class UploadContext;
+
+// Device local vertex and index storage that models are added to and removed from while frames render
+// Every block holds a position, an attribute and an index buffer, a model's ranges are in a single block so a draw binds one set
+// A model's vertex offset and first index are relative to its block's buffers, more blocks are added when none has room
+class GeometryArena
+{
+public:
+	// Vertex streams hold the format's layout, models are packed into it as they are added
+	GeometryArena(LogicalDevice* pDevice, CommandPool* pCommandPool, uint32_t framesInFlight, VertexFormat vertexFormat);
+	// Nothing may draw from it anymore
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena(GeometryArena&&) noexcept = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+	GeometryArena& operator=(GeometryArena&&) noexcept = delete;
+
+	static const uint32_t m_InvalidBlock = UINT32_MAX;
+
+	// Places every model, sets its block, vertex offset, first index and dequantization and records the uploads into pUploadContext
+	// Streams are read from the models, or at each model's current offsets into pVertices and pIndices when given, e.g. a mapped mesh cache
+	// Neighbouring ranges of a block are packed into staging together, the data may be freed when this returns
+	void Add(const std::vector<Model*>& models, UploadContext* pUploadContext, const Vertex* pVertices = nullptr, const uint32_t* pIndices = nullptr);
+	// Stop drawing the model first, its ranges are reused once no frame in flight reads them anymore
+	void Remove(Model* pModel);
+	// Once per frame after waiting for its fence, frees what the frames in flight no longer read
+	void BeginFrame();
+
+	// Positions at binding 0, attributes at binding 2 unless positionsOnly and the indices of the block, the instance buffer stays bound at binding 1
+	void Bind(VkCommandBuffer commandBuffer, uint32_t block, bool positionsOnly = false) const;
+
+	VertexFormat GetVertexFormat() const { return m_VertexFormat; }
+
+	void PrintStats() const;
+
+private:
+	struct Block
+	{
+		Buffer* pPositionBuffer = nullptr;
+		Buffer* pAttributeBuffer = nullptr;
+		Buffer* pIndexBuffer = nullptr;
+		uint32_t vertexCapacity = 0;
+		uint32_t indexCapacity = 0;
+		// Offset to count, neighbours are merged
+		std::map<uint32_t, uint32_t> freeVertices;
+		std::map<uint32_t, uint32_t> freeIndices;
+		uint32_t modelCount = 0;
+	};
+
+	struct RetiredRange
+	{
+		uint32_t block;
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint64_t frame;
+	};
+
+	// One model's stream on its way to a range of a block, offset and count in elements of the stream
+	struct StreamCopy
+	{
+		uint32_t block;
+		uint32_t offset;
+		uint32_t count;
+		// Vertices or indices where the model's stream is read from
+		const void* pData;
+		Model* pModel;
+	};
+
+	// Meshes larger than this get a block of their own size
+	static const uint32_t m_BlockVertexCount = 1 << 19;
+	static const uint32_t m_BlockIndexCount = 1 << 21;
+
+	LogicalDevice* m_pDevice;
+	CommandPool* m_pCommandPool;
+	uint32_t m_FramesInFlight;
+	VertexFormat m_VertexFormat;
+	uint32_t m_PositionStride;
+	uint32_t m_AttributeStride;
+	uint64_t m_FrameNumber = 0;
+
+	// Blocks that emptied out are destroyed and leave a nullptr, so the indices models hold stay valid
+	std::vector<Block*> m_pBlocks;
+	std::vector<RetiredRange> m_RetiredRanges;
+
+	// Returns the block the model's ranges went to
+	uint32_t Place(Model* pModel);
+	uint32_t CreateBlock(uint32_t vertexCapacity, uint32_t indexCapacity);
+	// Best fit, count 0 always fits at offset 0
+	static bool AllocateRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t count, uint32_t& offset);
+	static void FreeRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t offset, uint32_t count);
+	// By block and offset, so ranges that continue each other are adjacent
+	static void SortCopies(std::vector<StreamCopy>& copies);
+	// End of the run of sorted copies starting at first and its element count
+	static size_t FindRun(const std::vector<StreamCopy>& copies, size_t first, uint32_t& runCount);
+	// Every run is packed or copied straight into staging, sources are only read once
+	void UploadVertices(std::vector<StreamCopy>& copies, UploadContext* pUploadContext);
+	void UploadIndices(std::vector<StreamCopy>& copies, UploadContext* pUploadContext);
+};
@@ -6,37 +6,40 @@
 #include <vector>
 #include <fstream>
 
-GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader, const char* fragShader, bool handlesDepth)
+GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, const char* fragShader, bool handlesDepth, VertexFormat vertexFormat)
     : m_pDevice{ pDevice }
     , m_VertexShaderModule{ VK_NULL_HANDLE }
     , m_FragmentShaderModule{ VK_NULL_HANDLE }
+    , m_VertexFormat{ vertexFormat }
     , m_pPipelineLayout{ nullptr }
 {
     CreateShaderModules(vertShader, fragShader);
-    CreatePipelineLayout(pDescriptorSetLayout);
+    CreatePipelineLayout(setLayouts);
     CreateGraphicsPipeline(renderPass);
 }
 
-GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader, const char* fragShader)
+GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, const char* fragShader, VertexFormat vertexFormat)
 	: m_pDevice{ pDevice }
 	, m_VertexShaderModule{ VK_NULL_HANDLE }
 	, m_FragmentShaderModule{ VK_NULL_HANDLE }
+	, m_VertexFormat{ vertexFormat }
 	, m_pPipelineLayout{ nullptr }
 {
 	bool isDepthOnly = (fragShader == nullptr || std::string(fragShader).empty());
     CreateShaderModules(vertShader, fragShader);
-    CreatePipelineLayout(pDescriptorSetLayout);
+    CreatePipelineLayout(setLayouts);
 	CreateGraphicsPipeline(renderPass, isDepthOnly);
 }
 
-GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader)
+GraphicsPipeline::GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, VertexFormat vertexFormat)
     : m_pDevice{ pDevice }
     , m_VertexShaderModule{ VK_NULL_HANDLE }
     , m_FragmentShaderModule{ VK_NULL_HANDLE }
+    , m_VertexFormat{ vertexFormat }
     , m_pPipelineLayout{ nullptr }
 {
     CreateShaderModules(vertShader);
-    CreatePipelineLayout(pDescriptorSetLayout);
+    CreatePipelineLayout(setLayouts);
     CreateGraphicsPipeline(renderPass, true);
 }
 
@@ -47,9 +50,9 @@ GraphicsPipeline::~GraphicsPipeline()
     Cleanup();
 }
 
-void GraphicsPipeline::CreatePipelineLayout(VkDescriptorSetLayout* pDescriptorSetLayout)
+void GraphicsPipeline::CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts)
 {
-	m_pPipelineLayout = new PipelineLayout(m_pDevice, pDescriptorSetLayout);
+	m_pPipelineLayout = new PipelineLayout(m_pDevice, setLayouts);
 }
 
 void GraphicsPipeline::CreateGraphicsPipeline(RenderPass* renderPass, bool isDepthOnly)
@@ -79,26 +82,10 @@ void GraphicsPipeline::CreateGraphicsPipeline(RenderPass* renderPass, bool isDep
         stageCount = 2;
 	}
 
-    auto bindingDescription = Vertex::GetBindingDescription();
-
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription; // Optional
-
-	// Fill with depth attributes if this is a depth-only pipeline
-    auto depthAttributeDescription = Vertex::GetDepthAttributeDescriptions();
-    auto attributeDescriptions = Vertex::GetAttributeDescriptions();
-
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(depthAttributeDescription.size());
-    vertexInputInfo.pVertexAttributeDescriptions = depthAttributeDescription.data(); // Optional
-
-	// Overwrite if this is not a depth-only pipeline
-    if (m_FragmentShaderModule != VK_NULL_HANDLE)
-    {
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data(); // Optional
-    }
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    FillVertexInput(vertexInputInfo, bindingDescriptions, attributeDescriptions);
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -241,26 +228,10 @@ void GraphicsPipeline::CreateGraphicsPipeline(RenderPass* renderPass)
         stageCount = 2;
     }
 
-    auto bindingDescription = Vertex::GetBindingDescription();
-
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription; // Optional
-
-    // Fill with depth attributes if this is a depth-only pipeline
-    auto attributeDescriptions = Vertex::GetDepthAttributeDescriptions();
-    auto attributeDescription = Vertex::GetAttributeDescriptions();
-
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data(); // Optional
-
-    // Overwrite if this is not a depth-only pipeline
-    if (m_FragmentShaderModule != VK_NULL_HANDLE)
-    {
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data(); // Optional
-    }
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    FillVertexInput(vertexInputInfo, bindingDescriptions, attributeDescriptions);
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -370,6 +341,27 @@ void GraphicsPipeline::CreateGraphicsPipeline(RenderPass* renderPass)
     m_VertexShaderModule = VK_NULL_HANDLE;
 }
 
+void GraphicsPipeline::FillVertexInput(VkPipelineVertexInputStateCreateInfo& vertexInputInfo, std::vector<VkVertexInputBindingDescription>& bindingDescriptions, std::vector<VkVertexInputAttributeDescription>& attributeDescriptions)
+{
+    // Binding 0 holds the positions, binding 1 a transform per instance and binding 2 the remaining vertex attributes
+    // Depth-only pipelines only read the position, so only its stream is fetched
+    const bool isDepthOnly = m_FragmentShaderModule == VK_NULL_HANDLE;
+
+    bindingDescriptions = VertexStreams::GetBindingDescriptions(m_VertexFormat, isDepthOnly);
+    bindingDescriptions.push_back(InstanceData::GetBindingDescription());
+
+    attributeDescriptions = VertexStreams::GetAttributeDescriptions(m_VertexFormat, isDepthOnly);
+
+    auto instanceAttributes = InstanceData::GetAttributeDescriptions();
+    attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+}
+
 std::vector<char> GraphicsPipeline::ReadFile(const std::string& filename)
 {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include "PipelineLayout.h"
+#include "Structs.h"
 #include <vector>
 #include <string>
 
@@ -10,9 +11,9 @@ class RenderPass;
 class GraphicsPipeline
 {
 public:
-	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader, const char* fragShader, bool handlesDepth);
-	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader, const char* fragShader);
-	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, VkDescriptorSetLayout* pDescriptorSetLayout, const char* vertShader);
+	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, const char* fragShader, bool handlesDepth, VertexFormat vertexFormat = VertexFormat::Full);
+	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, const char* fragShader, VertexFormat vertexFormat = VertexFormat::Full);
+	GraphicsPipeline(LogicalDevice* pDevice, RenderPass* renderPass, const std::vector<VkDescriptorSetLayout>& setLayouts, const char* vertShader, VertexFormat vertexFormat = VertexFormat::Full);
 	~GraphicsPipeline();
 	VkPipeline* GetGraphicsPipeline() { return &m_GraphicsPipeline; }
 	PipelineLayout* GetPipelineLayout() { return m_pPipelineLayout; }
@@ -23,10 +24,13 @@ private:
 	VkPipeline m_GraphicsPipeline;
 	VkShaderModule m_VertexShaderModule;
 	VkShaderModule m_FragmentShaderModule;
+	// Layout of the vertex streams, the vertex shader has to decode the same one
+	VertexFormat m_VertexFormat;
 
-	void CreatePipelineLayout(VkDescriptorSetLayout* pDescriptorSetLayout);
+	void CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts);
 	void CreateGraphicsPipeline(RenderPass* renderPass, bool isDepthOnly);
 	void CreateGraphicsPipeline(RenderPass* renderPass);
+	void FillVertexInput(VkPipelineVertexInputStateCreateInfo& vertexInputInfo, std::vector<VkVertexInputBindingDescription>& bindingDescriptions, std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
 	void CreateShaderModules(const char* vertexPath, const char* fragmentPath);
 	void CreateShaderModules(const char* vertexPath);
 	VkShaderModule CreateShaderModule(const std::vector<char>& code);
@@ -1,5 +1,6 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include "MemoryAllocator.h"
 
 class LogicalDevice;
 class CommandPool;
@@ -7,15 +8,16 @@ class CommandPool;
 class Image
 {
 public:
-	Image(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout);
+	Image(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout, MemoryCategory category);
 	Image() = default;
 	virtual ~Image();
 
 	virtual VkImage* GetImage() { return &m_Image; }
-	virtual VkDeviceMemory* GetImageMemory() { return &m_ImageMemory; }
+	virtual MemoryAllocation* GetAllocation() { return &m_Allocation; }
 	virtual VkImageView* GetImageView() { return &m_ImageView; }
 
 	virtual VkFormat* GetImageFormat() { return &m_ImageFormat; }
+	uint32_t GetMipLevels() const { return m_MipLevels; }
 
 	virtual void TransitionImageLayout(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 	virtual void TransitionImageLayout(VkCommandBuffer commandBuffer, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
@@ -24,11 +26,13 @@ protected:
 	LogicalDevice* m_pDevice;
 	CommandPool* m_pCommandPool;
 	VkImage m_Image;
-	VkDeviceMemory m_ImageMemory;
+	MemoryAllocation m_Allocation;
 	VkImageView m_ImageView;
 	VkFormat m_ImageFormat;
+	// Views and layout transitions always cover every level
+	uint32_t m_MipLevels = 1;
 
-	virtual void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	virtual VkImageView CreateImageView(VkFormat format, VkImageAspectFlags aspectFlags);
+	virtual void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& allocation, MemoryCategory category, uint32_t mipLevels = 1);
+	virtual VkImageView CreateImageView(VkFormat format, VkImageAspectFlags aspectFlags, const VkComponentMapping& components = {});
 	virtual bool HasStencilComponent(VkFormat format);
 };
\ No newline at end of file
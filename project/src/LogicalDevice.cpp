@@ -1,9 +1,14 @@
 #include "LogicalDevice.h"
 #include "PhysicalDevice.h"
 #include "Instance.h"
+#include "SamplerCache.h"
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
 #include "Structs.h"
 #include <vector>
 #include <set>
+#include <algorithm>
+#include <cstring>
 
 LogicalDevice::LogicalDevice(PhysicalDevice* pPhysicalDevice, Instance* pInstance)
 	: m_pPhysicalDevice{ pPhysicalDevice }
@@ -14,6 +19,10 @@ LogicalDevice::LogicalDevice(PhysicalDevice* pPhysicalDevice, Instance* pInstanc
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
+    m_GraphicsFamily = indices.graphicsFamily.value();
+    m_TransferFamily = indices.transferFamily.value_or(m_GraphicsFamily);
+    uniqueQueueFamilies.insert(m_TransferFamily);
+
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -32,11 +41,78 @@ LogicalDevice::LogicalDevice(PhysicalDevice* pPhysicalDevice, Instance* pInstanc
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(m_pPhysicalDevice->GetVkPhysicalDevice(), &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // Cooked textures are block compressed, without it they are uploaded as RGBA8
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    m_IsBcCompressionEnabled = supportedFeatures.textureCompressionBC == VK_TRUE;
     createInfo.pEnabledFeatures = &deviceFeatures;
 
+    // Bindless material textures, core since 1.2 so only queried on such devices
+    VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{};
+    supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_pPhysicalDevice->GetVkPhysicalDevice(), &properties);
+
+    if (properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &supportedIndexing;
+        vkGetPhysicalDeviceFeatures2(m_pPhysicalDevice->GetVkPhysicalDevice(), &features2);
+
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(m_pPhysicalDevice->GetVkPhysicalDevice(), &properties2);
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    // The shaders index the texture array with a push constant, a dynamically uniform but not constant index
+    m_IsDescriptorIndexingEnabled = supportedIndexing.runtimeDescriptorArray && supportedIndexing.descriptorBindingPartiallyBound
+        && supportedIndexing.descriptorBindingSampledImageUpdateAfterBind && supportedIndexing.descriptorBindingUpdateUnusedWhilePending
+        && supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+    if (m_IsDescriptorIndexingEnabled)
+    {
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        createInfo.pNext = &indexingFeatures;
+
+        // Combined image samplers count against both limits
+        m_MaxBindlessTextures = std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    }
+
 	auto deviceExtensions = pInstance->GetDeviceExtensions();
+
+    // Lets the allocator report usage against what the driver will give before it evicts, queried through core 1.1 calls
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_pPhysicalDevice->GetVkPhysicalDevice(), nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_pPhysicalDevice->GetVkPhysicalDevice(), nullptr, &extensionCount, availableExtensions.data());
+
+    m_IsMemoryBudgetEnabled = properties.apiVersion >= VK_API_VERSION_1_1 && std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension)
+        {
+            return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+        });
+
+    if (m_IsMemoryBudgetEnabled)
+    {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -60,9 +136,26 @@ LogicalDevice::LogicalDevice(PhysicalDevice* pPhysicalDevice, Instance* pInstanc
 
     vkGetDeviceQueue(m_Device, indices.presentFamily.value(), 0, &m_PresentQueue);
     vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
+    vkGetDeviceQueue(m_Device, m_TransferFamily, 0, &m_TransferQueue);
+
+    m_pMemoryAllocator = new MemoryAllocator(this);
+    m_pSamplerCache = new SamplerCache(this);
+    m_pUploadContext = new UploadContext(this, m_GraphicsFamily, m_StagingRingSize);
+
+    // Hands what it uploaded over to the graphics family through the graphics context
+    if (HasTransferQueue())
+    {
+        m_pTransferContext = new UploadContext(this, m_TransferFamily, m_TransferRingSize, m_pUploadContext);
+    }
 }
 
 LogicalDevice::~LogicalDevice()
 {
+	// Waits for the uploads still in flight, the transfer context hands its last ones to the graphics context first
+	delete m_pTransferContext;
+	delete m_pUploadContext;
+	delete m_pSamplerCache;
+	// Outlives every buffer and image
+	delete m_pMemoryAllocator;
 	vkDestroyDevice(m_Device, nullptr);
 }
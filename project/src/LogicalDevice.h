@@ -1,8 +1,12 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <cstdint>
 
 class Instance;
 class PhysicalDevice;
+class SamplerCache;
+class MemoryAllocator;
+class UploadContext;
 
 class LogicalDevice
 {
@@ -13,7 +17,26 @@ public:
 	VkDevice GetVkDevice() const { return m_Device; }
 	VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
 	VkQueue GetPresentQueue() const { return m_PresentQueue; }
+	// The graphics queue when the device has no family to copy beside it
+	VkQueue GetTransferQueue() const { return m_TransferQueue; }
+	uint32_t GetGraphicsFamily() const { return m_GraphicsFamily; }
+	uint32_t GetTransferFamily() const { return m_TransferFamily; }
+	bool HasTransferQueue() const { return m_TransferFamily != m_GraphicsFamily; }
 	PhysicalDevice* GetPhysicalDevice() { return m_pPhysicalDevice; }
+	bool IsBcCompressionEnabled() const { return m_IsBcCompressionEnabled; }
+	SamplerCache* GetSamplerCache() const { return m_pSamplerCache; }
+	// Every buffer and image gets its memory from it
+	MemoryAllocator* GetMemoryAllocator() const { return m_pMemoryAllocator; }
+	// Every staging copy and upload transition goes through it
+	UploadContext* GetUploadContext() const { return m_pUploadContext; }
+	// Uploads made while frames render, on the transfer queue when there is one and the upload context otherwise
+	UploadContext* GetTransferContext() const { return m_pTransferContext ? m_pTransferContext : m_pUploadContext; }
+	// Runtime sized sampled image arrays that are partially bound and updated while bound, Vulkan 1.2 devices only
+	bool IsDescriptorIndexingEnabled() const { return m_IsDescriptorIndexingEnabled; }
+	// Largest such array a fragment shader may see, 0 without descriptor indexing
+	uint32_t GetMaxBindlessTextures() const { return m_MaxBindlessTextures; }
+	// The driver reports usage and budget per heap, the allocator estimates both otherwise
+	bool IsMemoryBudgetEnabled() const { return m_IsMemoryBudgetEnabled; }
 
 private:
 	VkDevice m_Device;
@@ -21,4 +44,21 @@ private:
 
 	VkQueue m_GraphicsQueue;
 	VkQueue m_PresentQueue;
+	VkQueue m_TransferQueue;
+	uint32_t m_GraphicsFamily = 0;
+	uint32_t m_TransferFamily = 0;
+
+	bool m_IsBcCompressionEnabled = false;
+	bool m_IsDescriptorIndexingEnabled = false;
+	uint32_t m_MaxBindlessTextures = 0;
+	bool m_IsMemoryBudgetEnabled = false;
+
+	SamplerCache* m_pSamplerCache = nullptr;
+	MemoryAllocator* m_pMemoryAllocator = nullptr;
+
+	static const VkDeviceSize m_StagingRingSize = 64ull * 1024 * 1024;
+	UploadContext* m_pUploadContext = nullptr;
+	// Only streams what a few frames need at once
+	static const VkDeviceSize m_TransferRingSize = 32ull * 1024 * 1024;
+	UploadContext* m_pTransferContext = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	m_File = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (m_Mapping == nullptr)
+	{
+		return;
+	}
+
+	m_pData = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	m_Size = m_pData ? static_cast<size_t>(size.QuadPart) : 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_Mapping)
+	{
+		CloseHandle(m_Mapping);
+	}
+	if (m_File)
+	{
+		CloseHandle(m_File);
+	}
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+	m_File = open(path.c_str(), O_RDONLY);
+
+	if (m_File < 0)
+	{
+		return;
+	}
+
+	struct stat fileStat{};
+	if (fstat(m_File, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		return;
+	}
+
+	void* pData = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, m_File, 0);
+
+	if (pData == MAP_FAILED)
+	{
+		return;
+	}
+
+	m_pData = static_cast<const unsigned char*>(pData);
+	m_Size = static_cast<size_t>(fileStat.st_size);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		munmap(const_cast<unsigned char*>(m_pData), m_Size);
+	}
+	if (m_File >= 0)
+	{
+		close(m_File);
+	}
+}
+#endif
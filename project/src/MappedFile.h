@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) noexcept = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+	bool IsValid() const { return m_pData != nullptr; }
+	const unsigned char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const unsigned char* m_pData = nullptr;
+	size_t m_Size = 0;
+
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+};
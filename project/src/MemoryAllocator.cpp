@@ -0,0 +1,694 @@
+#include "MemoryAllocator.h"
+#include "LogicalDevice.h"
+#include "PhysicalDevice.h"
+#include <array>
+#include <bit>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// One device allocation split into ranges, the free ones are kept in a list per size class
+// The first level of classes is the power of two below the size, the second splits it into 16 linear steps
+class MemoryBlock
+{
+public:
+	static constexpr uint32_t m_InvalidNode = UINT32_MAX;
+
+	MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, unsigned char* pMapped, uint32_t poolIndex);
+
+	VkDeviceMemory GetMemory() const { return m_Memory; }
+	VkDeviceSize GetSize() const { return m_Size; }
+	unsigned char* GetMapped() const { return m_pMapped; }
+	uint32_t GetPoolIndex() const { return m_PoolIndex; }
+	VkDeviceSize GetUsedBytes() const { return m_UsedBytes; }
+	uint32_t GetAllocationCount() const { return m_AllocationCount; }
+	bool IsEmpty() const { return m_AllocationCount == 0; }
+
+	// Size and alignment are multiples of the allocator's minimum alignment, returns m_InvalidNode when no free range fits
+	uint32_t Allocate(VkDeviceSize size, VkDeviceSize alignment);
+	void Free(uint32_t node);
+	VkDeviceSize GetOffset(uint32_t node) const { return m_Nodes[node].offset; }
+
+	// Walks every free list, only for stats
+	void GetFreeRanges(uint32_t& count, VkDeviceSize& largest) const;
+
+private:
+	static const uint32_t m_SecondLevelBits = 4;
+	static const uint32_t m_SecondLevelCount = 1 << m_SecondLevelBits;
+	static const uint32_t m_FirstLevelCount = 64;
+
+	struct Node
+	{
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// Neighbours in address order
+		uint32_t prevPhysical = m_InvalidNode;
+		uint32_t nextPhysical = m_InvalidNode;
+		// Neighbours in the free list of its size class
+		uint32_t prevFree = m_InvalidNode;
+		uint32_t nextFree = m_InvalidNode;
+		bool isFree = false;
+	};
+
+	VkDeviceMemory m_Memory;
+	VkDeviceSize m_Size;
+	unsigned char* m_pMapped;
+	uint32_t m_PoolIndex;
+
+	VkDeviceSize m_UsedBytes = 0;
+	uint32_t m_AllocationCount = 0;
+
+	std::vector<Node> m_Nodes;
+	// Merged away, reused before growing m_Nodes
+	std::vector<uint32_t> m_UnusedNodes;
+
+	// A bit per first level with any free range, and per second level within it
+	uint64_t m_FirstLevelMap = 0;
+	std::array<uint32_t, m_FirstLevelCount> m_SecondLevelMaps{};
+	std::array<uint32_t, m_FirstLevelCount * m_SecondLevelCount> m_FreeHeads;
+
+	static uint32_t GetListIndex(VkDeviceSize size);
+	uint32_t FindFree(VkDeviceSize size, VkDeviceSize alignment) const;
+	uint32_t NewNode();
+	void InsertFree(uint32_t node);
+	void RemoveFree(uint32_t node);
+};
+
+MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, unsigned char* pMapped, uint32_t poolIndex)
+	: m_Memory(memory)
+	, m_Size(size)
+	, m_pMapped(pMapped)
+	, m_PoolIndex(poolIndex)
+{
+	m_FreeHeads.fill(m_InvalidNode);
+
+	Node whole{};
+	whole.size = size;
+	m_Nodes.push_back(whole);
+	InsertFree(0);
+}
+
+uint32_t MemoryBlock::GetListIndex(VkDeviceSize size)
+{
+	// Sizes are at least the minimum alignment, so the first level always has the bits to split
+	const uint32_t firstLevel = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	const uint32_t secondLevel = static_cast<uint32_t>(size >> (firstLevel - m_SecondLevelBits)) & (m_SecondLevelCount - 1);
+	return firstLevel * m_SecondLevelCount + secondLevel;
+}
+
+uint32_t MemoryBlock::FindFree(VkDeviceSize size, VkDeviceSize alignment) const
+{
+	// Every range starts at a multiple of the minimum alignment, larger ones may need that much padding in front
+	const VkDeviceSize paddedSize = size + alignment - MemoryAllocator::m_MinAlignment;
+
+	// Rounded up to the next class, so the first range of any class from there on fits without looking at it
+	const uint32_t paddedLevel = static_cast<uint32_t>(std::bit_width(paddedSize)) - 1;
+	const uint32_t list = GetListIndex(paddedSize + (1ull << (paddedLevel - m_SecondLevelBits)) - 1);
+	uint32_t firstLevel = list / m_SecondLevelCount;
+
+	if (firstLevel < m_FirstLevelCount)
+	{
+		uint32_t secondLevelMap = m_SecondLevelMaps[firstLevel] & (~0u << (list % m_SecondLevelCount));
+
+		if (secondLevelMap == 0 && firstLevel + 1 < m_FirstLevelCount)
+		{
+			const uint64_t firstLevelMap = m_FirstLevelMap & (~0ull << (firstLevel + 1));
+
+			if (firstLevelMap != 0)
+			{
+				firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+				secondLevelMap = m_SecondLevelMaps[firstLevel];
+			}
+		}
+
+		if (secondLevelMap != 0)
+		{
+			return m_FreeHeads[firstLevel * m_SecondLevelCount + std::countr_zero(secondLevelMap)];
+		}
+	}
+
+	// Only the classes below the rounded one are left, some of their ranges may still be large enough
+	for (uint32_t index = GetListIndex(size); index <= GetListIndex(paddedSize); ++index)
+	{
+		for (uint32_t node = m_FreeHeads[index]; node != m_InvalidNode; node = m_Nodes[node].nextFree)
+		{
+			if (AlignUp(m_Nodes[node].offset, alignment) + size <= m_Nodes[node].offset + m_Nodes[node].size)
+			{
+				return node;
+			}
+		}
+	}
+
+	return m_InvalidNode;
+}
+
+uint32_t MemoryBlock::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	const uint32_t node = FindFree(size, alignment);
+
+	if (node == m_InvalidNode)
+	{
+		return m_InvalidNode;
+	}
+
+	RemoveFree(node);
+
+	const VkDeviceSize padding = AlignUp(m_Nodes[node].offset, alignment) - m_Nodes[node].offset;
+
+	// The padding stays free in front of the range
+	if (padding > 0)
+	{
+		const uint32_t front = NewNode();
+		Node& frontNode = m_Nodes[front];
+		Node& allocated = m_Nodes[node];
+
+		frontNode.offset = allocated.offset;
+		frontNode.size = padding;
+		frontNode.prevPhysical = allocated.prevPhysical;
+		frontNode.nextPhysical = node;
+
+		if (allocated.prevPhysical != m_InvalidNode)
+		{
+			m_Nodes[allocated.prevPhysical].nextPhysical = front;
+		}
+
+		allocated.prevPhysical = front;
+		allocated.offset += padding;
+		allocated.size -= padding;
+		InsertFree(front);
+	}
+
+	// So does whatever the range does not need behind it
+	if (m_Nodes[node].size > size)
+	{
+		const uint32_t back = NewNode();
+		Node& backNode = m_Nodes[back];
+		Node& allocated = m_Nodes[node];
+
+		backNode.offset = allocated.offset + size;
+		backNode.size = allocated.size - size;
+		backNode.prevPhysical = node;
+		backNode.nextPhysical = allocated.nextPhysical;
+
+		if (allocated.nextPhysical != m_InvalidNode)
+		{
+			m_Nodes[allocated.nextPhysical].prevPhysical = back;
+		}
+
+		allocated.nextPhysical = back;
+		allocated.size = size;
+		InsertFree(back);
+	}
+
+	m_UsedBytes += size;
+	++m_AllocationCount;
+
+	return node;
+}
+
+void MemoryBlock::Free(uint32_t node)
+{
+	m_UsedBytes -= m_Nodes[node].size;
+	--m_AllocationCount;
+
+	// Merged with free neighbours right away, no two free ranges are ever next to each other
+	const uint32_t next = m_Nodes[node].nextPhysical;
+	if (next != m_InvalidNode && m_Nodes[next].isFree)
+	{
+		RemoveFree(next);
+		m_Nodes[node].size += m_Nodes[next].size;
+		m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+
+		if (m_Nodes[next].nextPhysical != m_InvalidNode)
+		{
+			m_Nodes[m_Nodes[next].nextPhysical].prevPhysical = node;
+		}
+
+		m_UnusedNodes.push_back(next);
+	}
+
+	const uint32_t prev = m_Nodes[node].prevPhysical;
+	uint32_t merged = node;
+	if (prev != m_InvalidNode && m_Nodes[prev].isFree)
+	{
+		RemoveFree(prev);
+		m_Nodes[prev].size += m_Nodes[node].size;
+		m_Nodes[prev].nextPhysical = m_Nodes[node].nextPhysical;
+
+		if (m_Nodes[node].nextPhysical != m_InvalidNode)
+		{
+			m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = prev;
+		}
+
+		m_UnusedNodes.push_back(node);
+		merged = prev;
+	}
+
+	InsertFree(merged);
+}
+
+void MemoryBlock::GetFreeRanges(uint32_t& count, VkDeviceSize& largest) const
+{
+	count = 0;
+	largest = 0;
+
+	for (uint32_t head : m_FreeHeads)
+	{
+		for (uint32_t node = head; node != m_InvalidNode; node = m_Nodes[node].nextFree)
+		{
+			++count;
+			largest = std::max(largest, m_Nodes[node].size);
+		}
+	}
+}
+
+uint32_t MemoryBlock::NewNode()
+{
+	if (!m_UnusedNodes.empty())
+	{
+		const uint32_t node = m_UnusedNodes.back();
+		m_UnusedNodes.pop_back();
+		m_Nodes[node] = Node{};
+		return node;
+	}
+
+	m_Nodes.push_back(Node{});
+	return static_cast<uint32_t>(m_Nodes.size()) - 1;
+}
+
+void MemoryBlock::InsertFree(uint32_t node)
+{
+	Node& freeNode = m_Nodes[node];
+	const uint32_t list = GetListIndex(freeNode.size);
+
+	freeNode.isFree = true;
+	freeNode.prevFree = m_InvalidNode;
+	freeNode.nextFree = m_FreeHeads[list];
+
+	if (freeNode.nextFree != m_InvalidNode)
+	{
+		m_Nodes[freeNode.nextFree].prevFree = node;
+	}
+
+	m_FreeHeads[list] = node;
+	m_FirstLevelMap |= 1ull << (list / m_SecondLevelCount);
+	m_SecondLevelMaps[list / m_SecondLevelCount] |= 1u << (list % m_SecondLevelCount);
+}
+
+void MemoryBlock::RemoveFree(uint32_t node)
+{
+	Node& freeNode = m_Nodes[node];
+	const uint32_t list = GetListIndex(freeNode.size);
+
+	if (freeNode.prevFree != m_InvalidNode)
+	{
+		m_Nodes[freeNode.prevFree].nextFree = freeNode.nextFree;
+	}
+	else
+	{
+		m_FreeHeads[list] = freeNode.nextFree;
+
+		if (m_FreeHeads[list] == m_InvalidNode)
+		{
+			m_SecondLevelMaps[list / m_SecondLevelCount] &= ~(1u << (list % m_SecondLevelCount));
+
+			if (m_SecondLevelMaps[list / m_SecondLevelCount] == 0)
+			{
+				m_FirstLevelMap &= ~(1ull << (list / m_SecondLevelCount));
+			}
+		}
+	}
+
+	if (freeNode.nextFree != m_InvalidNode)
+	{
+		m_Nodes[freeNode.nextFree].prevFree = freeNode.prevFree;
+	}
+
+	freeNode.isFree = false;
+	freeNode.prevFree = m_InvalidNode;
+	freeNode.nextFree = m_InvalidNode;
+}
+
+MemoryAllocator::MemoryAllocator(LogicalDevice* pDevice)
+	: m_pDevice{ pDevice }
+{
+	vkGetPhysicalDeviceMemoryProperties(m_pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), &m_MemoryProperties);
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), &properties);
+	m_MaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	// Neighbouring ranges are at least the minimum alignment apart, which keeps them out of each other's page up to that size
+	m_IsSeparatingLinear = properties.limits.bufferImageGranularity > m_MinAlignment;
+
+	m_Pools.resize(m_MemoryProperties.memoryTypeCount * 2);
+
+	for (uint32_t i{}; i < m_MemoryProperties.memoryTypeCount; ++i)
+	{
+		const VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[i].heapIndex].size;
+		const VkDeviceSize blockSize = std::max(m_MinAlignment, std::min(m_MaxBlockSize, heapSize / 8 / m_MinAlignment * m_MinAlignment));
+
+		for (uint32_t isLinear{}; isLinear < 2; ++isLinear)
+		{
+			Pool& pool = m_Pools[i * 2 + isLinear];
+			pool.memoryTypeIndex = i;
+			pool.isLinear = isLinear == 1;
+			pool.blockSize = blockSize;
+		}
+	}
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (Pool& pool : m_Pools)
+	{
+		for (MemoryBlock* pBlock : pool.blocks)
+		{
+			FreeDeviceMemory(pBlock->GetMemory(), pool.memoryTypeIndex, pBlock->GetSize());
+			delete pBlock;
+		}
+	}
+}
+
+MemoryAllocation MemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category)
+{
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_pDevice->GetVkDevice(), buffer, &requirements);
+
+	MemoryAllocation allocation = Allocate(requirements, properties, true, category);
+	vkBindBufferMemory(m_pDevice->GetVkDevice(), buffer, allocation.memory, allocation.offset);
+
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, MemoryCategory category)
+{
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_pDevice->GetVkDevice(), image, &requirements);
+
+	MemoryAllocation allocation = Allocate(requirements, properties, tiling == VK_IMAGE_TILING_LINEAR, category);
+	vkBindImageMemory(m_pDevice->GetVkDevice(), image, allocation.memory, allocation.offset);
+
+	return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	const uint32_t heapIndex = m_MemoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+	m_CategoryBytes[heapIndex][static_cast<size_t>(allocation.category)] -= allocation.size;
+
+	if (!allocation.pBlock)
+	{
+		FreeDeviceMemory(allocation.memory, allocation.memoryTypeIndex, allocation.size);
+		--m_DedicatedCount;
+		m_DedicatedBytes -= allocation.size;
+	}
+	else
+	{
+		MemoryBlock* pBlock = allocation.pBlock;
+		pBlock->Free(allocation.node);
+
+		// One empty block stays, so a resource that is recreated over and over does not allocate every time
+		std::vector<MemoryBlock*>& blocks = m_Pools[pBlock->GetPoolIndex()].blocks;
+		const auto emptyCount = std::count_if(blocks.begin(), blocks.end(), [](MemoryBlock* pOther) { return pOther->IsEmpty(); });
+
+		if (pBlock->IsEmpty() && emptyCount > 1)
+		{
+			blocks.erase(std::find(blocks.begin(), blocks.end(), pBlock));
+			FreeDeviceMemory(pBlock->GetMemory(), allocation.memoryTypeIndex, pBlock->GetSize());
+			delete pBlock;
+		}
+	}
+
+	allocation = MemoryAllocation{};
+}
+
+void MemoryAllocator::PrintStats()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	std::cout << "Device memory: " << m_DeviceAllocationCount << " allocations of at most " << m_MaxAllocationCount << ", "
+		<< m_DedicatedCount << " dedicated holding " << m_DedicatedBytes / (1024.0 * 1024.0) << " MB\n";
+
+	for (const Pool& pool : m_Pools)
+	{
+		if (pool.blocks.empty())
+		{
+			continue;
+		}
+
+		VkDeviceSize totalBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize largestFree = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeRangeCount = 0;
+
+		for (const MemoryBlock* pBlock : pool.blocks)
+		{
+			uint32_t blockFreeCount = 0;
+			VkDeviceSize blockLargestFree = 0;
+			pBlock->GetFreeRanges(blockFreeCount, blockLargestFree);
+
+			totalBytes += pBlock->GetSize();
+			usedBytes += pBlock->GetUsedBytes();
+			allocationCount += pBlock->GetAllocationCount();
+			freeRangeCount += blockFreeCount;
+			largestFree = std::max(largestFree, blockLargestFree);
+		}
+
+		// Share of the free bytes that a single allocation could not use
+		const VkDeviceSize freeBytes = totalBytes - usedBytes;
+		const double fragmentation = freeBytes > 0 ? 1.0 - static_cast<double>(largestFree) / freeBytes : 0.0;
+
+		std::cout << "  Memory type " << pool.memoryTypeIndex << (pool.isLinear ? " buffers" : (m_IsSeparatingLinear ? " images" : "")) << ": "
+			<< pool.blocks.size() << " blocks of " << pool.blockSize / (1024.0 * 1024.0) << " MB, " << usedBytes / (1024.0 * 1024.0) << " MB used by "
+			<< allocationCount << " allocations, " << freeRangeCount << " free ranges, " << fragmentation * 100.0 << "% fragmented\n";
+	}
+}
+
+std::vector<HeapBudget> MemoryAllocator::GetBudgets()
+{
+	std::vector<HeapBudget> budgets(m_MemoryProperties.memoryHeapCount);
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	// Changes as this and other processes allocate, so it is asked for every time
+	if (m_pDevice->IsMemoryBudgetEnabled())
+	{
+		VkPhysicalDeviceMemoryProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties2.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(m_pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), &properties2);
+	}
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	for (uint32_t i{}; i < m_MemoryProperties.memoryHeapCount; ++i)
+	{
+		HeapBudget& budget = budgets[i];
+		budget.size = m_MemoryProperties.memoryHeaps[i].size;
+		budget.isDeviceLocal = (m_MemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		budget.allocatorBytes = m_HeapBytes[i];
+		budget.categoryBytes = m_CategoryBytes[i];
+
+		if (m_pDevice->IsMemoryBudgetEnabled())
+		{
+			budget.budget = budgetProperties.heapBudget[i];
+			budget.usage = budgetProperties.heapUsage[i];
+		}
+		else
+		{
+			// Leaves room for the driver, other processes and the swapchain the way drivers usually size the budget
+			budget.budget = budget.size / 10 * 8;
+			budget.usage = m_HeapBytes[i];
+		}
+	}
+
+	return budgets;
+}
+
+bool MemoryAllocator::IsNearBudget(float share)
+{
+	const std::vector<HeapBudget> budgets = GetBudgets();
+
+	return std::any_of(budgets.begin(), budgets.end(), [share](const HeapBudget& budget)
+		{
+			return budget.usage > budget.budget * static_cast<double>(share);
+		});
+}
+
+void MemoryAllocator::PrintBudgets(float warningShare)
+{
+	const std::vector<HeapBudget> budgets = GetBudgets();
+	const double megabyte = 1024.0 * 1024.0;
+
+	std::cout << "Memory budget" << (m_pDevice->IsMemoryBudgetEnabled() ? "" : " (estimated without VK_EXT_memory_budget)") << ":\n";
+
+	for (size_t i{}; i < budgets.size(); ++i)
+	{
+		const HeapBudget& budget = budgets[i];
+
+		if (budget.allocatorBytes == 0 && budget.usage == 0)
+		{
+			continue;
+		}
+
+		const bool isNear = budget.usage > budget.budget * static_cast<double>(warningShare);
+
+		std::cout << "  Heap " << i << (budget.isDeviceLocal ? " device local" : " host") << ": " << budget.usage / megabyte << " of " << budget.budget / megabyte
+			<< " MB budget (" << budget.size / megabyte << " MB heap), " << budget.allocatorBytes / megabyte << " MB allocated here"
+			<< (isNear ? ", NEAR BUDGET" : "") << "\n";
+
+		for (size_t category{}; category < budget.categoryBytes.size(); ++category)
+		{
+			if (budget.categoryBytes[category] > 0)
+			{
+				std::cout << "    " << GetCategoryName(static_cast<MemoryCategory>(category)) << ": " << budget.categoryBytes[category] / megabyte << " MB\n";
+			}
+		}
+	}
+}
+
+const char* MemoryAllocator::GetCategoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+	case MemoryCategory::Geometry:
+		return "geometry";
+	case MemoryCategory::MaterialTexture:
+		return "material textures";
+	case MemoryCategory::GBuffer:
+		return "G-buffer";
+	case MemoryCategory::Depth:
+		return "depth";
+	case MemoryCategory::Uniform:
+		return "uniforms";
+	case MemoryCategory::Staging:
+		return "staging";
+	default:
+		return "unknown";
+	}
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isLinear, MemoryCategory category)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	const uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+	const uint32_t poolIndex = memoryTypeIndex * 2 + (m_IsSeparatingLinear && isLinear ? 1 : 0);
+	Pool& pool = m_Pools[poolIndex];
+
+	const VkDeviceSize size = AlignUp(requirements.size, m_MinAlignment);
+	const VkDeviceSize alignment = AlignUp(requirements.alignment, m_MinAlignment);
+
+	MemoryAllocation allocation{};
+	allocation.size = size;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.category = category;
+
+	const uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+	if (size > std::min(m_DedicatedThreshold, pool.blockSize / 2))
+	{
+		allocation.memory = AllocateDeviceMemory(memoryTypeIndex, size, allocation.pMapped);
+		++m_DedicatedCount;
+		m_DedicatedBytes += size;
+		m_CategoryBytes[heapIndex][static_cast<size_t>(category)] += size;
+		return allocation;
+	}
+
+	MemoryBlock* pBlock = nullptr;
+	uint32_t node = MemoryBlock::m_InvalidNode;
+
+	for (MemoryBlock* pCandidate : pool.blocks)
+	{
+		node = pCandidate->Allocate(size, alignment);
+
+		if (node != MemoryBlock::m_InvalidNode)
+		{
+			pBlock = pCandidate;
+			break;
+		}
+	}
+
+	if (!pBlock)
+	{
+		unsigned char* pMapped = nullptr;
+		const VkDeviceMemory memory = AllocateDeviceMemory(memoryTypeIndex, pool.blockSize, pMapped);
+
+		pBlock = new MemoryBlock(memory, pool.blockSize, pMapped, poolIndex);
+		pool.blocks.push_back(pBlock);
+		node = pBlock->Allocate(size, alignment);
+	}
+
+	allocation.memory = pBlock->GetMemory();
+	allocation.offset = pBlock->GetOffset(node);
+	allocation.pMapped = pBlock->GetMapped() ? pBlock->GetMapped() + allocation.offset : nullptr;
+	allocation.pBlock = pBlock;
+	allocation.node = node;
+	m_CategoryBytes[heapIndex][static_cast<size_t>(category)] += size;
+
+	return allocation;
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size, unsigned char*& pMapped)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_pDevice->GetVkDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	++m_DeviceAllocationCount;
+	m_HeapBytes[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+	pMapped = nullptr;
+
+	// Mapped once for as long as it lives, every range in it shares the mapping
+	if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* pData;
+		vkMapMemory(m_pDevice->GetVkDevice(), memory, 0, VK_WHOLE_SIZE, 0, &pData);
+		pMapped = static_cast<unsigned char*>(pData);
+	}
+
+	return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	// Unmaps it as well
+	vkFreeMemory(m_pDevice->GetVkDevice(), memory, nullptr);
+	--m_DeviceAllocationCount;
+	m_HeapBytes[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex] -= size;
+}
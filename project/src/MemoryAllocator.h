@@ -0,0 +1,127 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <array>
+#include <cstdint>
+
+class LogicalDevice;
+class MemoryBlock;
+
+// What a buffer or image holds, the allocator counts every allocation under one
+enum class MemoryCategory
+{
+	Geometry,
+	MaterialTexture,
+	GBuffer,
+	Depth,
+	Uniform,
+	Staging,
+	Count
+};
+
+// Range of device memory a buffer or image is bound to, handed back to the allocator to free it
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// Start of the range in the persistent mapping of host visible memory, nullptr otherwise
+	unsigned char* pMapped = nullptr;
+
+	// nullptr for memory of its own
+	MemoryBlock* pBlock = nullptr;
+	uint32_t node = 0;
+
+	uint32_t memoryTypeIndex = 0;
+	MemoryCategory category = MemoryCategory::Geometry;
+};
+
+// Use of one memory heap, in bytes
+struct HeapBudget
+{
+	VkDeviceSize size = 0;
+	// What the process can use before the driver starts evicting, 80% of the heap without VK_EXT_memory_budget
+	VkDeviceSize budget = 0;
+	// Everything the process holds in the heap as the driver sees it, only this allocator's device memory without the extension
+	VkDeviceSize usage = 0;
+	bool isDeviceLocal = false;
+	// Device memory of this allocator, blocks count in full
+	VkDeviceSize allocatorBytes = 0;
+	// Bound to resources, indexed by MemoryCategory
+	std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categoryBytes{};
+};
+
+// Owned by the device, sub-allocates buffers and images from large blocks per memory type with a two-level segregated fit
+// Finding and freeing a range are constant time, neighbouring free ranges merge right away
+// Buffers and images only share a block when bufferImageGranularity is no larger than the alignment every range gets anyway
+class MemoryAllocator
+{
+public:
+	explicit MemoryAllocator(LogicalDevice* pDevice);
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator(MemoryAllocator&&) noexcept = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(MemoryAllocator&&) noexcept = delete;
+
+	// Finds memory with these properties that fits the resource, binds it and counts it under the category
+	MemoryAllocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category);
+	MemoryAllocation AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, MemoryCategory category);
+	// Nothing may use the range anymore, resets the allocation and does nothing for an empty one
+	void Free(MemoryAllocation& allocation);
+
+	// Blocks, use and fragmentation per memory type, and the device allocations against the device's limit
+	void PrintStats();
+
+	// One entry per heap, asks the driver for usage and budget when VK_EXT_memory_budget is enabled, safe to call from any thread
+	std::vector<HeapBudget> GetBudgets();
+	// Whether any heap's usage is above this share of its budget, i.e. further allocations risk oversubscribing it
+	bool IsNearBudget(float share);
+	// Usage against budget per heap and what each category holds in it, heaps above the share are flagged
+	void PrintBudgets(float warningShare);
+
+	static const char* GetCategoryName(MemoryCategory category);
+
+	// Every offset and size is a multiple of it, so the free ranges a split leaves behind are never too small to track
+	static constexpr VkDeviceSize m_MinAlignment = 256;
+
+private:
+	struct Pool
+	{
+		uint32_t memoryTypeIndex = 0;
+		bool isLinear = false;
+		VkDeviceSize blockSize = 0;
+		std::vector<MemoryBlock*> blocks;
+	};
+
+	// Smaller on heaps where a few blocks would take most of it
+	static constexpr VkDeviceSize m_MaxBlockSize = 64ull * 1024 * 1024;
+	// Larger resources get memory of their own instead of leaving most of a block unusable
+	static constexpr VkDeviceSize m_DedicatedThreshold = m_MaxBlockSize / 2;
+
+	LogicalDevice* m_pDevice;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+	uint32_t m_MaxAllocationCount = 0;
+	// Buffers and images go to pools of their own when the granularity could put both in one page
+	bool m_IsSeparatingLinear = false;
+
+	std::mutex m_Mutex;
+	// Two per memory type, linear resources second
+	std::vector<Pool> m_Pools;
+
+	// Indexed by heap
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_HeapBytes{};
+	std::array<std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)>, VK_MAX_MEMORY_HEAPS> m_CategoryBytes{};
+
+	uint32_t m_DeviceAllocationCount = 0;
+	uint32_t m_DedicatedCount = 0;
+	VkDeviceSize m_DedicatedBytes = 0;
+
+	MemoryAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isLinear, MemoryCategory category);
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	// Maps it right away when host visible
+	VkDeviceMemory AllocateDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size, unsigned char*& pMapped);
+	void FreeDeviceMemory(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
+};
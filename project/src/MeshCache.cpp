@@ -0,0 +1,288 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "json.hpp"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+MeshCache::MeshCache(const std::string& sourcePath, uint32_t settings)
+	: m_SourcePath(sourcePath)
+	, m_CachePath(sourcePath + ".meshcache")
+	, m_Settings(settings)
+{
+	m_SourceHash = HashSourceFile();
+}
+
+MeshCache::~MeshCache()
+{
+	Release();
+}
+
+bool MeshCache::Load(std::vector<Model*>& models)
+{
+	Release();
+
+	// Source could not be read, nothing to validate against
+	if (m_SourceHash == 0)
+	{
+		return false;
+	}
+
+	m_pMapping = new MappedFile(m_CachePath);
+
+	if (!m_pMapping->IsValid() || m_pMapping->GetSize() < sizeof(Header))
+	{
+		Release();
+		return false;
+	}
+
+	const unsigned char* pData = m_pMapping->GetData();
+
+	Header header{};
+	memcpy(&header, pData, sizeof(Header));
+
+	if (header.magic != m_Magic || header.version != g_MESH_CACHE_VERSION || header.sourceHash != m_SourceHash)
+	{
+		Release();
+		return false;
+	}
+
+	const size_t entriesOffset = sizeof(Header);
+	const size_t verticesOffset = entriesOffset + sizeof(Entry) * header.modelCount;
+	const size_t indicesOffset = verticesOffset + sizeof(Vertex) * header.vertexCount;
+	const size_t instancesOffset = indicesOffset + sizeof(uint32_t) * header.indexCount;
+	const size_t meshletsOffset = instancesOffset + sizeof(glm::mat4) * header.instanceCount;
+	const size_t lodsOffset = meshletsOffset + sizeof(Meshlet) * header.meshletCount;
+	const size_t stringsOffset = lodsOffset + sizeof(MeshLod) * header.lodCount;
+
+	// Truncated or corrupt file
+	if (stringsOffset + header.stringBytes != m_pMapping->GetSize())
+	{
+		Release();
+		return false;
+	}
+
+	const Entry* pEntries = reinterpret_cast<const Entry*>(pData + entriesOffset);
+	const glm::mat4* pInstances = reinterpret_cast<const glm::mat4*>(pData + instancesOffset);
+	const Meshlet* pMeshlets = reinterpret_cast<const Meshlet*>(pData + meshletsOffset);
+	const MeshLod* pLods = reinterpret_cast<const MeshLod*>(pData + lodsOffset);
+	const char* pStrings = reinterpret_cast<const char*>(pData + stringsOffset);
+
+	m_pVertices = reinterpret_cast<const Vertex*>(pData + verticesOffset);
+	m_pIndices = reinterpret_cast<const uint32_t*>(pData + indicesOffset);
+	m_VertexCount = header.vertexCount;
+	m_IndexCount = header.indexCount;
+
+	models.reserve(header.modelCount);
+
+	for (uint32_t i{}; i < header.modelCount; ++i)
+	{
+		const Entry& entry = pEntries[i];
+
+		models.push_back(new Model{});
+		Model& model = *models.back();
+
+		model.SetVertexOffset(entry.vertexOffset);
+		model.SetVertexCount(entry.vertexCount);
+		model.SetFirstIndex(entry.firstIndex);
+		model.SetIndexCount(entry.indexCount);
+		model.SetFirstInstance(entry.firstInstance);
+		model.SetBoundingSphere(entry.boundingSphere);
+		model.SetTransparent(entry.isTransparent != 0);
+
+		// Instances and meshlets are tiny, copy them out so a hit and a miss produce the same models
+		model.GetInstances().assign(pInstances + entry.firstInstance, pInstances + entry.firstInstance + entry.instanceCount);
+		model.GetMeshlets().assign(pMeshlets + entry.firstMeshlet, pMeshlets + entry.firstMeshlet + entry.meshletCount);
+		model.GetLods().assign(pLods + entry.firstLod, pLods + entry.firstLod + entry.lodCount);
+
+		model.GetDiffuseTexturePath() = pStrings + entry.diffusePath;
+		model.GetNormalTexturePath() = pStrings + entry.normalPath;
+		model.GetMetalRoughTexturePath() = pStrings + entry.metalRoughPath;
+	}
+
+	return true;
+}
+
+void MeshCache::Save(const std::vector<Model*>& models) const
+{
+	if (m_SourceHash == 0)
+	{
+		return;
+	}
+
+	Header header{};
+	header.magic = m_Magic;
+	header.version = g_MESH_CACHE_VERSION;
+	header.sourceHash = m_SourceHash;
+	header.modelCount = static_cast<uint32_t>(models.size());
+
+	std::vector<Entry> entries;
+	entries.reserve(models.size());
+
+	std::string strings;
+
+	auto addString = [&strings](const std::string& value)
+	{
+		uint32_t offset = static_cast<uint32_t>(strings.size());
+		strings.append(value);
+		strings.push_back('\0');
+		return offset;
+	};
+
+	for (Model* pModel : models)
+	{
+		Entry entry{};
+		entry.firstMeshlet = header.meshletCount;
+		entry.meshletCount = static_cast<uint32_t>(pModel->GetMeshlets().size());
+		entry.firstLod = header.lodCount;
+		entry.lodCount = static_cast<uint32_t>(pModel->GetLods().size());
+		entry.boundingSphere = pModel->GetBoundingSphere();
+		entry.vertexOffset = header.vertexCount;
+		entry.vertexCount = pModel->GetVertexCount();
+		entry.firstIndex = header.indexCount;
+		entry.indexCount = pModel->GetIndexCount();
+		entry.firstInstance = header.instanceCount;
+		entry.instanceCount = pModel->GetInstanceCount();
+		entry.diffusePath = addString(pModel->GetDiffuseTexturePath());
+		entry.normalPath = addString(pModel->GetNormalTexturePath());
+		entry.metalRoughPath = addString(pModel->GetMetalRoughTexturePath());
+		entry.isTransparent = pModel->IsTransparent() ? 1 : 0;
+		entries.push_back(entry);
+
+		header.vertexCount += entry.vertexCount;
+		header.indexCount += entry.indexCount;
+		header.instanceCount += entry.instanceCount;
+		header.meshletCount += entry.meshletCount;
+		header.lodCount += entry.lodCount;
+	}
+
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+
+	// Write next to the real file first so a crash never leaves a truncated cache behind
+	const std::string tempPath = m_CachePath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(entries.data()), sizeof(Entry) * entries.size());
+
+	// Same order as the entries, so every stream is the concatenation of the models' own
+	std::vector<Vertex> vertices;
+	vertices.reserve(header.vertexCount);
+	std::vector<uint32_t> indices;
+	indices.reserve(header.indexCount);
+	std::vector<glm::mat4> instances;
+	instances.reserve(header.instanceCount);
+	std::vector<Meshlet> meshlets;
+	meshlets.reserve(header.meshletCount);
+	std::vector<MeshLod> lods;
+	lods.reserve(header.lodCount);
+
+	for (Model* pModel : models)
+	{
+		vertices.insert(vertices.end(), pModel->GetVertices().begin(), pModel->GetVertices().end());
+		indices.insert(indices.end(), pModel->GetIndices().begin(), pModel->GetIndices().end());
+		instances.insert(instances.end(), pModel->GetInstances().begin(), pModel->GetInstances().end());
+		meshlets.insert(meshlets.end(), pModel->GetMeshlets().begin(), pModel->GetMeshlets().end());
+		lods.insert(lods.end(), pModel->GetLods().begin(), pModel->GetLods().end());
+	}
+
+	file.write(reinterpret_cast<const char*>(vertices.data()), sizeof(Vertex) * vertices.size());
+	file.write(reinterpret_cast<const char*>(indices.data()), sizeof(uint32_t) * indices.size());
+	file.write(reinterpret_cast<const char*>(instances.data()), sizeof(glm::mat4) * instances.size());
+	file.write(reinterpret_cast<const char*>(meshlets.data()), sizeof(Meshlet) * meshlets.size());
+	file.write(reinterpret_cast<const char*>(lods.data()), sizeof(MeshLod) * lods.size());
+	file.write(strings.data(), strings.size());
+	file.close();
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_CachePath, error);
+}
+
+void MeshCache::Release()
+{
+	delete m_pMapping;
+	m_pMapping = nullptr;
+
+	m_pVertices = nullptr;
+	m_pIndices = nullptr;
+	m_VertexCount = 0;
+	m_IndexCount = 0;
+}
+
+uint64_t MeshCache::HashSourceFile() const
+{
+	MappedFile source{ m_SourcePath };
+
+	if (!source.IsValid())
+	{
+		return 0;
+	}
+
+	// FNV-1a over the file contents, seeded with the loader version and settings
+	uint64_t hash = 14695981039346656037ull ^ (static_cast<uint64_t>(m_Settings) << 32 | g_MESH_CACHE_VERSION);
+
+	const unsigned char* pData = source.GetData();
+	for (size_t i{}; i < source.GetSize(); ++i)
+	{
+		hash ^= pData[i];
+		hash *= 1099511628211ull;
+	}
+
+	hash ^= source.GetSize();
+	hash *= 1099511628211ull;
+
+	// A .gltf keeps its geometry in external buffers, which can be re-exported without touching the JSON
+	const std::filesystem::path sourcePath{ m_SourcePath };
+
+	if (sourcePath.extension() == ".gltf")
+	{
+		try
+		{
+			const nlohmann::json document = nlohmann::json::parse(pData, pData + source.GetSize());
+
+			if (document.contains("buffers"))
+			{
+				for (size_t i{}; i < document["buffers"].size(); ++i)
+				{
+					std::string uri = document["buffers"][i].value("uri", std::string{});
+
+					// Embedded base64 buffers are part of the hashed JSON already
+					if (uri.empty() || uri.rfind("data:", 0) == 0)
+					{
+						continue;
+					}
+
+					// Relative URIs may be percent-encoded, e.g. spaces as %20
+					for (size_t position = uri.find('%'); position != std::string::npos && position + 2 < uri.size(); position = uri.find('%', position + 1))
+					{
+						uri.replace(position, 3, 1, static_cast<char>(std::stoi(uri.substr(position + 1, 2), nullptr, 16)));
+					}
+
+					// Size and modification time instead of the contents, hashing every buffer would cost a cache hit most of its gain
+					const std::filesystem::path bufferPath = sourcePath.parent_path() / uri;
+					const uint64_t bufferSize = std::filesystem::file_size(bufferPath);
+					const uint64_t bufferTime = static_cast<uint64_t>(std::filesystem::last_write_time(bufferPath).time_since_epoch().count());
+
+					for (const uint64_t value : { bufferSize, bufferTime })
+					{
+						hash ^= value;
+						hash *= 1099511628211ull;
+					}
+				}
+			}
+		}
+		catch (const std::exception&)
+		{
+			// Missing buffers or broken JSON, the loader reports it, nothing is cached
+			return 0;
+		}
+	}
+
+	return hash;
+}
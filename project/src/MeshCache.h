@@ -0,0 +1,87 @@
+#pragma once
+#include "Structs.h"
+#include <vector>
+#include <string>
+
+class Model;
+class MappedFile;
+
+// Bump whenever the loader output changes, stale caches are then rebuilt on the next launch
+const uint32_t g_MESH_CACHE_VERSION = 9;
+
+// Binary cache of the final vertex and index streams of a loaded model file
+// Layout: header, one entry per model, vertex stream, index stream, instance transforms, meshlets, levels of detail, string blob
+class MeshCache
+{
+public:
+	// Different settings produce different streams from the same source, so they are part of the hash
+	MeshCache(const std::string& sourcePath, uint32_t settings = 0);
+	~MeshCache();
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache(MeshCache&&) noexcept = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+	MeshCache& operator=(MeshCache&&) noexcept = delete;
+
+	// Maps the cache file and rebuilds the models from it, returns false on a miss
+	bool Load(std::vector<Model*>& models);
+	// Streams are laid out back to back in the order of models, the ranges stored on the models are not read
+	void Save(const std::vector<Model*>& models) const;
+	// Unmaps the cache file, vertex and index pointers become invalid
+	void Release();
+
+	bool IsLoaded() const { return m_pMapping != nullptr; }
+	const Vertex* GetVertices() const { return m_pVertices; }
+	const uint32_t* GetIndices() const { return m_pIndices; }
+	uint32_t GetVertexCount() const { return m_VertexCount; }
+	uint32_t GetIndexCount() const { return m_IndexCount; }
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t modelCount;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t instanceCount;
+		uint32_t meshletCount;
+		uint32_t lodCount;
+		uint32_t stringBytes;
+	};
+
+	struct Entry
+	{
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t firstLod;
+		uint32_t lodCount;
+		glm::vec4 boundingSphere;
+		uint32_t diffusePath;
+		uint32_t normalPath;
+		uint32_t metalRoughPath;
+		uint32_t isTransparent;
+	};
+
+	static const uint32_t m_Magic = 0x4843534D; // "MSCH"
+
+	std::string m_SourcePath;
+	std::string m_CachePath;
+	uint32_t m_Settings = 0;
+	uint64_t m_SourceHash = 0;
+
+	MappedFile* m_pMapping = nullptr;
+	const Vertex* m_pVertices = nullptr;
+	const uint32_t* m_pIndices = nullptr;
+	uint32_t m_VertexCount = 0;
+	uint32_t m_IndexCount = 0;
+
+	uint64_t HashSourceFile() const;
+};
@@ -0,0 +1,724 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <unordered_map>
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats{ 0.0f, 0.0f };
+
+	if (indices.empty() || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	// A vertex stays in the cache until cacheSize newer vertices were loaded, 0 means never loaded
+	std::vector<uint32_t> loadedAt(vertexCount, 0);
+	uint32_t misses = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+		{
+			++misses;
+			loadedAt[index] = misses;
+		}
+	}
+
+	std::vector<bool> isUsed(vertexCount, false);
+	size_t usedCount = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (!isUsed[index])
+		{
+			isUsed[index] = true;
+			++usedCount;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / usedCount;
+
+	return stats;
+}
+
+std::vector<size_t> MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	std::vector<size_t> clusters;
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return clusters;
+	}
+
+	// Vertex to triangle adjacency in compressed rows
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (uint32_t index : indices)
+	{
+		++liveTriangles[index];
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v{}; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t{}; t < triangleCount; ++t)
+	{
+		for (size_t c{}; c < 3; ++c)
+		{
+			adjacency[fill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> isEmitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint32_t timeStamp = cacheSize + 1;
+	size_t cursor = 0;
+	int64_t fanVertex = indices[0];
+
+	while (fanVertex >= 0)
+	{
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		for (uint32_t a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; ++a)
+		{
+			const uint32_t triangle = adjacency[a];
+
+			if (isEmitted[triangle])
+			{
+				continue;
+			}
+
+			for (size_t c{}; c < 3; ++c)
+			{
+				const uint32_t vertex = indices[triangle * 3 + c];
+
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+
+				if (timeStamp - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = timeStamp++;
+				}
+			}
+
+			isEmitted[triangle] = true;
+		}
+
+		// Prefer the candidate that will still be in the cache after its remaining triangles are emitted
+		int64_t nextVertex = -1;
+		int64_t bestPriority = -1;
+
+		for (uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+			if (timeStamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = timeStamp - cacheTime[vertex];
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = vertex;
+			}
+		}
+
+		if (nextVertex >= 0)
+		{
+			fanVertex = nextVertex;
+			continue;
+		}
+
+		// Dead end, the cache gets cold here so this is a natural cluster boundary
+		fanVertex = -1;
+
+		while (!deadEnds.empty())
+		{
+			const uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+
+			if (liveTriangles[vertex] > 0)
+			{
+				fanVertex = vertex;
+				break;
+			}
+		}
+
+		while (fanVertex < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				fanVertex = static_cast<int64_t>(cursor);
+			}
+			++cursor;
+		}
+
+		if (fanVertex >= 0)
+		{
+			clusters.push_back(output.size());
+		}
+	}
+
+	clusters.insert(clusters.begin(), 0);
+	indices.swap(output);
+
+	return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters)
+{
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	glm::vec3 meshCenter{ 0.0f };
+	for (uint32_t index : indices)
+	{
+		meshCenter += vertices[index].pos;
+	}
+	meshCenter /= static_cast<float>(indices.size());
+
+	// Clusters on the outside facing outwards tend to occlude the rest, draw those first
+	std::vector<float> sortKeys(clusters.size());
+
+	for (size_t c{}; c < clusters.size(); ++c)
+	{
+		const size_t begin = clusters[c];
+		const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : indices.size();
+
+		glm::vec3 center{ 0.0f };
+		glm::vec3 normal{ 0.0f };
+		float area = 0.0f;
+
+		for (size_t i = begin; i + 2 < end; i += 3)
+		{
+			const glm::vec3& p0 = vertices[indices[i + 0]].pos;
+			const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+
+			// Unnormalized cross product, its length is twice the triangle area
+			const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			const float triangleArea = glm::length(triangleNormal);
+
+			center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		const float normalLength = glm::length(normal);
+
+		if (area <= 0.0f || normalLength <= 0.0f)
+		{
+			sortKeys[c] = 0.0f;
+			continue;
+		}
+
+		center /= area;
+		sortKeys[c] = glm::dot(center - meshCenter, normal / normalLength);
+	}
+
+	std::vector<size_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	for (size_t c : order)
+	{
+		const size_t begin = clusters[c];
+		const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : indices.size();
+		output.insert(output.end(), indices.begin() + begin, indices.begin() + end);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t unused = UINT32_MAX;
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<uint32_t>(output.size());
+			output.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	// Vertices no triangle references are dropped
+	vertices.swap(output);
+}
+
+std::vector<uint32_t> MeshOptimizer::Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError, float& resultError)
+{
+	std::vector<uint32_t> result = indices;
+	resultError = 0.0f;
+
+	if (result.size() <= targetIndexCount)
+	{
+		return result;
+	}
+
+	const size_t vertexCount = vertices.size();
+
+	// An edge without exactly one twin is an open border, a seam between split vertices or non manifold, pin both ends
+	std::unordered_map<uint64_t, uint32_t> edgeCounts;
+	edgeCounts.reserve(result.size());
+
+	auto edgeKey = [](uint32_t a, uint32_t b) { return static_cast<uint64_t>(a) << 32 | b; };
+
+	for (size_t i{}; i + 2 < result.size(); i += 3)
+	{
+		for (size_t e{}; e < 3; ++e)
+		{
+			++edgeCounts[edgeKey(result[i + e], result[i + (e + 1) % 3])];
+		}
+	}
+
+	std::vector<bool> isLocked(vertexCount, false);
+
+	for (size_t i{}; i + 2 < result.size(); i += 3)
+	{
+		for (size_t e{}; e < 3; ++e)
+		{
+			const uint32_t a = result[i + e];
+			const uint32_t b = result[i + (e + 1) % 3];
+			auto twin = edgeCounts.find(edgeKey(b, a));
+
+			if (edgeCounts[edgeKey(a, b)] != 1 || twin == edgeCounts.end() || twin->second != 1)
+			{
+				isLocked[a] = true;
+				isLocked[b] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+
+	for (size_t i{}; i + 2 < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[result[i + 0]].pos;
+		const glm::vec3& p1 = vertices[result[i + 1]].pos;
+		const glm::vec3& p2 = vertices[result[i + 2]].pos;
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+
+		normal /= length;
+
+		for (size_t c{}; c < 3; ++c)
+		{
+			AddPlane(quadrics[result[i + c]], normal, -glm::dot(normal, p0), length * 0.5f);
+		}
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double largestCost = 0.0;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> isTouched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+
+	while (result.size() > targetIndexCount)
+	{
+		const size_t triangleCount = result.size() / 3;
+
+		// Vertex to triangle adjacency of the current pass, used for the flip test
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result)
+		{
+			++adjacencyOffsets[index + 1];
+		}
+		for (size_t v{}; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t{}; t < triangleCount; ++t)
+		{
+			for (size_t c{}; c < 3; ++c)
+			{
+				adjacency[fill[result[t * 3 + c]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		collapses.clear();
+
+		for (size_t t{}; t < triangleCount; ++t)
+		{
+			for (size_t e{}; e < 3; ++e)
+			{
+				const uint32_t a = result[t * 3 + e];
+				const uint32_t b = result[t * 3 + (e + 1) % 3];
+
+				if (a == b)
+				{
+					continue;
+				}
+
+				Quadric merged = quadrics[a];
+				AddQuadric(merged, quadrics[b]);
+
+				if (!isLocked[a])
+				{
+					collapses.push_back({ a, b, EvaluateQuadric(merged, vertices[b].pos) });
+				}
+				if (!isLocked[b])
+				{
+					collapses.push_back({ b, a, EvaluateQuadric(merged, vertices[a].pos) });
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(isTouched.begin(), isTouched.end(), false);
+
+		// Every collapse of an interior edge removes two triangles
+		const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		bool isErrorLimitReached = false;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (trianglesRemoved >= trianglesToRemove)
+			{
+				break;
+			}
+
+			if (collapse.cost > maxCost)
+			{
+				isErrorLimitReached = true;
+				break;
+			}
+
+			if (isTouched[collapse.from] || isTouched[collapse.to])
+			{
+				continue;
+			}
+
+			// Reject the collapse if any triangle that survives it would turn over or tilt by more than 60 degrees
+			const glm::vec3& target = vertices[collapse.to].pos;
+			bool isFlipping = false;
+
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !isFlipping; ++a)
+			{
+				const uint32_t* pTriangle = &result[adjacency[a] * 3];
+
+				if (pTriangle[0] == collapse.to || pTriangle[1] == collapse.to || pTriangle[2] == collapse.to)
+				{
+					continue;
+				}
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (size_t c{}; c < 3; ++c)
+				{
+					before[c] = vertices[pTriangle[c]].pos;
+					after[c] = pTriangle[c] == collapse.from ? target : before[c];
+				}
+
+				const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+				isFlipping = glm::dot(normalBefore, normalAfter) <= 0.5f * glm::length(normalBefore) * glm::length(normalAfter);
+			}
+
+			if (isFlipping)
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			largestCost = std::max(largestCost, collapse.cost);
+			trianglesRemoved += 2;
+
+			// Freeze the whole neighbourhood so the adjacency and flip tests stay valid for the rest of the pass
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a)
+			{
+				for (size_t c{}; c < 3; ++c)
+				{
+					isTouched[result[adjacency[a] * 3 + c]] = true;
+				}
+			}
+		}
+
+		if (trianglesRemoved == 0)
+		{
+			break;
+		}
+
+		std::vector<uint32_t> collapsed;
+		collapsed.reserve(result.size());
+
+		for (size_t t{}; t < triangleCount; ++t)
+		{
+			const uint32_t a = remap[result[t * 3 + 0]];
+			const uint32_t b = remap[result[t * 3 + 1]];
+			const uint32_t c = remap[result[t * 3 + 2]];
+
+			if (a != b && b != c && a != c)
+			{
+				collapsed.insert(collapsed.end(), { a, b, c });
+			}
+		}
+
+		result.swap(collapsed);
+
+		if (isErrorLimitReached)
+		{
+			break;
+		}
+	}
+
+	resultError = static_cast<float>(std::sqrt(largestCost));
+
+	return result;
+}
+
+void MeshOptimizer::AddPlane(Quadric& quadric, const glm::vec3& normal, float distance, float weight)
+{
+	const double a = normal.x;
+	const double b = normal.y;
+	const double c = normal.z;
+	const double d = distance;
+
+	quadric.a2 += a * a * weight;
+	quadric.ab += a * b * weight;
+	quadric.ac += a * c * weight;
+	quadric.ad += a * d * weight;
+	quadric.b2 += b * b * weight;
+	quadric.bc += b * c * weight;
+	quadric.bd += b * d * weight;
+	quadric.c2 += c * c * weight;
+	quadric.cd += c * d * weight;
+	quadric.d2 += d * d * weight;
+	quadric.weight += weight;
+}
+
+void MeshOptimizer::AddQuadric(Quadric& target, const Quadric& source)
+{
+	target.a2 += source.a2;
+	target.ab += source.ab;
+	target.ac += source.ac;
+	target.ad += source.ad;
+	target.b2 += source.b2;
+	target.bc += source.bc;
+	target.bd += source.bd;
+	target.c2 += source.c2;
+	target.cd += source.cd;
+	target.d2 += source.d2;
+	target.weight += source.weight;
+}
+
+double MeshOptimizer::EvaluateQuadric(const Quadric& quadric, const glm::vec3& point)
+{
+	if (quadric.weight <= 0.0)
+	{
+		return 0.0;
+	}
+
+	const double x = point.x;
+	const double y = point.y;
+	const double z = point.z;
+
+	const double error = quadric.a2 * x * x + 2.0 * quadric.ab * x * y + 2.0 * quadric.ac * x * z + 2.0 * quadric.ad * x
+		+ quadric.b2 * y * y + 2.0 * quadric.bc * y * z + 2.0 * quadric.bd * y
+		+ quadric.c2 * z * z + 2.0 * quadric.cd * z
+		+ quadric.d2;
+
+	// Rounding can push a point on every plane slightly below zero
+	return std::max(error, 0.0) / quadric.weight;
+}
+
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return meshlets;
+	}
+
+	// Tags every vertex with the last meshlet that used it, avoids clearing a set per meshlet
+	std::vector<uint32_t> meshletTag(vertices.size(), UINT32_MAX);
+	uint32_t meshletVertexCount = 0;
+
+	Meshlet current{};
+
+	auto closeMeshlet = [&]()
+	{
+		ComputeMeshletBounds(current, indices, vertices);
+		meshlets.push_back(current);
+
+		current = Meshlet{};
+		current.firstIndex = static_cast<uint32_t>(meshlets.back().firstIndex + meshlets.back().indexCount);
+		meshletVertexCount = 0;
+	};
+
+	for (size_t t{}; t < triangleCount; ++t)
+	{
+		const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+
+		uint32_t newVertices = 0;
+		for (size_t c{}; c < 3; ++c)
+		{
+			const uint32_t vertex = indices[t * 3 + c];
+			// A degenerate triangle may repeat a vertex, count it once
+			const bool isRepeat = (c > 0 && indices[t * 3] == vertex) || (c > 1 && indices[t * 3 + 1] == vertex);
+
+			if (meshletTag[vertex] != meshletIndex && !isRepeat)
+			{
+				++newVertices;
+			}
+		}
+
+		if (meshletVertexCount + newVertices > maxVertices || current.indexCount / 3 + 1 > maxTriangles)
+		{
+			closeMeshlet();
+			newVertices = 0;
+
+			for (size_t c{}; c < 3; ++c)
+			{
+				const uint32_t vertex = indices[t * 3 + c];
+				const bool isRepeat = (c > 0 && indices[t * 3] == vertex) || (c > 1 && indices[t * 3 + 1] == vertex);
+
+				if (!isRepeat)
+				{
+					++newVertices;
+				}
+			}
+		}
+
+		for (size_t c{}; c < 3; ++c)
+		{
+			meshletTag[indices[t * 3 + c]] = static_cast<uint32_t>(meshlets.size());
+		}
+
+		meshletVertexCount += newVertices;
+		current.indexCount += 3;
+	}
+
+	closeMeshlet();
+
+	return meshlets;
+}
+
+void MeshOptimizer::ComputeMeshletBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	const size_t begin = meshlet.firstIndex;
+	const size_t end = begin + meshlet.indexCount;
+
+	// Sphere around the box center, looser than a minimal sphere but cheap and stable
+	glm::vec3 minimum{ vertices[indices[begin]].pos };
+	glm::vec3 maximum{ minimum };
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		minimum = glm::min(minimum, vertices[indices[i]].pos);
+		maximum = glm::max(maximum, vertices[indices[i]].pos);
+	}
+
+	meshlet.center = (minimum + maximum) * 0.5f;
+	meshlet.radius = 0.0f;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.center));
+	}
+
+	// Normal cone from the area independent average of the triangle normals
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+	glm::vec3 axis{ 0.0f };
+
+	for (size_t i = begin; i + 2 < end; i += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[i + 0]].pos;
+		const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+
+		const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+
+		if (length > 0.0f)
+		{
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+	}
+
+	meshlet.coneAxis = glm::vec3{ 0.0f, 0.0f, 1.0f };
+	meshlet.coneCutoff = 1.0f;
+
+	const float axisLength = glm::length(axis);
+
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		return;
+	}
+
+	meshlet.coneAxis = axis / axisLength;
+
+	float minimumDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minimumDot = std::min(minimumDot, glm::dot(meshlet.coneAxis, normal));
+	}
+
+	// A cone wider than ~85 degrees can never be fully back facing in practice, leave it uncullable
+	if (minimumDot <= 0.1f)
+	{
+		return;
+	}
+
+	meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+// Load time index and vertex reordering, all functions work on triangle lists
+class MeshOptimizer
+{
+public:
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio, transformed vertices per triangle, 0.5 is the best a large mesh can do
+		float acmr;
+		// Average transformed vertex ratio, transformed vertices per unique vertex, 1.0 is ideal
+		float atvr;
+	};
+
+	// Simulates a FIFO post-transform cache of the given size
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Tipsify (Sander et al. 2007), returns the offsets in the index list where a new cluster starts
+	static std::vector<size_t> OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Orders the clusters from OptimizeVertexCache so the ones facing away from the mesh center are drawn first
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters);
+
+	// Renumbers vertices in first use order so vertex fetch walks memory linearly
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Quadric error edge collapse towards targetIndexCount, vertices only ever move onto other existing vertices so
+	// the result indexes the same vertex buffer, borders and attribute seams stay locked
+	// Stops early once a collapse would exceed maxError, resultError receives the largest deviation in mesh units
+	static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError, float& resultError);
+
+	// Splits the index list into meshlets in its current order, run it after the reordering above so they stay compact
+	static std::vector<Meshlet> BuildMeshlets(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+private:
+	// Symmetric 4x4 plane quadric, weighted by triangle area
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, weight;
+	};
+
+	static void AddPlane(Quadric& quadric, const glm::vec3& normal, float distance, float weight);
+	static void AddQuadric(Quadric& target, const Quadric& source);
+	// Mean squared distance of the point to the accumulated planes
+	static double EvaluateQuadric(const Quadric& quadric, const glm::vec3& point);
+
+	static void ComputeMeshletBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "Structs.h"
+#include "VertexPacker.h"
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <string>
@@ -13,23 +14,37 @@ class Model
 {
 public:
 	Model() = default;
+    // Textures are shared through the TextureRegistry, whoever acquired them releases them there
     ~Model()
     {
-		delete m_pTexture;
-		m_pTexture = nullptr;
-
-		delete m_pNormal;
-		m_pNormal = nullptr;
-
-		delete m_pMetalRough;
-		m_pMetalRough = nullptr;
-
 		delete m_pDescriptorSets;
 		m_pDescriptorSets = nullptr;
     };
 
+	// Empty once released, drawing only reads the counts and offsets below
 	std::vector<Vertex>& GetVertices() { return m_Vertices; }
 	std::vector<uint32_t>& GetIndices() { return m_Indices; }
+	// Frees the CPU copies of the streams after they were uploaded
+	void ReleaseGeometry()
+	{
+		std::vector<Vertex>().swap(m_Vertices);
+		std::vector<uint32_t>().swap(m_Indices);
+	}
+	// One transform per glTF node that references this mesh
+	std::vector<glm::mat4>& GetInstances() { return m_Instances; }
+	// Tile the index range of the model in order, used for per-cluster culling
+	std::vector<Meshlet>& GetMeshlets() { return m_Meshlets; }
+	const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+	// Level 0 is the full mesh, the index list holds every level back to back
+	std::vector<MeshLod>& GetLods() { return m_Lods; }
+	const std::vector<MeshLod>& GetLods() const { return m_Lods; }
+	// Mesh space center in xyz, radius in w
+	const glm::vec4& GetBoundingSphere() const { return m_BoundingSphere; }
+	const std::vector<glm::mat4>& GetInstances() const { return m_Instances; }
+	// Offset in xyz and scale in w the vertex buffer's positions were quantized with, 0, 0, 0, 1 when they are not
+	const glm::vec4& GetDequantization() const { return m_Dequantization; }
+	// What the instance buffer holds, the node transform applied after dequantizing the positions
+	glm::mat4 GetInstanceTransform(uint32_t instance) const { return m_Instances[instance] * VertexPacker::GetDequantizationTransform(m_Dequantization); }
 
 	std::string& GetDiffuseTexturePath() { return m_DiffusePath; }
 	std::string& GetNormalTexturePath() { return m_NormalPath; }
@@ -37,11 +52,45 @@ public:
 
     uint32_t GetFirstIndex() const { return m_FirstIndex; }
     uint32_t GetVertexOffset() const { return m_VertexOffset; }
+    uint32_t GetIndexCount() const { return m_IndexCount; }
+    uint32_t GetVertexCount() const { return m_VertexCount; }
+    uint32_t GetFirstInstance() const { return m_FirstInstance; }
+    // Block of the geometry arena the vertex offset and first index are in, UINT32_MAX while the model is in none
+    uint32_t GetGeometryBlock() const { return m_GeometryBlock; }
+    uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_Instances.size()); }
 
 	Texture* GetDiffuseTexture() { return m_pTexture; }
 	Texture* GetNormalTexture() { return m_pNormal; }
 	Texture* GetMetalRoughTexture() { return m_pMetalRough; }
 
+	std::string& GetTexturePath(TextureSlot slot)
+	{
+		switch (slot)
+		{
+		case TextureSlot::Normal: return m_NormalPath;
+		case TextureSlot::MetalRough: return m_MetalRoughPath;
+		default: return m_DiffusePath;
+		}
+	}
+	Texture* GetTexture(TextureSlot slot)
+	{
+		switch (slot)
+		{
+		case TextureSlot::Normal: return m_pNormal;
+		case TextureSlot::MetalRough: return m_pMetalRough;
+		default: return m_pTexture;
+		}
+	}
+	void SetTexture(TextureSlot slot, Texture* pTexture)
+	{
+		switch (slot)
+		{
+		case TextureSlot::Normal: m_pNormal = pTexture; break;
+		case TextureSlot::MetalRough: m_pMetalRough = pTexture; break;
+		default: m_pTexture = pTexture; break;
+		}
+	}
+
 	DescriptorSets* GetDescriptorSets() { return m_pDescriptorSets; }
 	bool IsTransparent() const { return m_IsTransparent; }
 
@@ -53,12 +102,23 @@ public:
 
     void SetFirstIndex(uint32_t index) { m_FirstIndex = index; }
     void SetVertexOffset(uint32_t offset) { m_VertexOffset = offset; }
+    void SetIndexCount(uint32_t count) { m_IndexCount = count; }
+    void SetVertexCount(uint32_t count) { m_VertexCount = count; }
+    void SetFirstInstance(uint32_t instance) { m_FirstInstance = instance; }
+    void SetGeometryBlock(uint32_t block) { m_GeometryBlock = block; }
+    void SetBoundingSphere(const glm::vec4& sphere) { m_BoundingSphere = sphere; }
+    void SetDequantization(const glm::vec4& dequantization) { m_Dequantization = dequantization; }
 
 	void SetTransparent(bool isTransparent) { m_IsTransparent = isTransparent; }
 
 private:
     std::vector<Vertex> m_Vertices;
     std::vector<uint32_t> m_Indices;
+    std::vector<glm::mat4> m_Instances;
+    std::vector<Meshlet> m_Meshlets;
+    std::vector<MeshLod> m_Lods;
+    glm::vec4 m_BoundingSphere{ 0.0f };
+    glm::vec4 m_Dequantization{ 0.0f, 0.0f, 0.0f, 1.0f };
     std::string m_DiffusePath;
     std::string m_NormalPath;
 	std::string m_MetalRoughPath;
@@ -71,6 +131,10 @@ private:
 
     uint32_t m_FirstIndex = 0;
     uint32_t m_VertexOffset = 0;
+    uint32_t m_IndexCount = 0;
+    uint32_t m_VertexCount = 0;
+    uint32_t m_FirstInstance = 0;
+    uint32_t m_GeometryBlock = UINT32_MAX;
 
 	bool m_IsTransparent = false;
 };
\ No newline at end of file
@@ -1,100 +1,797 @@
 #include "ModelLoader.h"
+#include "MappedFile.h"
+#include "VertexWelder.h"
+#include "MeshOptimizer.h"
+#include "TextureCooker.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #include <glm/gtx/quaternion.hpp>
+#include "json.hpp"
 #include <unordered_map>
 #include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <numeric>
+#include <cstring>
+
+// Textures are decoded later by Texture itself, tinygltf only has to parse the document
+static bool SkipImageData(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+{
+    return true;
+}
+
+void LoadedTexture::Release()
+{
+    Texture::FreePixels(pPixels);
+    pPixels = nullptr;
+
+    delete pCooked;
+    pCooked = nullptr;
+}
 
 ModelLoader::ModelLoader()
 {}
 
 ModelLoader::~ModelLoader()
 {
+    if (m_LoadThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock{ m_LoadMutex };
+            m_IsCancelling = true;
+        }
+        m_LoadCondition.notify_all();
+        m_LoadThread.join();
+    }
+
+    // Whatever was never taken still belongs to the loader
+    for (Model* pModel : m_pLoadedModels)
+    {
+        delete pModel;
+    }
+    m_pLoadedModels.clear();
+
+    for (LoadedTexture& texture : m_LoadedTextures)
+    {
+        texture.Release();
+    }
+    m_LoadedTextures.clear();
+
+    delete m_pMeshCache;
+    m_pMeshCache = nullptr;
+
+    delete m_pThreadPool;
+    m_pThreadPool = nullptr;
+
+    ReleaseGlb();
 }
 
 std::vector<Model*> ModelLoader::LoadModel(const std::string& modelPath)
 {
     std::string extension = modelPath.substr(modelPath.find_last_of('.') + 1);
 
-    if (extension == "obj")
+    // Streams built with different settings are cached separately
+    const uint32_t settings = (m_IsOptimizingMeshes ? 1u : 0u) | (m_IsGeneratingLods ? 2u : 0u);
+
+    delete m_pMeshCache;
+    m_pMeshCache = new MeshCache(modelPath, settings);
+
+    std::vector<Model*> models;
+    m_MeshStats.clear();
+
+    // Baked streams are up to date, skip parsing entirely
+    if (m_pMeshCache->Load(models))
+    {
+        return models;
+    }
+
+    if (extension == "obj")
+    {
+        models = LoadModelObj(modelPath);
+    }
+    else if (extension == "gltf")
+    {
+        models = LoadModelGltf(modelPath);
+    }
+    else if (extension == "glb")
+    {
+        models = LoadModelGlb(modelPath);
+    }
+    else
+    {
+        throw std::runtime_error("Unsupported file format: " + extension);
+    }
+
+    AssignBufferRanges(models);
+    m_pMeshCache->Save(models);
+
+	return models;
+}
+
+void ModelLoader::LoadModelAsync(const std::string& modelPath)
+{
+    if (m_LoadThread.joinable())
+    {
+        throw std::runtime_error("an asynchronous load is already running!");
+    }
+
+    m_IsLoadingAsync = true;
+    m_IsLoadThreadDone = false;
+    m_IsCancelling = false;
+    m_IsGeometryDone = false;
+
+    m_LoadThread = std::thread(&ModelLoader::RunAsyncLoad, this, modelPath);
+}
+
+void ModelLoader::LoadTexturesAsync(const std::vector<Model*>& models)
+{
+    if (m_LoadThread.joinable())
+    {
+        throw std::runtime_error("an asynchronous load is already running!");
+    }
+
+    m_IsLoadThreadDone = false;
+    m_IsCancelling = false;
+
+    m_LoadThread = std::thread(&ModelLoader::RunTextureLoad, this, models);
+}
+
+bool ModelLoader::TakeLoadedModels(std::vector<Model*>& models)
+{
+    std::lock_guard<std::mutex> lock{ m_LoadMutex };
+
+    if (m_LoadError)
+    {
+        std::exception_ptr error = m_LoadError;
+        m_LoadError = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    if (m_pLoadedModels.empty())
+    {
+        return false;
+    }
+
+    models.insert(models.end(), m_pLoadedModels.begin(), m_pLoadedModels.end());
+    m_pLoadedModels.clear();
+
+    return true;
+}
+
+bool ModelLoader::TakeLoadedTexture(LoadedTexture& texture)
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_LoadMutex };
+
+        if (m_LoadedTextures.empty())
+        {
+            return false;
+        }
+
+        texture = m_LoadedTextures.front();
+        m_LoadedTextures.pop_front();
+    }
+
+    // Room for the next decoded image
+    m_LoadCondition.notify_all();
+
+    return true;
+}
+
+bool ModelLoader::WaitForLoadedTextures()
+{
+    std::unique_lock<std::mutex> lock{ m_LoadMutex };
+    m_LoadCondition.wait(lock, [this]() { return m_IsLoadThreadDone || m_LoadError || !m_LoadedTextures.empty(); });
+
+    if (m_LoadError)
+    {
+        std::exception_ptr error = m_LoadError;
+        m_LoadError = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    return !m_LoadedTextures.empty();
+}
+
+bool ModelLoader::IsAsyncLoadFinished()
+{
+    std::lock_guard<std::mutex> lock{ m_LoadMutex };
+    return m_IsLoadThreadDone && !m_LoadError && m_pLoadedModels.empty() && m_LoadedTextures.empty();
+}
+
+void ModelLoader::RunAsyncLoad(const std::string& modelPath)
+{
+    try
+    {
+        const std::string extension = modelPath.substr(modelPath.find_last_of('.') + 1);
+        const uint32_t settings = (m_IsOptimizingMeshes ? 1u : 0u) | (m_IsGeneratingLods ? 2u : 0u);
+
+        delete m_pMeshCache;
+        m_pMeshCache = new MeshCache(modelPath, settings);
+
+        std::vector<Model*> models;
+        m_MeshStats.clear();
+
+        if (m_pMeshCache->Load(models))
+        {
+            // The renderer reads the baked streams straight from the mapping, which stays until the loader is destroyed
+            for (Model* pModel : models)
+            {
+                PublishModel(pModel);
+            }
+        }
+        else
+        {
+            // Every loader publishes its models itself as they are finished
+            if (extension == "obj")
+            {
+                models = LoadModelObj(modelPath);
+            }
+            else if (extension == "gltf")
+            {
+                models = LoadModelGltf(modelPath);
+            }
+            else if (extension == "glb")
+            {
+                models = LoadModelGlb(modelPath);
+            }
+            else
+            {
+                throw std::runtime_error("Unsupported file format: " + extension);
+            }
+
+            if (!m_IsCancelling)
+            {
+                // The renderer may already own these models, only read them from here on
+                std::vector<Model*> cacheOrder = models;
+                std::stable_partition(cacheOrder.begin(), cacheOrder.end(), [](const Model* pModel) { return !pModel->IsTransparent(); });
+                m_pMeshCache->Save(cacheOrder);
+
+                PrintMeshOptimizationReport();
+            }
+        }
+
+        m_IsGeometryDone = true;
+
+        // Geometry is all out, textures follow
+        if (!m_IsCancelling)
+        {
+            LoadTextures(models);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{ m_LoadMutex };
+        m_LoadError = std::current_exception();
+    }
+
+    FinishLoadThread();
+}
+
+void ModelLoader::RunTextureLoad(std::vector<Model*> models)
+{
+    try
+    {
+        LoadTextures(models);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{ m_LoadMutex };
+        m_LoadError = std::current_exception();
+    }
+
+    FinishLoadThread();
+}
+
+void ModelLoader::FinishLoadThread()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_LoadMutex };
+        m_IsLoadThreadDone = true;
+    }
+
+    // Also after an error or a cancellation
+    m_IsGeometryDone = true;
+
+    // Wakes a renderer waiting for the next texture
+    m_LoadCondition.notify_all();
+}
+
+void ModelLoader::LoadTextures(const std::vector<Model*>& models)
+{
+    // In the order the models were handed out, each image decoded once
+    // Cooked files differ per slot, so then every slot an image is bound to is its own texture
+    std::vector<LoadedTexture> textures;
+    std::unordered_map<std::string, size_t> textureIndices;
+
+    auto addUser = [&](Model* pModel, TextureSlot slot, const std::string& texturePath)
+    {
+        if (texturePath.empty())
+        {
+            return;
+        }
+
+        const std::string key = m_IsCookingTextures ? TextureCooker::GetCookedPath(texturePath, slot) : texturePath;
+
+        auto [it, isNew] = textureIndices.try_emplace(key, textures.size());
+        if (isNew)
+        {
+            textures.emplace_back().path = texturePath;
+        }
+
+        textures[it->second].users.push_back({ pModel, slot });
+    };
+
+    for (Model* pModel : models)
+    {
+        addUser(pModel, TextureSlot::Diffuse, pModel->GetDiffuseTexturePath());
+        addUser(pModel, TextureSlot::Normal, pModel->GetNormalTexturePath());
+        addUser(pModel, TextureSlot::MetalRough, pModel->GetMetalRoughTexturePath());
+    }
+
+    if (!m_pThreadPool)
+    {
+        m_pThreadPool = new ThreadPool{};
+    }
+
+    // Every worker decodes a different image, PublishTexture holds them back once enough wait for upload
+    m_pThreadPool->ParallelFor(textures.size(), [&](size_t i)
+    {
+        if (!m_IsCancelling)
+        {
+            PublishTexture(textures[i]);
+        }
+    });
+}
+
+void ModelLoader::PublishModel(Model* pModel)
+{
+    // Obj models and anything not placed by a node are drawn once as is
+    if (pModel->GetInstances().empty())
+    {
+        pModel->GetInstances().push_back(glm::mat4(1.0f));
+    }
+
+    std::lock_guard<std::mutex> lock{ m_LoadMutex };
+    m_pLoadedModels.push_back(pModel);
+}
+
+void ModelLoader::PublishTexture(LoadedTexture& texture)
+{
+    // A cooked file is only mapped, the image is decoded at most once when it has to be cooked
+    if (m_IsCookingTextures)
+    {
+        texture.pCooked = TextureCooker::Load(texture.path, texture.users.front().slot);
+    }
+    else
+    {
+        texture.pPixels = Texture::LoadPixels(texture.path, &texture.width, &texture.height);
+    }
+
+    if (!texture.pPixels && !texture.pCooked)
+    {
+        throw std::runtime_error("failed to load texture image!");
+    }
+
+    std::unique_lock<std::mutex> lock{ m_LoadMutex };
+    m_LoadCondition.wait(lock, [this]() { return m_IsCancelling || m_LoadedTextures.size() < m_MaxQueuedTextures; });
+
+    if (m_IsCancelling)
+    {
+        texture.Release();
+        return;
+    }
+
+    m_LoadedTextures.push_back(std::move(texture));
+    lock.unlock();
+
+    m_LoadCondition.notify_all();
+}
+
+std::vector<Model*> ModelLoader::LoadModelObj(const std::string& modelPath)
+{
+	std::vector<Model*> models;
+    m_MeshStats.clear();
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str()))
+    {
+        throw std::runtime_error(err);
+    }
+
+    for (const auto& shape : shapes)
+    {
+		// Create a new model
+		models.push_back(new Model{});
+		Model& model = *models.back();
+
+        // One welder per shape, indices must only refer to this model's vertices
+        VertexWelder welder{ model.GetVertices(), shape.mesh.indices.size() };
+        model.GetIndices().reserve(shape.mesh.indices.size());
+
+        for (const auto& index : shape.mesh.indices)
+        {
+            Vertex vertex{};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            model.GetIndices().push_back(welder.Insert(vertex));
+        }
+
+        if (m_IsOptimizingMeshes)
+        {
+            OptimizeMesh(model, m_MeshStats.emplace_back());
+        }
+
+        BuildLods(model);
+
+        model.SetVertexCount(static_cast<uint32_t>(model.GetVertices().size()));
+        model.SetIndexCount(static_cast<uint32_t>(model.GetIndices().size()));
+
+        if (m_IsLoadingAsync)
+        {
+            PublishModel(&model);
+        }
+    }
+
+	return models;
+}
+
+std::vector<Model*> ModelLoader::LoadModelGltf(const std::string& modelPath)
+{
+    tinygltf::Model gltfModel{};
+    ParseGltf(modelPath, gltfModel);
+
+    return ExtractPrimitives(gltfModel, modelPath, m_IsParallelLoading);
+}
+
+std::vector<Model*> ModelLoader::LoadModelGlb(const std::string& modelPath)
+{
+    tinygltf::Model gltfModel{};
+    ParseGlb(modelPath, gltfModel);
+
+    std::vector<Model*> models = ExtractPrimitives(gltfModel, modelPath, m_IsParallelLoading);
+
+    // Everything was decoded into the models, the mapping is no longer needed
+    ReleaseGlb();
+
+    return models;
+}
+
+void ModelLoader::BenchmarkPrimitiveExtraction(const std::string& modelPath, int iterations)
+{
+    if (iterations <= 0)
+    {
+        return;
+    }
+
+    tinygltf::Model gltfModel{};
+    const bool isBinary = modelPath.substr(modelPath.find_last_of('.') + 1) == "glb";
+
+    if (isBinary)
+    {
+        ParseGlb(modelPath, gltfModel);
+    }
+    else
+    {
+        ParseGltf(modelPath, gltfModel);
+    }
+
+    auto timeExtraction = [&](bool isParallel, std::vector<Model*>& models)
+    {
+        double totalMs = 0.0;
+
+        for (int i{}; i < iterations; ++i)
+        {
+            for (Model* pModel : models)
+            {
+                delete pModel;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            models = ExtractPrimitives(gltfModel, modelPath, isParallel);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        return totalMs / iterations;
+    };
+
+    std::vector<Model*> serialModels;
+    std::vector<Model*> parallelModels;
+
+    double serialMs = timeExtraction(false, serialModels);
+    double parallelMs = timeExtraction(true, parallelModels);
+
+    // Both paths must produce bit identical streams
+    bool isIdentical = serialModels.size() == parallelModels.size();
+    for (size_t i{}; isIdentical && i < serialModels.size(); ++i)
+    {
+        const auto& serialVertices = serialModels[i]->GetVertices();
+        const auto& parallelVertices = parallelModels[i]->GetVertices();
+        const auto& serialIndices = serialModels[i]->GetIndices();
+        const auto& parallelIndices = parallelModels[i]->GetIndices();
+
+        isIdentical = serialVertices.size() == parallelVertices.size()
+            && serialIndices.size() == parallelIndices.size()
+            && memcmp(serialVertices.data(), parallelVertices.data(), sizeof(Vertex) * serialVertices.size()) == 0
+            && memcmp(serialIndices.data(), parallelIndices.data(), sizeof(uint32_t) * serialIndices.size()) == 0;
+    }
+
+    std::cout << "Primitive extraction of " << modelPath << " (" << serialModels.size() << " primitives, " << iterations << " runs)\n";
+    std::cout << "\tserial:   " << serialMs << " ms\n";
+    std::cout << "\tparallel: " << parallelMs << " ms on " << m_pThreadPool->GetThreadCount() + 1 << " threads (" << serialMs / parallelMs << "x)\n";
+    std::cout << "\toutput " << (isIdentical ? "identical" : "MISMATCH") << '\n';
+
+    for (Model* pModel : serialModels)
+    {
+        delete pModel;
+    }
+    for (Model* pModel : parallelModels)
+    {
+        delete pModel;
+    }
+
+    ReleaseGlb();
+}
+
+void ModelLoader::BenchmarkVertexWelding(const std::string& modelPath, int iterations)
+{
+    if (iterations <= 0)
+    {
+        return;
+    }
+
+    const std::string extension = modelPath.substr(modelPath.find_last_of('.') + 1);
+    std::vector<Model*> models;
+
+    if (extension == "obj")
+    {
+        models = LoadModelObj(modelPath);
+    }
+    else
+    {
+        tinygltf::Model gltfModel{};
+
+        if (extension == "glb")
+        {
+            ParseGlb(modelPath, gltfModel);
+        }
+        else
+        {
+            ParseGltf(modelPath, gltfModel);
+        }
+
+        models = ExtractPrimitives(gltfModel, modelPath, m_IsParallelLoading);
+        ReleaseGlb();
+    }
+
+    // Expand every model back into the unindexed stream the loaders weld
+    std::vector<std::vector<Vertex>> streams;
+    size_t streamVertexCount = 0;
+
+    for (Model* pModel : models)
+    {
+        std::vector<Vertex>& stream = streams.emplace_back();
+
+        // Only level 0, the other levels index the same vertices
+        const uint32_t indexCount = pModel->GetLods().empty() ? pModel->GetIndexCount() : pModel->GetLods()[0].indexCount;
+        stream.reserve(indexCount);
+
+        for (uint32_t i{}; i < indexCount; ++i)
+        {
+            stream.push_back(pModel->GetVertices()[pModel->GetIndices()[i]]);
+        }
+
+        streamVertexCount += stream.size();
+        delete pModel;
+    }
+
+    size_t mapUniqueCount = 0;
+    size_t welderUniqueCount = 0;
+
+    // The previous approach, std::hash<Vertex> with a count and an operator[] lookup per index
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i{}; i < iterations; ++i)
+    {
+        mapUniqueCount = 0;
+
+        for (const std::vector<Vertex>& stream : streams)
+        {
+            std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+
+            for (const Vertex& vertex : stream)
+            {
+                if (uniqueVertices.count(vertex) == 0)
+                {
+                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                }
+
+                indices.push_back(uniqueVertices[vertex]);
+            }
+
+            mapUniqueCount += vertices.size();
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double mapMs = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i{}; i < iterations; ++i)
+    {
+        welderUniqueCount = 0;
+
+        for (const std::vector<Vertex>& stream : streams)
+        {
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            indices.reserve(stream.size());
+
+            VertexWelder welder{ vertices, stream.size() };
+
+            for (const Vertex& vertex : stream)
+            {
+                indices.push_back(welder.Insert(vertex));
+            }
+
+            welderUniqueCount += vertices.size();
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const double welderMs = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+    std::cout << "Vertex welding of " << modelPath << " (" << streamVertexCount << " vertices, " << iterations << " runs)\n";
+    std::cout << "\tunordered_map: " << mapMs << " ms, " << mapUniqueCount << " unique\n";
+    std::cout << "\tVertexWelder:  " << welderMs << " ms, " << welderUniqueCount << " unique (" << mapMs / welderMs << "x)\n";
+}
+
+void ModelLoader::ParseGltf(const std::string& modelPath, tinygltf::Model& gltfModel)
+{
+    tinygltf::TinyGLTF loader{};
+    loader.SetImageLoader(SkipImageData, nullptr);
+    std::string error{}, warn{};
+
+    bool result = loader.LoadASCIIFromFile(&gltfModel, &error, &warn, modelPath);
+
+    if (!warn.empty())
     {
-        return LoadModelObj(modelPath);
+        throw std::runtime_error("gltf Warning: " + warn);
     }
-    else if (extension == "gltf")
+
+    if (!error.empty())
     {
-        return LoadModelGltf(modelPath);
+        throw std::runtime_error("gltf Error: " + error);
     }
-    else
+
+    if (!result)
     {
-        throw std::runtime_error("Unsupported file format: " + extension);
+        throw std::runtime_error("Unable to load model");
     }
-
-	return std::vector<Model*>{};
 }
 
-std::vector<Model*> ModelLoader::LoadModelObj(const std::string& modelPath)
+void ModelLoader::ParseGlb(const std::string& modelPath, tinygltf::Model& gltfModel)
 {
-	std::vector<Model*> models;
+    ReleaseGlb();
+    m_pGlbFile = new MappedFile(modelPath);
 
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    if (!m_pGlbFile->IsValid())
+    {
+        throw std::runtime_error("failed to map glb file: " + modelPath);
+    }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str()))
+    const unsigned char* pData = m_pGlbFile->GetData();
+    const size_t fileSize = m_pGlbFile->GetSize();
+
+    // 12 byte header followed by a JSON chunk and an optional BIN chunk, every chunk starts with its length and type
+    const uint32_t glbMagic = 0x46546C67; // "glTF"
+    const uint32_t jsonChunkType = 0x4E4F534A; // "JSON"
+    const uint32_t binChunkType = 0x004E4942; // "BIN\0"
+
+    auto readUint = [pData](size_t offset)
     {
-        throw std::runtime_error(err);
+        uint32_t value{};
+        memcpy(&value, pData + offset, sizeof(uint32_t));
+        return value;
+    };
+
+    if (fileSize < 20 || readUint(0) != glbMagic || readUint(4) != 2 || readUint(8) > fileSize)
+    {
+        throw std::runtime_error("invalid glb header: " + modelPath);
     }
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    const size_t jsonLength = readUint(12);
+    const size_t jsonOffset = 20;
 
-    for (const auto& shape : shapes)
+    if (readUint(16) != jsonChunkType || jsonOffset + jsonLength > fileSize)
     {
-		// Create a new model
-		models.push_back(new Model{});
-		Model& model = *models.back();
+        throw std::runtime_error("invalid glb json chunk: " + modelPath);
+    }
 
-        for (const auto& index : shape.mesh.indices)
+    const size_t binHeaderOffset = jsonOffset + jsonLength;
+    const unsigned char* pBinaryChunk = nullptr;
+    size_t binOffset = 0;
+
+    if (binHeaderOffset + 8 <= fileSize && readUint(binHeaderOffset + 4) == binChunkType)
+    {
+        binOffset = binHeaderOffset + 8;
+
+        if (binOffset + readUint(binHeaderOffset) > fileSize)
         {
-            Vertex vertex{};
+            throw std::runtime_error("invalid glb bin chunk: " + modelPath);
+        }
 
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
+        pBinaryChunk = pData + binOffset;
+    }
 
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+    // tinygltf would copy the whole BIN chunk into buffer 0, point that buffer at a one byte data URI instead
+    // and resolve its accessors against the mapping, embedded images get a path into the mapped file
+    nlohmann::json document = nlohmann::json::parse(pData + jsonOffset, pData + jsonOffset + jsonLength);
+    const std::string placeholderUri = "data:application/octet-stream;base64,AA==";
 
-            vertex.color = { 1.0f, 1.0f, 1.0f };
+    if (pBinaryChunk && document.contains("buffers") && !document["buffers"].empty() && !document["buffers"][0].contains("uri"))
+    {
+        document["buffers"][0]["uri"] = placeholderUri;
+        document["buffers"][0]["byteLength"] = 1;
+        m_pBinaryChunk = pBinaryChunk;
+    }
+
+    if (document.contains("images"))
+    {
+        nlohmann::json& images = document["images"];
+        m_EmbeddedImagePaths.resize(images.size());
+
+        for (size_t i{}; i < images.size(); ++i)
+        {
+            if (!images[i].contains("bufferView"))
+            {
+                continue;
+            }
 
-            if (uniqueVertices.count(vertex) == 0)
+            const nlohmann::json& bufferView = document["bufferViews"][images[i]["bufferView"].get<int>()];
+
+            if (bufferView.value("buffer", 0) != 0 || !m_pBinaryChunk)
             {
-                uniqueVertices[vertex] = static_cast<uint32_t>(model.GetVertices().size());
-                model.GetVertices().push_back(vertex);
+                throw std::runtime_error("glb image outside of the binary chunk: " + modelPath);
             }
 
-            model.GetIndices().push_back(uniqueVertices[vertex]);
+            const size_t imageOffset = binOffset + bufferView.value("byteOffset", size_t{ 0 });
+            const size_t imageSize = bufferView["byteLength"].get<size_t>();
+            m_EmbeddedImagePaths[i] = modelPath + "#" + std::to_string(imageOffset) + ":" + std::to_string(imageSize);
+
+            images[i].erase("bufferView");
+            images[i]["uri"] = placeholderUri;
         }
     }
 
-	return models;
-}
-
-std::vector<Model*> ModelLoader::LoadModelGltf(const std::string& modelPath)
-{
-    std::vector<Model*> models;
+    const std::string json = document.dump();
 
     tinygltf::TinyGLTF loader{};
-    tinygltf::Model gltfModel{};
+    loader.SetImageLoader(SkipImageData, nullptr);
     std::string error{}, warn{};
 
-    bool result = loader.LoadASCIIFromFile(&gltfModel, &error, &warn, modelPath);
+    bool result = loader.LoadASCIIFromString(&gltfModel, &error, &warn, json.c_str(), static_cast<unsigned int>(json.size()), GetFolderPath(modelPath));
 
     if (!warn.empty())
     {
@@ -110,112 +807,416 @@ std::vector<Model*> ModelLoader::LoadModelGltf(const std::string& modelPath)
     {
         throw std::runtime_error("Unable to load model");
     }
+}
+
+void ModelLoader::ReleaseGlb()
+{
+    delete m_pGlbFile;
+    m_pGlbFile = nullptr;
+
+    m_pBinaryChunk = nullptr;
+    m_EmbeddedImagePaths.clear();
+}
+
+const unsigned char* ModelLoader::GetBufferData(const tinygltf::Model& gltfModel, int bufferIndex) const
+{
+    // Buffer 0 of a glb file lives in the mapped BIN chunk
+    if (bufferIndex == 0 && m_pBinaryChunk)
+    {
+        return m_pBinaryChunk;
+    }
+
+    return gltfModel.buffers[bufferIndex].data.data();
+}
+
+std::string ModelLoader::GetImagePath(const tinygltf::Model& gltfModel, int imageIndex, const std::string& folderPath) const
+{
+    if (imageIndex < static_cast<int>(m_EmbeddedImagePaths.size()) && !m_EmbeddedImagePaths[imageIndex].empty())
+    {
+        return m_EmbeddedImagePaths[imageIndex];
+    }
+
+    return folderPath + gltfModel.images[imageIndex].uri;
+}
+
+std::vector<Model*> ModelLoader::ExtractPrimitives(const tinygltf::Model& gltfModel, const std::string& modelPath, bool isParallel)
+{
+    std::vector<Model*> models;
+    std::vector<PrimitiveJob> jobs;
+    std::unordered_map<int, std::vector<Model*>> meshModels;
 
+    // Flatten the hierarchy first, this creates every model with its streams sized up front
     const tinygltf::Scene& scene = gltfModel.scenes[gltfModel.defaultScene];
 
     for (int nodeIndex : scene.nodes)
     {
-        ProcessNode(gltfModel, nodeIndex, glm::mat4(1.0f), models, modelPath);
+        ProcessNode(gltfModel, nodeIndex, glm::mat4(1.0f), models, jobs, meshModels, modelPath);
+    }
+
+    // One slot per job so workers never share one
+    m_MeshStats.assign(jobs.size(), MeshOptimizationStats{});
+
+    auto runJob = [&](size_t i)
+    {
+        // A cancelled load still hands the model out so it is deleted with the rest
+        if (!m_IsCancelling)
+        {
+            DecodePrimitive(gltfModel, jobs[i], m_MeshStats[i]);
+        }
+
+        if (m_IsLoadingAsync)
+        {
+            PublishModel(jobs[i].pModel);
+        }
+    };
+
+    if (!isParallel)
+    {
+        for (size_t i{}; i < jobs.size(); ++i)
+        {
+            runJob(i);
+        }
+
+        return models;
+    }
+
+    if (!m_pThreadPool)
+    {
+        m_pThreadPool = new ThreadPool{};
     }
 
+    // Hand out the biggest primitives first so no worker is left with a huge one at the end
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b)
+    {
+        return jobs[a].pModel->GetVertexCount() > jobs[b].pModel->GetVertexCount();
+    });
+
+    // Every job writes only into its own model, so the result does not depend on scheduling
+    m_pThreadPool->ParallelFor(jobs.size(), [&](size_t i)
+    {
+        runJob(order[i]);
+    });
+
     return models;
 }
 
-void ModelLoader::FillVertices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, std::vector<Vertex>& vertices, const glm::mat4& transform)
+void ModelLoader::DecodePrimitive(const tinygltf::Model& gltfModel, const PrimitiveJob& job, MeshOptimizationStats& stats)
 {
-    // Find attributes in the primitive
-    auto posIt = primitive.attributes.find("POSITION");
-	auto normIt = primitive.attributes.find("NORMAL");
-	auto tanIt = primitive.attributes.find("TANGENT");
-    auto colIt = primitive.attributes.find("COLOR_0");
-    auto texIt = primitive.attributes.find("TEXCOORD_0");
+    Model& model = *job.pModel;
+
+    FillVertices(gltfModel, *job.pPrimitive, model.GetVertices().data());
+    FillIndices(gltfModel, *job.pPrimitive, model.GetIndices().data());
+
+    // Exporters often split vertices that end up identical after decoding
+    VertexWelder::Weld(model.GetVertices(), model.GetIndices());
+
+    if (m_IsOptimizingMeshes)
+    {
+        OptimizeMesh(model, stats);
+    }
+
+    BuildLods(model);
+
+    model.SetVertexCount(static_cast<uint32_t>(model.GetVertices().size()));
+    model.SetIndexCount(static_cast<uint32_t>(model.GetIndices().size()));
+}
+
+void ModelLoader::OptimizeMesh(Model& model, MeshOptimizationStats& stats) const
+{
+    std::vector<Vertex>& vertices = model.GetVertices();
+    std::vector<uint32_t>& indices = model.GetIndices();
+
+    stats.vertexCount = static_cast<uint32_t>(vertices.size());
+    stats.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    stats.before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+    // Overdraw sorting moves whole clusters, so the cache order inside each one survives
+    const std::vector<size_t> clusters = MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    MeshOptimizer::OptimizeOverdraw(indices, vertices, clusters);
+    MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+
+    stats.after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+}
+
+void ModelLoader::BuildLods(Model& model) const
+{
+    const std::vector<Vertex>& vertices = model.GetVertices();
+    std::vector<uint32_t>& indices = model.GetIndices();
+    std::vector<MeshLod>& lods = model.GetLods();
+    std::vector<Meshlet>& meshlets = model.GetMeshlets();
 
-    const float* posData = nullptr, * normData = nullptr, * tanData = nullptr, * texData = nullptr, * colData = nullptr;
-    size_t vertexCount = 0;
+    lods.clear();
+    meshlets.clear();
 
-    // Extract POSITION data
-    if (posIt != primitive.attributes.end())
+    if (indices.empty())
     {
-        const tinygltf::Accessor& accessor = gltfModel.accessors[posIt->second];
-        const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-        const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
+        return;
+    }
+
+    glm::vec3 minimum{ vertices[indices[0]].pos };
+    glm::vec3 maximum{ minimum };
 
-        posData = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-        vertexCount = accessor.count;
+    for (uint32_t index : indices)
+    {
+        minimum = glm::min(minimum, vertices[index].pos);
+        maximum = glm::max(maximum, vertices[index].pos);
     }
 
-	// Extract NORMAL data
-	if (normIt != primitive.attributes.end())
-	{
-		const tinygltf::Accessor& accessor = gltfModel.accessors[normIt->second];
-		const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
-		normData = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-	}
+    const glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radius = 0.0f;
 
-	// Extract TANGENT data
-	if (tanIt != primitive.attributes.end())
-	{
-		const tinygltf::Accessor& accessor = gltfModel.accessors[tanIt->second];
-		const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
-		tanData = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-	}
+    for (uint32_t index : indices)
+    {
+        radius = std::max(radius, glm::length(vertices[index].pos - center));
+    }
+
+    model.SetBoundingSphere(glm::vec4(center, radius));
+
+    // Every level simplifies level 0 directly so the errors do not stack up
+    const std::vector<uint32_t> baseIndices = indices;
+    const uint32_t lodCount = m_IsGeneratingLods ? m_MaxLodCount : 1;
+
+    for (uint32_t level{}; level < lodCount; ++level)
+    {
+        std::vector<uint32_t> lodIndices;
+        float error = 0.0f;
+
+        if (level == 0)
+        {
+            lodIndices = baseIndices;
+        }
+        else
+        {
+            const size_t targetIndexCount = (baseIndices.size() >> level) / 3 * 3;
+            lodIndices = MeshOptimizer::Simplify(baseIndices, vertices, targetIndexCount, radius * m_MaxLodError, error);
+
+            // Borders, seams or the error limit stopped it, a level that barely shrinks only costs memory
+            if (lodIndices.empty() || lodIndices.size() > lods.back().indexCount * 3 / 4)
+            {
+                break;
+            }
+
+            MeshOptimizer::OptimizeVertexCache(lodIndices, vertices.size());
+        }
+
+        MeshLod lod{};
+        lod.firstIndex = level == 0 ? 0 : static_cast<uint32_t>(indices.size());
+        lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+        lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+        lod.error = error;
+
+        for (Meshlet meshlet : MeshOptimizer::BuildMeshlets(lodIndices, vertices))
+        {
+            meshlet.firstIndex += lod.firstIndex;
+            meshlets.push_back(meshlet);
+        }
+
+        lod.meshletCount = static_cast<uint32_t>(meshlets.size()) - lod.firstMeshlet;
+        lods.push_back(lod);
+
+        if (level > 0)
+        {
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+    }
+}
+
+void ModelLoader::PrintMeshOptimizationReport() const
+{
+    if (m_MeshStats.empty())
+    {
+        return;
+    }
+
+    size_t totalTriangles = 0;
+    double missesBefore = 0.0;
+    double missesAfter = 0.0;
 
-    // Extract COLOR data
-    if (colIt != primitive.attributes.end())
+    std::cout << "Mesh optimization (ACMR / ATVR, 16 entry FIFO)\n";
+
+    for (size_t i{}; i < m_MeshStats.size(); ++i)
     {
-        const tinygltf::Accessor& accessor = gltfModel.accessors[colIt->second];
-        const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-        const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
+        const MeshOptimizationStats& stats = m_MeshStats[i];
+
+        std::cout << "\tprimitive " << i << ": " << stats.vertexCount << " vertices, " << stats.triangleCount << " triangles, "
+            << stats.before.acmr << " / " << stats.before.atvr << " -> " << stats.after.acmr << " / " << stats.after.atvr << '\n';
+
+        totalTriangles += stats.triangleCount;
+        missesBefore += static_cast<double>(stats.before.acmr) * stats.triangleCount;
+        missesAfter += static_cast<double>(stats.after.acmr) * stats.triangleCount;
+    }
 
-        colData = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
+    if (totalTriangles > 0)
+    {
+        std::cout << "\ttotal ACMR: " << missesBefore / totalTriangles << " -> " << missesAfter / totalTriangles << '\n';
     }
+}
+
+size_t ModelLoader::GetVertexCount(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive)
+{
+    auto posIt = primitive.attributes.find("POSITION");
 
-    // Extract TEXCOORD_0 data
-    if (texIt != primitive.attributes.end())
+    if (posIt == primitive.attributes.end())
     {
-        const tinygltf::Accessor& accessor = gltfModel.accessors[texIt->second];
-        const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-        const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
+        return 0;
+    }
+
+    return gltfModel.accessors[posIt->second].count;
+}
 
-        texData = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
+size_t ModelLoader::GetIndexCount(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive)
+{
+    // If there is no indices
+    if (primitive.indices < 0)
+    {
+        return 0;
     }
 
-    // Fill Vertex Data
-    for (size_t i = 0; i < vertexCount; i++)
+    return gltfModel.accessors[primitive.indices].count;
+}
+
+ModelLoader::AccessorView ModelLoader::GetAccessorView(const tinygltf::Model& gltfModel, int accessorIndex) const
+{
+    const tinygltf::Accessor& accessor = gltfModel.accessors[accessorIndex];
+
+    AccessorView view{};
+    view.count = accessor.count;
+    view.componentType = accessor.componentType;
+    view.componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+    view.isNormalized = accessor.normalized;
+
+    // An accessor without a buffer view reads as zeros
+    if (accessor.bufferView < 0)
     {
-        Vertex v = {};
+        return view;
+    }
 
-        if (posData) 
+    const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
+
+    view.pData = GetBufferData(gltfModel, bufferView.buffer) + bufferView.byteOffset + accessor.byteOffset;
+
+    // A stride of 0 means the elements are tightly packed
+    const int elementSize = tinygltf::GetComponentSizeInBytes(accessor.componentType) * view.componentCount;
+    view.stride = bufferView.byteStride != 0 ? bufferView.byteStride : static_cast<size_t>(elementSize);
+
+    return view;
+}
+
+glm::vec4 ModelLoader::ReadAccessor(const AccessorView& view, size_t index)
+{
+    glm::vec4 result{ 0.0f };
+
+    if (!view.pData)
+    {
+        return result;
+    }
+
+    const unsigned char* pElement = view.pData + index * view.stride;
+
+    // Normalized integers map to [0, 1] or [-1, 1] as defined by the glTF spec, the rest converts as is
+    for (int c{}; c < view.componentCount && c < 4; ++c)
+    {
+        switch (view.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        {
+            float value;
+            memcpy(&value, pElement + c * sizeof(float), sizeof(float));
+            result[c] = value;
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
         {
-            glm::vec4 pos = glm::vec4(posData[i * 3 + 0], posData[i * 3 + 1], posData[i * 3 + 2], 1.0f);
-            v.pos = glm::vec3(transform * pos);
+            int8_t value;
+            memcpy(&value, pElement + c * sizeof(int8_t), sizeof(int8_t));
+            result[c] = view.isNormalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+            break;
         }
-		if (normData)
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        {
+            uint8_t value;
+            memcpy(&value, pElement + c * sizeof(uint8_t), sizeof(uint8_t));
+            result[c] = view.isNormalized ? value / 255.0f : static_cast<float>(value);
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        {
+            int16_t value;
+            memcpy(&value, pElement + c * sizeof(int16_t), sizeof(int16_t));
+            result[c] = view.isNormalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, pElement + c * sizeof(uint16_t), sizeof(uint16_t));
+            result[c] = view.isNormalized ? value / 65535.0f : static_cast<float>(value);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported vertex component type: " + std::to_string(view.componentType));
+        }
+    }
+
+    return result;
+}
+
+void ModelLoader::FillVertices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, Vertex* pVertices)
+{
+    // Find attributes in the primitive
+    auto posIt = primitive.attributes.find("POSITION");
+	auto normIt = primitive.attributes.find("NORMAL");
+	auto tanIt = primitive.attributes.find("TANGENT");
+    auto colIt = primitive.attributes.find("COLOR_0");
+    auto texIt = primitive.attributes.find("TEXCOORD_0");
+
+    if (posIt == primitive.attributes.end())
+    {
+        return;
+    }
+
+    // Every attribute honors its own stride, component type and normalization
+    const AccessorView posView = GetAccessorView(gltfModel, posIt->second);
+    const AccessorView normView = normIt != primitive.attributes.end() ? GetAccessorView(gltfModel, normIt->second) : AccessorView{};
+    const AccessorView tanView = tanIt != primitive.attributes.end() ? GetAccessorView(gltfModel, tanIt->second) : AccessorView{};
+    const AccessorView colView = colIt != primitive.attributes.end() ? GetAccessorView(gltfModel, colIt->second) : AccessorView{};
+    const AccessorView texView = texIt != primitive.attributes.end() ? GetAccessorView(gltfModel, texIt->second) : AccessorView{};
+
+    // Fill Vertex Data
+    for (size_t i = 0; i < posView.count; i++)
+    {
+        Vertex v = {};
+
+        // Kept in mesh space, the node transforms are applied per instance in the vertex shader
+        v.pos = glm::vec3(ReadAccessor(posView, i));
+
+		if (normView.pData)
 		{
-			glm::vec4 norm = glm::vec4(normData[i * 3 + 0], normData[i * 3 + 1], normData[i * 3 + 2], 0.0f);
-			v.normal = glm::normalize(glm::vec3(transform * norm));
+			v.normal = glm::normalize(glm::vec3(ReadAccessor(normView, i)));
 		}
-        if (tanData)
+        if (tanView.pData)
         {
-			glm::vec4 tan = glm::vec4(tanData[i * 4 + 0], tanData[i * 4 + 1], tanData[i * 4 + 2], tanData[i * 4 + 3]);
-			v.tangent = glm::normalize(glm::vec3(transform * tan));
+			// glTF tangents are vec4 with the bitangent sign in w
+			const glm::vec4 tangent = ReadAccessor(tanView, i);
+			v.tangent = glm::vec4(glm::normalize(glm::vec3(tangent)), tangent.w < 0.0f ? -1.0f : 1.0f);
         }
-        if (colData) 
+        if (colView.pData) 
         {
-            v.color = glm::vec4(colData[i * 4 + 0], colData[i * 4 + 1], colData[i * 4 + 2], colData[i * 4 + 3]);
+            // COLOR_0 may be RGB or RGBA
+            v.color = glm::vec3(ReadAccessor(colView, i));
         }
-        if (texData) 
+        if (texView.pData) 
         {
-            v.texCoord = glm::vec2(texData[i * 2 + 0], texData[i * 2 + 1]);
+            v.texCoord = glm::vec2(ReadAccessor(texView, i));
         }
 
-        vertices.push_back(v);
+        pVertices[i] = v;
     }
 }
 
-void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, std::vector<uint32_t>& indices)
+void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, uint32_t* pIndices)
 {
     // If there is no indices
     if (primitive.indices < 0)
@@ -225,9 +1226,8 @@ void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::
 
     const tinygltf::Accessor& accessor = gltfModel.accessors[primitive.indices];
     const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-    const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
 
-    const void* dataPtr = &buffer.data[bufferView.byteOffset + accessor.byteOffset];
+    const void* dataPtr = GetBufferData(gltfModel, bufferView.buffer) + bufferView.byteOffset + accessor.byteOffset;
     size_t count = accessor.count;
 
     if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
@@ -236,7 +1236,7 @@ void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::
         for (size_t i = 0; i < count; i++)
         {
             // Convert uint16_t to uint32_t
-            indices.push_back(static_cast<uint32_t>(data[i]));
+            pIndices[i] = static_cast<uint32_t>(data[i]);
         }
     }
     else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
@@ -245,7 +1245,7 @@ void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::
         for (size_t i = 0; i < count; i++)
         {
             // No conversion needed for uint32_t to uint32_t
-            indices.push_back(data[i]);
+            pIndices[i] = data[i];
         }
     }
     else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
@@ -254,7 +1254,7 @@ void ModelLoader::FillIndices(const tinygltf::Model& gltfModel, const tinygltf::
         for (size_t i = 0; i < count; i++)
         {
             // Convert uint8_t to uint32_t
-            indices.push_back(static_cast<uint32_t>(data[i]));
+            pIndices[i] = static_cast<uint32_t>(data[i]);
         }
 	}
     else
@@ -281,9 +1281,8 @@ void ModelLoader::FillDiffuseTexture(const tinygltf::Model& model, const tinyglt
     }
 
     const tinygltf::Texture& text = model.textures[texIdx];
-    const tinygltf::Image& img = model.images[text.source];
 
-    diffuseTexture = path + img.uri;
+    diffuseTexture = GetImagePath(model, text.source, path);
 }
 
 void ModelLoader::FillNormalTexture(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string&& path, std::string& normalTexture)
@@ -305,9 +1304,8 @@ void ModelLoader::FillNormalTexture(const tinygltf::Model& model, const tinygltf
     }
 
     const tinygltf::Texture& text = model.textures[texIdx];
-    const tinygltf::Image& img = model.images[text.source];
 
-    normalTexture = path + img.uri;
+    normalTexture = GetImagePath(model, text.source, path);
 }
 
 void ModelLoader::FillMetalRoughTexture(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string&& path, std::string& metalRoughTexture)
@@ -329,9 +1327,8 @@ void ModelLoader::FillMetalRoughTexture(const tinygltf::Model& model, const tiny
     }
 
     const tinygltf::Texture& text = model.textures[texIdx];
-    const tinygltf::Image& img = model.images[text.source];
 
-    metalRoughTexture = path + img.uri;
+    metalRoughTexture = GetImagePath(model, text.source, path);
 }
 
 void ModelLoader::SetTransparent(Model& modelObj, const tinygltf::Model& model, const tinygltf::Primitive& primitive)
@@ -346,7 +1343,7 @@ void ModelLoader::SetTransparent(Model& modelObj, const tinygltf::Model& model,
     }
 }
 
-void ModelLoader::ProcessNode(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentTransform, std::vector<Model*>& models, const std::string& modelPath)
+void ModelLoader::ProcessNode(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentTransform, std::vector<Model*>& models, std::vector<PrimitiveJob>& jobs, std::unordered_map<int, std::vector<Model*>>& meshModels, const std::string& modelPath)
 {
     const tinygltf::Node& node = model.nodes[nodeIndex];
 
@@ -388,28 +1385,73 @@ void ModelLoader::ProcessNode(const tinygltf::Model& model, int nodeIndex, const
 
     if (node.mesh >= 0)
     {
-        for (const auto& mesh : model.meshes)
+        auto meshIt = meshModels.find(node.mesh);
+
+        // First node referencing this mesh, create a model per primitive, the vertex and index data is decoded later
+        if (meshIt == meshModels.end())
         {
+            std::vector<Model*>& primitiveModels = meshModels[node.mesh];
+
             for (auto& primitive : model.meshes[node.mesh].primitives)
             {
-                // Create model and load primitives with transform
                 models.push_back(new Model{});
                 Model& modelObj = *models.back();
+                primitiveModels.push_back(&modelObj);
+
+                modelObj.GetVertices().resize(GetVertexCount(model, primitive));
+                modelObj.GetIndices().resize(GetIndexCount(model, primitive));
+                jobs.push_back(PrimitiveJob{ &primitive, &modelObj });
 
-                FillVertices(model, primitive, modelObj.GetVertices(), globalTransform);
-                FillIndices(model, primitive, modelObj.GetIndices());
                 FillDiffuseTexture(model, primitive, GetFolderPath(modelPath), modelObj.GetDiffuseTexturePath());
 				FillNormalTexture(model, primitive, GetFolderPath(modelPath), modelObj.GetNormalTexturePath());
 				FillMetalRoughTexture(model, primitive, GetFolderPath(modelPath), modelObj.GetMetalRoughTexturePath());
                 SetTransparent(modelObj, model, primitive);
+
+                modelObj.SetVertexCount(static_cast<uint32_t>(modelObj.GetVertices().size()));
+                modelObj.SetIndexCount(static_cast<uint32_t>(modelObj.GetIndices().size()));
             }
+
+            meshIt = meshModels.find(node.mesh);
+        }
+
+        // Every node referencing the mesh only adds an instance
+        for (Model* pModel : meshIt->second)
+        {
+            pModel->GetInstances().push_back(globalTransform);
         }
     }
 
     // Recursively process children
     for (int childIndex : node.children)
     {
-        ProcessNode(model, childIndex, globalTransform, models, modelPath);
+        ProcessNode(model, childIndex, globalTransform, models, jobs, meshModels, modelPath);
+    }
+}
+
+void ModelLoader::AssignBufferRanges(std::vector<Model*>& models)
+{
+    // Opaque models first so both draw lists map onto contiguous ranges of the shared buffers
+    std::stable_partition(models.begin(), models.end(), [](const Model* pModel) { return !pModel->IsTransparent(); });
+
+    uint32_t vertexOffset = 0;
+    uint32_t indexOffset = 0;
+    uint32_t instanceOffset = 0;
+
+    for (Model* pModel : models)
+    {
+        // Obj models and anything not placed by a node are drawn once as is
+        if (pModel->GetInstances().empty())
+        {
+            pModel->GetInstances().push_back(glm::mat4(1.0f));
+        }
+
+        pModel->SetVertexOffset(vertexOffset);
+        pModel->SetFirstIndex(indexOffset);
+        pModel->SetFirstInstance(instanceOffset);
+
+        vertexOffset += pModel->GetVertexCount();
+        indexOffset += pModel->GetIndexCount();
+        instanceOffset += pModel->GetInstanceCount();
     }
 }
 
@@ -3,11 +3,45 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
 
 #include "Model.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
 
 #include "tiny_gltf.h"
 
+class MappedFile;
+class CookedTexture;
+
+struct TextureUser
+{
+	Model* pModel;
+	TextureSlot slot;
+};
+
+// Image decoded once on the loading thread for every model slot that references it
+// Holds either RGBA8 pixels or, when cooking, the mapped block compressed file of a single slot
+struct LoadedTexture
+{
+	std::string path;
+	std::vector<TextureUser> users;
+	unsigned char* pPixels = nullptr;
+	int width = 0;
+	int height = 0;
+	CookedTexture* pCooked = nullptr;
+
+	// Frees the pixels or unmaps the cooked file
+	void Release();
+};
+
 class ModelLoader
 {
 public:
@@ -16,16 +50,145 @@ public:
 	std::vector<Model*> LoadModel(const std::string& modelPath);
 	std::vector<Model*> LoadModelObj(const std::string& modelPath);
 	std::vector<Model*> LoadModelGltf(const std::string& modelPath);
+	// Maps the file and reads accessors straight from its BIN chunk
+	std::vector<Model*> LoadModelGlb(const std::string& modelPath);
+
+	// Loads on a background thread, every model is handed out as soon as its primitive is decoded, textures follow once all geometry is out
+	// Models arrive with their streams filled and a default instance, buffer ranges are left to the caller
+	// On a mesh cache hit the streams stay empty, GetMeshCache() holds them at the models' offsets until the loader is destroyed
+	void LoadModelAsync(const std::string& modelPath);
+	// Moves the models finished since the last call into models, rethrows anything the loading thread threw
+	bool TakeLoadedModels(std::vector<Model*>& models);
+	bool TakeLoadedTexture(LoadedTexture& texture);
+	// Only decodes the images of models that are already loaded, on the same background thread and worker pool
+	void LoadTexturesAsync(const std::vector<Model*>& models);
+	// Blocks until a texture can be taken, false once none are left, rethrows anything the loading thread threw
+	bool WaitForLoadedTextures();
+	// Every model and texture of the asynchronous load has been taken
+	bool IsAsyncLoadFinished();
+	// The loading thread no longer reads the streams of the models it handed out, e.g. to save the mesh cache
+	bool IsGeometryDone() const { return m_IsGeometryDone; }
+
+	// Valid until the loader is destroyed, holds the baked streams when the last load was a cache hit
+	MeshCache* GetMeshCache() const { return m_pMeshCache; }
+
+	// Decode glTF primitives on a pool of worker threads, output is identical to the serial path
+	void SetParallelLoading(bool isParallel) { m_IsParallelLoading = isParallel; }
+	bool IsParallelLoading() const { return m_IsParallelLoading; }
+
+	// Reorder triangles for the post-transform cache and overdraw, then vertices for fetch locality
+	void SetMeshOptimization(bool isOptimizing) { m_IsOptimizingMeshes = isOptimizing; }
+	bool IsOptimizingMeshes() const { return m_IsOptimizingMeshes; }
+	// Append simplified index ranges for distant rendering, they share the vertices of level 0
+	void SetLodGeneration(bool isGenerating) { m_IsGeneratingLods = isGenerating; }
+	bool IsGeneratingLods() const { return m_IsGeneratingLods; }
+	// Hand out cooked block compressed files instead of decoded pixels, cooking images that have none yet
+	void SetTextureCooking(bool isCooking) { m_IsCookingTextures = isCooking; }
+	bool IsCookingTextures() const { return m_IsCookingTextures; }
+	// Prints the cache statistics of every primitive optimized by the last load that was not a cache hit
+	void PrintMeshOptimizationReport() const;
+
+	// Times serial against parallel primitive extraction of an already parsed glTF file and prints the result
+	void BenchmarkPrimitiveExtraction(const std::string& modelPath, int iterations);
+	// Times the old std::unordered_map deduplication against VertexWelder on the unindexed streams of a file
+	void BenchmarkVertexWelding(const std::string& modelPath, int iterations);
 
 private:
-	void FillVertices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, std::vector<Vertex>& vertices, const glm::mat4& transform);
-	void FillIndices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, std::vector<uint32_t>& indices);
+	// Where and how the elements of an accessor are stored
+	struct AccessorView
+	{
+		const unsigned char* pData = nullptr;
+		size_t stride = 0;
+		size_t count = 0;
+		int componentType = 0;
+		int componentCount = 0;
+		bool isNormalized = false;
+	};
+
+	struct PrimitiveJob
+	{
+		const tinygltf::Primitive* pPrimitive;
+		Model* pModel;
+	};
+
+	struct MeshOptimizationStats
+	{
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+		MeshOptimizer::VertexCacheStats before{};
+		MeshOptimizer::VertexCacheStats after{};
+	};
+
+	void ParseGltf(const std::string& modelPath, tinygltf::Model& gltfModel);
+	void ParseGlb(const std::string& modelPath, tinygltf::Model& gltfModel);
+	void ReleaseGlb();
+	const unsigned char* GetBufferData(const tinygltf::Model& gltfModel, int bufferIndex) const;
+	// Embedded glb images get "<file>#<offset>:<size>", Texture decodes those from the mapped file
+	std::string GetImagePath(const tinygltf::Model& gltfModel, int imageIndex, const std::string& folderPath) const;
+	std::vector<Model*> ExtractPrimitives(const tinygltf::Model& gltfModel, const std::string& modelPath, bool isParallel);
+	void DecodePrimitive(const tinygltf::Model& gltfModel, const PrimitiveJob& job, MeshOptimizationStats& stats);
+	// Only touches the model and stats passed in, safe to run on several models at once
+	void OptimizeMesh(Model& model, MeshOptimizationStats& stats) const;
+	// Fills the bounding sphere, the levels of detail and their meshlets, call once the index list is final
+	void BuildLods(Model& model) const;
+
+	size_t GetVertexCount(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive);
+	size_t GetIndexCount(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive);
+	AccessorView GetAccessorView(const tinygltf::Model& gltfModel, int accessorIndex) const;
+	// Reads up to four components of one element as floats
+	static glm::vec4 ReadAccessor(const AccessorView& view, size_t index);
+	void FillVertices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, Vertex* pVertices);
+	void FillIndices(const tinygltf::Model& gltfModel, const tinygltf::Primitive& primitive, uint32_t* pIndices);
 	void FillDiffuseTexture(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string&& path, std::string& diffuseTexture);
 	void FillNormalTexture(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string&& path, std::string& normalTexture);
 	void FillMetalRoughTexture(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string&& path, std::string& metalRoughTexture);
 	void SetTransparent(Model& modelObj, const tinygltf::Model& model, const tinygltf::Primitive& primitive);
 
-	void ProcessNode(const tinygltf::Model& model, int nodeIdx, const glm::mat4& parentTransform, std::vector<Model*>& models, const std::string& modelPath);
+	// meshModels maps a glTF mesh index to the models of its primitives, so every mesh is only extracted once
+	void ProcessNode(const tinygltf::Model& model, int nodeIdx, const glm::mat4& parentTransform, std::vector<Model*>& models, std::vector<PrimitiveJob>& jobs, std::unordered_map<int, std::vector<Model*>>& meshModels, const std::string& modelPath);
+
+	void AssignBufferRanges(std::vector<Model*>& models);
+
+	void RunAsyncLoad(const std::string& modelPath);
+	void RunTextureLoad(std::vector<Model*> models);
+	void FinishLoadThread();
+	// Images are decoded on the worker pool, each once however many slots reference it
+	void LoadTextures(const std::vector<Model*>& models);
+	// Called from worker threads once a model is final, only during an asynchronous load
+	void PublishModel(Model* pModel);
+	// Blocks while too many decoded textures are waiting to be taken, called from several workers at once
+	void PublishTexture(LoadedTexture& texture);
 
 	std::string GetFolderPath(const std::string& filename);
+
+	// Every level halves the triangle count of the one before
+	static const uint32_t m_MaxLodCount = 4;
+	// Simplification stops once it would move the surface further than this fraction of the bounding radius
+	static constexpr float m_MaxLodError = 0.05f;
+
+	MeshCache* m_pMeshCache = nullptr;
+	ThreadPool* m_pThreadPool = nullptr;
+	bool m_IsParallelLoading = true;
+	bool m_IsOptimizingMeshes = true;
+	bool m_IsGeneratingLods = true;
+	bool m_IsCookingTextures = false;
+	std::vector<MeshOptimizationStats> m_MeshStats;
+
+	// Decoded RGBA8 images are large, cap how many wait for the renderer, cooked files are only mapped but count the same
+	static const size_t m_MaxQueuedTextures = 8;
+
+	std::thread m_LoadThread;
+	std::mutex m_LoadMutex;
+	std::condition_variable m_LoadCondition;
+	std::vector<Model*> m_pLoadedModels;
+	std::deque<LoadedTexture> m_LoadedTextures;
+	std::exception_ptr m_LoadError;
+	bool m_IsLoadingAsync = false;
+	bool m_IsLoadThreadDone = false;
+	std::atomic<bool> m_IsCancelling{ false };
+	std::atomic<bool> m_IsGeometryDone{ true };
+
+	MappedFile* m_pGlbFile = nullptr;
+	const unsigned char* m_pBinaryChunk = nullptr;
+	std::vector<std::string> m_EmbeddedImagePaths;
 };
\ No newline at end of file
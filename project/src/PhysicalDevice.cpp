@@ -78,7 +78,7 @@ QueueFamilyIndices PhysicalDevice::FindQueueFamilies(VkPhysicalDevice device)
 
     for (int i{}; i < queueFamilyCount; ++i)
     {
-        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT && !indices.graphicsFamily.has_value())
         {
             indices.graphicsFamily = i;
         }
@@ -86,14 +86,20 @@ QueueFamilyIndices PhysicalDevice::FindQueueFamilies(VkPhysicalDevice device)
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, *m_pInstance->GetSurface(), &presentSupport);
 
-        if (presentSupport)
+        if (presentSupport && !indices.presentFamily.has_value())
         {
             indices.presentFamily = i;
         }
 
-        if (indices.IsComplete())
+        // A transfer only family is usually the copy engine, a compute family without graphics still runs beside the frame
+        const VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if (flags & VK_QUEUE_TRANSFER_BIT && !(flags & VK_QUEUE_GRAPHICS_BIT))
         {
-            break;
+            const bool isTransferOnly = !(flags & VK_QUEUE_COMPUTE_BIT);
+            if (!indices.transferFamily.has_value() || (isTransferOnly && queueFamilies[indices.transferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT))
+            {
+                indices.transferFamily = i;
+            }
         }
     }
 
@@ -102,36 +108,7 @@ QueueFamilyIndices PhysicalDevice::FindQueueFamilies(VkPhysicalDevice device)
 
 QueueFamilyIndices PhysicalDevice::FindQueueFamilies()
 {
-    QueueFamilyIndices indices;
-
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
-
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
-
-    for (int i{}; i < queueFamilyCount; ++i)
-    {
-        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-        {
-            indices.graphicsFamily = i;
-        }
-
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice, i, *m_pInstance->GetSurface(), &presentSupport);
-
-        if (presentSupport)
-        {
-            indices.presentFamily = i;
-        }
-
-        if (indices.IsComplete())
-        {
-            break;
-        }
-    }
-
-    return indices;
+    return FindQueueFamilies(m_PhysicalDevice);
 }
 
 bool PhysicalDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device)
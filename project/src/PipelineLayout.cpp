@@ -3,19 +3,19 @@
 #include "Structs.h"
 #include <stdexcept>
 
-PipelineLayout::PipelineLayout(LogicalDevice* pDevice, const VkDescriptorSetLayout* pDescriptorSetLayout)
+PipelineLayout::PipelineLayout(LogicalDevice* pDevice, const std::vector<VkDescriptorSetLayout>& setLayouts)
 	: m_pDevice{ pDevice }
     , m_PipelineLayout{ VK_NULL_HANDLE }
 {
     VkPushConstantRange pushConstantRange = {};
     pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstants);
+    pushConstantRange.size = sizeof(PushConstants) + sizeof(MaterialIndices);
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1; // Optional
-    pipelineLayoutInfo.pSetLayouts = pDescriptorSetLayout; // Optional
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 1; // Optional
     pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange; // Optional
 
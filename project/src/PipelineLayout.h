@@ -1,12 +1,14 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <vector>
 
 class LogicalDevice;
 
 class PipelineLayout
 {
 public:
-	PipelineLayout(LogicalDevice* pDevice, const VkDescriptorSetLayout* pDescriptorSetLayout);
+	// Set 0 is the per-model or per-frame set, a bindless texture table follows as set 1
+	PipelineLayout(LogicalDevice* pDevice, const std::vector<VkDescriptorSetLayout>& setLayouts);
 	~PipelineLayout();
 	VkPipelineLayout GetPipelineLayout() { return m_PipelineLayout; }
 private:
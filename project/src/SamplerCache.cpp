@@ -0,0 +1,109 @@
+#include "SamplerCache.h"
+#include "LogicalDevice.h"
+#include "PhysicalDevice.h"
+#include <stdexcept>
+#include <cstring>
+
+SamplerCache::SamplerCache(LogicalDevice* pDevice)
+	: m_pDevice{ pDevice }
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), &properties);
+	m_MaxAnisotropy = properties.limits.maxSamplerAnisotropy;
+}
+
+SamplerCache::~SamplerCache()
+{
+	for (const auto& [key, sampler] : m_Samplers)
+	{
+		vkDestroySampler(m_pDevice->GetVkDevice(), sampler, nullptr);
+	}
+}
+
+VkSampler SamplerCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+{
+	const Key key = MakeKey(createInfo);
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	auto it = m_Samplers.find(key);
+	if (it != m_Samplers.end())
+	{
+		return it->second;
+	}
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	if (vkCreateSampler(m_pDevice->GetVkDevice(), &createInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create texture sampler!");
+	}
+
+	m_Samplers.emplace(key, sampler);
+	return sampler;
+}
+
+VkSampler SamplerCache::GetLinearSampler(bool isUsingMips)
+{
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+	samplerInfo.maxAnisotropy = m_MaxAnisotropy;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.minLod = 0.0f;
+	// Clamped by the image's own level count, so one sampler fits every texture
+	samplerInfo.maxLod = isUsingMips ? VK_LOD_CLAMP_NONE : 0.0f;
+
+	return GetSampler(samplerInfo);
+}
+
+bool SamplerCache::Key::operator==(const Key& other) const
+{
+	return memcmp(this, &other, sizeof(Key)) == 0;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+
+	const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(&key);
+	for (size_t i{}; i < sizeof(Key); ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+SamplerCache::Key SamplerCache::MakeKey(const VkSamplerCreateInfo& createInfo)
+{
+	Key key{};
+	key.magFilter = createInfo.magFilter;
+	key.minFilter = createInfo.minFilter;
+	key.mipmapMode = createInfo.mipmapMode;
+	key.addressModeU = createInfo.addressModeU;
+	key.addressModeV = createInfo.addressModeV;
+	key.addressModeW = createInfo.addressModeW;
+	key.mipLodBias = createInfo.mipLodBias;
+	key.anisotropyEnable = createInfo.anisotropyEnable;
+	// Ignored without anisotropy, comparisons likewise
+	key.maxAnisotropy = createInfo.anisotropyEnable ? createInfo.maxAnisotropy : 0.0f;
+	key.compareEnable = createInfo.compareEnable;
+	key.compareOp = createInfo.compareEnable ? createInfo.compareOp : VK_COMPARE_OP_NEVER;
+	key.minLod = createInfo.minLod;
+	key.maxLod = createInfo.maxLod;
+	key.borderColor = createInfo.borderColor;
+	key.unnormalizedCoordinates = createInfo.unnormalizedCoordinates;
+	return key;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+class LogicalDevice;
+
+// Owned by the device, every identical create info shares one sampler, all of them live as long as the device
+class SamplerCache
+{
+public:
+	explicit SamplerCache(LogicalDevice* pDevice);
+	~SamplerCache();
+
+	SamplerCache(const SamplerCache&) = delete;
+	SamplerCache(SamplerCache&&) noexcept = delete;
+	SamplerCache& operator=(const SamplerCache&) = delete;
+	SamplerCache& operator=(SamplerCache&&) noexcept = delete;
+
+	// Creates the sampler on first use, pNext and flags are not part of the key and must be empty
+	VkSampler GetSampler(const VkSamplerCreateInfo& createInfo);
+	// Linear, repeat and the device's max anisotropy, what every texture samples with
+	// isUsingMips = false clamps sampling to level 0, otherwise it covers any number of levels
+	VkSampler GetLinearSampler(bool isUsingMips = true);
+
+	uint32_t GetSamplerCount() const { return static_cast<uint32_t>(m_Samplers.size()); }
+
+private:
+	// Every field is 4 bytes, so the key has no padding and is hashed and compared as raw bytes
+	struct Key
+	{
+		VkFilter magFilter;
+		VkFilter minFilter;
+		VkSamplerMipmapMode mipmapMode;
+		VkSamplerAddressMode addressModeU;
+		VkSamplerAddressMode addressModeV;
+		VkSamplerAddressMode addressModeW;
+		float mipLodBias;
+		VkBool32 anisotropyEnable;
+		float maxAnisotropy;
+		VkBool32 compareEnable;
+		VkCompareOp compareOp;
+		float minLod;
+		float maxLod;
+		VkBorderColor borderColor;
+		VkBool32 unnormalizedCoordinates;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	LogicalDevice* m_pDevice;
+	float m_MaxAnisotropy = 1.0f;
+
+	std::mutex m_Mutex;
+	std::unordered_map<Key, VkSampler, KeyHash> m_Samplers;
+
+	static Key MakeKey(const VkSamplerCreateInfo& createInfo);
+};
@@ -15,6 +15,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Family without graphics that can copy beside the frame, uploads share the graphics queue without one
+    std::optional<uint32_t> transferFamily;
 
     bool IsComplete()
     {
@@ -35,94 +37,228 @@ struct PushConstants
 	glm::vec4 cameraForward;
 };
 
+// Bindless slots of a model's material textures, pushed right behind PushConstants whenever the drawn model changes
+struct MaterialIndices
+{
+	uint32_t diffuse;
+	uint32_t normal;
+	uint32_t metalRough;
+	uint32_t padding;
+};
+
 
 struct Vertex
 {
     glm::vec3 pos;
 	glm::vec3 normal;
-	glm::vec3 tangent;
+	// w is the handedness of the bitangent, +1 unless the source says otherwise
+	glm::vec4 tangent{ 0.0f, 0.0f, 0.0f, 1.0f };
     glm::vec3 color;
     glm::vec2 texCoord;
 
-    static VkVertexInputBindingDescription GetBindingDescription()
+    bool operator==(const Vertex& other) const
     {
-        VkVertexInputBindingDescription bindingDescription{};
-
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
+        return pos == other.pos && color == other.color && texCoord == other.texCoord && normal == other.normal && tangent == other.tangent;
     }
+};
 
-    static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions()
+namespace std
+{
+    template<> struct hash<Vertex>
     {
-        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+        size_t operator()(Vertex const& vertex) const
+        {
+			return ((hash<glm::vec3>()(vertex.pos) ^
+				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
+				(hash<glm::vec4>()(vertex.tangent) << 1) ^
+				(hash<glm::vec3>()(vertex.color) << 1) ^
+				(hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+}
+
+// Layout of the vertex streams, models keep full Vertex data on the CPU either way
+enum class VertexFormat
+{
+	// Vertex as it is, 12 byte positions and 48 byte attributes
+	Full,
+	// PackedPosition and PackedAttributes without the color, 8 and 12 bytes
+	Packed,
+	// PackedPosition and PackedAttributes, 8 and 16 bytes
+	PackedColor
+};
+
+// Everything of a Vertex but its position, the attribute stream of the Full format
+struct VertexAttributes
+{
+	glm::vec3 normal;
+	glm::vec4 tangent;
+	glm::vec3 color;
+	glm::vec2 texCoord;
+};
+
+// Quantized streams the packed shaders decode, filled by VertexPacker
+struct PackedPosition
+{
+	// Unorm within the model's bounding cube, w holds the tangent sign with 0 for -1 and 65535 for +1
+	uint16_t position[4];
+};
+
+struct PackedAttributes
+{
+	// Octahedral snorm, decoded back to unit vectors
+	int16_t normal[2];
+	int16_t tangent[2];
+	// Half floats
+	uint16_t texCoord[2];
+	// Unorm, left out of the Packed stride
+	uint8_t color[4];
+};
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+// Vertices are split in two streams so depth-only passes fetch nothing but positions
+// Positions are at binding 0 and the remaining attributes at binding 2, binding 1 holds the instances
+struct VertexStreams
+{
+	static constexpr uint32_t m_PositionBinding = 0;
+	static constexpr uint32_t m_AttributeBinding = 2;
 
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, normal);
+	static uint32_t GetPositionStride(VertexFormat format)
+	{
+		return format == VertexFormat::Full ? sizeof(glm::vec3) : sizeof(PackedPosition);
+	}
 
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, tangent);
+	static uint32_t GetAttributeStride(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Packed: return offsetof(PackedAttributes, color);
+		case VertexFormat::PackedColor: return sizeof(PackedAttributes);
+		default: return sizeof(VertexAttributes);
+		}
+	}
 
-        attributeDescriptions[3].binding = 0;
-        attributeDescriptions[3].location = 3;
-        attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[3].offset = offsetof(Vertex, color);
+	// Depth-only pipelines leave out the attribute binding
+	static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexFormat format, bool isDepthOnly)
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions =
+		{
+			{ m_PositionBinding, GetPositionStride(format), VK_VERTEX_INPUT_RATE_VERTEX },
+		};
 
-        attributeDescriptions[4].binding = 0;
-        attributeDescriptions[4].location = 4;
-        attributeDescriptions[4].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[4].offset = offsetof(Vertex, texCoord);
+		if (!isDepthOnly)
+		{
+			bindingDescriptions.push_back({ m_AttributeBinding, GetAttributeStride(format), VK_VERTEX_INPUT_RATE_VERTEX });
+		}
 
-        return attributeDescriptions;
-    }
+		return bindingDescriptions;
+	}
+
+	// Same locations in every format, the color at location 3 is left out of Packed
+	static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexFormat format, bool isDepthOnly)
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+
+		if (format == VertexFormat::Full)
+		{
+			attributeDescriptions.push_back({ 0, m_PositionBinding, VK_FORMAT_R32G32B32_SFLOAT, 0 });
 
-    static std::array<VkVertexInputAttributeDescription, 1> GetDepthAttributeDescriptions()
+			if (!isDepthOnly)
+			{
+				attributeDescriptions.push_back({ 1, m_AttributeBinding, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, normal) });
+				attributeDescriptions.push_back({ 2, m_AttributeBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(VertexAttributes, tangent) });
+				attributeDescriptions.push_back({ 3, m_AttributeBinding, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, color) });
+				attributeDescriptions.push_back({ 4, m_AttributeBinding, VK_FORMAT_R32G32_SFLOAT, offsetof(VertexAttributes, texCoord) });
+			}
+
+			return attributeDescriptions;
+		}
+
+		attributeDescriptions.push_back({ 0, m_PositionBinding, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedPosition, position) });
+
+		if (!isDepthOnly)
+		{
+			attributeDescriptions.push_back({ 1, m_AttributeBinding, VK_FORMAT_R16G16_SNORM, offsetof(PackedAttributes, normal) });
+			attributeDescriptions.push_back({ 2, m_AttributeBinding, VK_FORMAT_R16G16_SNORM, offsetof(PackedAttributes, tangent) });
+			attributeDescriptions.push_back({ 4, m_AttributeBinding, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedAttributes, texCoord) });
+
+			if (format == VertexFormat::PackedColor)
+			{
+				attributeDescriptions.push_back({ 3, m_AttributeBinding, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedAttributes, color) });
+			}
+		}
+
+		return attributeDescriptions;
+	}
+};
+
+// Per-instance data, bound at binding 1 between the vertex streams
+struct InstanceData
+{
+    glm::mat4 model;
+
+    static VkVertexInputBindingDescription GetBindingDescription()
     {
-        std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
+        VkVertexInputBindingDescription bindingDescription{};
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-        return attributeDescriptions;
+        return bindingDescription;
     }
 
-    bool operator==(const Vertex& other) const
+    // A mat4 attribute takes up four consecutive locations, one per column
+    static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions()
     {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord && normal == other.normal && tangent == other.tangent;
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+        for (uint32_t i{}; i < 4; ++i)
+        {
+            attributeDescriptions[i].binding = 1;
+            attributeDescriptions[i].location = 5 + i;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+        }
+
+        return attributeDescriptions;
     }
 };
 
-namespace std
+// A run of at most 124 triangles touching at most 64 vertices, drawn as one contiguous index range
+struct Meshlet
 {
-    template<> struct hash<Vertex>
-    {
-        size_t operator()(Vertex const& vertex) const
-        {
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
-				(hash<glm::vec3>()(vertex.tangent) << 1) ^
-				(hash<glm::vec3>()(vertex.color) << 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
+    // Bounding sphere in mesh space
+    glm::vec3 center;
+    float radius;
+    // Every triangle normal lies within acos(sqrt(1 - coneCutoff^2)) of the axis, a cutoff of 1 never culls
+    glm::vec3 coneAxis;
+    float coneCutoff;
+    // Relative to the first index of the owning model
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// One level of detail, an index range of the owning model with the meshlets that tile it
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Largest deviation from level 0 in mesh units
+    float error;
+};
 
 struct UniformBufferObject
 {
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
-};
\ No newline at end of file
+};
+// Material image a model binds, also decides how the image is cooked
+enum class TextureSlot
+{
+    Diffuse,
+    Normal,
+    MetalRough
+};
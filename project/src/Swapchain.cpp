@@ -87,7 +87,7 @@ void Swapchain::CleanupSwapChain(Image* pImage)
     VkDevice device = m_pDevice->GetVkDevice();
     vkDestroyImageView(device, *pImage->GetImageView(), nullptr);
     vkDestroyImage(device, *pImage->GetImage(), nullptr);
-    vkFreeMemory(device, *pImage->GetImageMemory(), nullptr);
+    m_pDevice->GetMemoryAllocator()->Free(*pImage->GetAllocation());
 
     for (size_t i{}; i < m_SwapchainFramebuffers.size(); ++i)
     {
@@ -262,9 +262,10 @@ void Swapchain::CreateImages(CommandPool* pCommandPool)
             properties,
             aspect,
             oldLayout,
-			newLayout
+			newLayout,
+			MemoryCategory::GBuffer
         };
-		m_pGBufferAlbedoImages[i]->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+		m_pGBufferAlbedoImages[i]->SetMipSampling();
 
         m_pGBufferNormalImages[i] = new Texture(
             m_pDevice, pCommandPool, extent, normalFormat,
@@ -273,9 +274,10 @@ void Swapchain::CreateImages(CommandPool* pCommandPool)
             properties,
 			aspect,
 			oldLayout,
-			newLayout
+			newLayout,
+			MemoryCategory::GBuffer
         );
-        m_pGBufferNormalImages[i]->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+        m_pGBufferNormalImages[i]->SetMipSampling();
 
         m_pGBufferMetalRoughImages[i] = new Texture(
             m_pDevice, pCommandPool, extent, metalRoughFormat,
@@ -284,8 +286,9 @@ void Swapchain::CreateImages(CommandPool* pCommandPool)
             properties,
 			aspect,
 			oldLayout,
-			newLayout
+			newLayout,
+			MemoryCategory::GBuffer
         );
-        m_pGBufferMetalRoughImages[i]->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+        m_pGBufferMetalRoughImages[i]->SetMipSampling();
     }
 }
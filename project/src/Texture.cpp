@@ -3,13 +3,50 @@
 #include <stb_image.h>
 
 #include "LogicalDevice.h"
-#include "CommandBuffers.h"
+#include "SamplerCache.h"
+#include "PhysicalDevice.h"
+#include "UploadContext.h"
 #include "CommandPool.h"
-#include "Buffer.h"
+#include "MappedFile.h"
+#include "TextureCooker.h"
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <utility>
 
-Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout)
-    : Image(pDevice, pCommandPool, swapchainExtent, imageFormat, tiling, usage, properties, aspects, oldLayout, newLayout)
+// Embedded glb images are addressed as "<file>#<offset>:<size>" and decoded straight from the mapped file
+unsigned char* Texture::LoadPixels(const std::string& texturePath, int* pWidth, int* pHeight)
+{
+    const size_t hashIndex = texturePath.rfind('#');
+    const size_t colonIndex = texturePath.rfind(':');
+    int channels = 0;
+
+    if (hashIndex == std::string::npos || colonIndex == std::string::npos || colonIndex < hashIndex)
+    {
+        return stbi_load(texturePath.c_str(), pWidth, pHeight, &channels, STBI_rgb_alpha);
+    }
+
+    const size_t offset = std::stoull(texturePath.substr(hashIndex + 1, colonIndex - hashIndex - 1));
+    const size_t size = std::stoull(texturePath.substr(colonIndex + 1));
+
+    MappedFile file{ texturePath.substr(0, hashIndex) };
+
+    if (!file.IsValid() || offset + size > file.GetSize())
+    {
+        return nullptr;
+    }
+
+    return stbi_load_from_memory(file.GetData() + offset, static_cast<int>(size), pWidth, pHeight, &channels, STBI_rgb_alpha);
+}
+
+void Texture::FreePixels(unsigned char* pPixels)
+{
+    stbi_image_free(pPixels);
+}
+
+Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout, MemoryCategory category)
+    : Image(pDevice, pCommandPool, swapchainExtent, imageFormat, tiling, usage, properties, aspects, oldLayout, newLayout, category)
 {
 }
 
@@ -20,100 +57,238 @@ Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D s
 	m_pDevice = pDevice;
 	m_pCommandPool = pCommandPool;
 
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    int texWidth, texHeight;
+    stbi_uc* pixels = LoadPixels(texturePath, &texWidth, &texHeight);
 
     if (!pixels)
     {
         throw std::runtime_error("failed to load texture image!");
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    Buffer::CreateBuffer(m_pDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_pDevice->GetVkDevice(), stagingBufferMemory);
+    CreateFromPixels(pixels, texWidth, texHeight, imageFormat, tiling, usage, properties, true);
 
     stbi_image_free(pixels);
+}
 
-    CreateImage(texWidth, texHeight, imageFormat, tiling, usage, properties, m_Image, m_ImageMemory);
-    m_ImageView = CreateImageView(imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
-
-    TransitionImageLayout(imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    CopyBufferToImage(stagingBuffer, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    TransitionImageLayout(imageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, const unsigned char* pPixels, int width, int height, bool isGeneratingMips)
+    : Image()
+{
+    m_pDevice = pDevice;
+    m_pCommandPool = pCommandPool;
 
-    vkDestroyBuffer(m_pDevice->GetVkDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(m_pDevice->GetVkDevice(), stagingBufferMemory, nullptr);
+    CreateFromPixels(pPixels, width, height, imageFormat, tiling, usage, properties, isGeneratingMips);
 }
 
-Texture::~Texture()
+Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkFormat imageFormat, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, int width, int height, bool isGeneratingMips)
+    : Image()
 {
-	vkDestroySampler(m_pDevice->GetVkDevice(), m_Sampler, nullptr);
+    m_pDevice = pDevice;
+    m_pCommandPool = pCommandPool;
+
+    CreateForPixels(width, height, imageFormat, VK_IMAGE_TILING_OPTIMAL, usage, properties, isGeneratingMips);
 }
 
-void Texture::CreateSampler(VkPhysicalDevice pPhysicalDevice)
+Texture::Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, const CookedTexture& cooked, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, const VkComponentMapping& swizzle, uint32_t firstLevel)
+    : Image()
 {
-    VkPhysicalDeviceProperties properties{};
-    vkGetPhysicalDeviceProperties(pPhysicalDevice, &properties);
-
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-
-    if (vkCreateSampler(m_pDevice->GetVkDevice(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
+    const std::vector<CookedTexture::Level>& levels = cooked.GetLevels();
+
+    if (firstLevel >= levels.size())
     {
-        throw std::runtime_error("failed to create texture sampler!");
+        throw std::runtime_error("cooked texture has no such level!");
     }
+
+    m_pDevice = pDevice;
+    m_pCommandPool = pCommandPool;
+    m_ImageFormat = cooked.GetFormat();
+    m_MipLevels = static_cast<uint32_t>(levels.size()) - firstLevel;
+    m_Width = static_cast<int>(levels[firstLevel].width);
+    m_Height = static_cast<int>(levels[firstLevel].height);
+    m_FirstLevel = firstLevel;
+
+    // Levels are staged back to back, every level is a multiple of the block size so the offsets stay aligned
+    for (uint32_t level = firstLevel; level < levels.size(); ++level)
+    {
+        // Extents are in texels, the last blocks of small levels are partially outside the image
+        VkBufferImageCopy region{};
+        region.bufferOffset = m_UploadSize;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level - firstLevel;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { levels[level].width, levels[level].height, 1 };
+        m_UploadRegions.push_back(region);
+
+        m_UploadSize += levels[level].size;
+    }
+
+    CreateImage(levels[firstLevel].width, levels[firstLevel].height, m_ImageFormat, VK_IMAGE_TILING_OPTIMAL, usage, properties, m_Image, m_Allocation, MemoryCategory::MaterialTexture, m_MipLevels);
+    m_ImageView = CreateImageView(m_ImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, swizzle);
 }
 
-void Texture::CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height)
+void Texture::SwapImage(Texture& other)
 {
-    VkCommandBuffer commandBuffer = CommandBuffers::BeginSingleTimeCommands(m_pDevice, m_pCommandPool);
+    std::swap(m_Image, other.m_Image);
+    std::swap(m_Allocation, other.m_Allocation);
+    std::swap(m_ImageView, other.m_ImageView);
+    std::swap(m_MipLevels, other.m_MipLevels);
+    std::swap(m_Width, other.m_Width);
+    std::swap(m_Height, other.m_Height);
+    std::swap(m_FirstLevel, other.m_FirstLevel);
+    std::swap(m_UploadRegions, other.m_UploadRegions);
+    std::swap(m_UploadSize, other.m_UploadSize);
+    std::swap(m_IsBlittingMips, other.m_IsBlittingMips);
+}
+
+void Texture::CreateForPixels(int texWidth, int texHeight, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, bool isGeneratingMips)
+{
+    m_ImageFormat = imageFormat;
+    m_Width = texWidth;
+    m_Height = texHeight;
+
+    // Blits filter linearly, formats that cannot do that on this device keep a single level
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_pDevice->GetPhysicalDevice()->GetVkPhysicalDevice(), imageFormat, &formatProperties);
+    const bool canBlit = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+
+    m_MipLevels = isGeneratingMips && canBlit ? static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1 : 1;
+    m_IsBlittingMips = m_MipLevels > 1;
 
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
-
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     region.imageSubresource.mipLevel = 0;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
-
     region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = {
-        width,
-        height,
-        1
-    };
-
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        m_Image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
-    );
-
-    CommandBuffers::EndSingleTimeCommands(m_pDevice, m_pCommandPool, commandBuffer);
+    region.imageExtent = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 };
+    m_UploadRegions.push_back(region);
+
+    m_UploadSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
+
+    // Every level but the last is read by the blit that fills the next one
+    const VkImageUsageFlags imageUsage = m_IsBlittingMips ? usage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT : usage;
+
+    CreateImage(texWidth, texHeight, imageFormat, tiling, imageUsage, properties, m_Image, m_Allocation, MemoryCategory::MaterialTexture, m_MipLevels);
+    m_ImageView = CreateImageView(imageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void Texture::CreateFromPixels(const unsigned char* pPixels, int texWidth, int texHeight, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, bool isGeneratingMips)
+{
+    CreateForPixels(texWidth, texHeight, imageFormat, tiling, usage, properties, isGeneratingMips);
+
+    UploadContext* pUploadContext = m_pDevice->GetUploadContext();
+
+    // Layout changes, copy and blits are recorded with the rest of the uploads
+    const UploadContext::Staging staging = pUploadContext->AllocateStaging(m_UploadSize);
+    memcpy(staging.pData, pPixels, static_cast<size_t>(m_UploadSize));
+    RecordUpload(pUploadContext, staging.buffer, staging.offset);
+}
+
+void Texture::SetMipSampling(bool isUsingMips)
+{
+    m_Sampler = m_pDevice->GetSamplerCache()->GetLinearSampler(isUsingMips);
+}
+
+void Texture::RecordUpload(UploadContext* pUploadContext, VkBuffer stagingBuffer, VkDeviceSize stagingOffset)
+{
+    if (m_IsBlittingMips && pUploadContext->IsReleasing())
+    {
+        throw std::runtime_error("generated mipmaps cannot be uploaded on a transfer queue!");
+    }
+
+    const VkCommandBuffer commandBuffer = pUploadContext->GetCommandBuffer();
+
+    TransitionImageLayout(commandBuffer, m_ImageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    std::vector<VkBufferImageCopy> regions = m_UploadRegions;
+    for (VkBufferImageCopy& region : regions)
+    {
+        region.bufferOffset += stagingOffset;
+    }
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    if (m_IsBlittingMips)
+    {
+        RecordMipmaps(commandBuffer);
+    }
+    else if (pUploadContext->IsReleasing())
+    {
+        pUploadContext->ReleaseImage(m_Image, m_MipLevels);
+    }
+    else
+    {
+        TransitionImageLayout(commandBuffer, m_ImageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+void Texture::RecordMipmaps(VkCommandBuffer commandBuffer)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = m_Image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.levelCount = 1;
+
+    int32_t mipWidth = m_Width;
+    int32_t mipHeight = m_Height;
+
+    for (uint32_t level = 1; level < m_MipLevels; ++level)
+    {
+        // Previous level was just written, read it as the blit source
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        const int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        const int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // Source level is final
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    // Last level was only ever written
+    barrier.subresourceRange.baseMipLevel = m_MipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
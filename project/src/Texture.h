@@ -2,21 +2,69 @@
 #include <vulkan/vulkan.h>
 #include "Image.h"
 #include <string>
+#include <vector>
+#include <cstdint>
 
 class LogicalDevice;
 class CommandPool;
+class CookedTexture;
+class UploadContext;
 
 class Texture final : public Image
 {
 public:
-	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout);
+	// Render target of the swapchain's size, e.g. a G-buffer image
+	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, VkImageAspectFlagBits aspects, VkImageLayout oldLayout, VkImageLayout newLayout, MemoryCategory category);
 	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkExtent2D swapchainExtent, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, const std::string texturePath);
-	~Texture();
-	void CreateSampler(VkPhysicalDevice pPhysicalDevice);
+	// Uploads RGBA8 pixels that were decoded elsewhere, e.g. on a loading thread
+	// The full mip chain is blitted down from level 0 when isGeneratingMips and the format supports linear blits
+	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, const unsigned char* pPixels, int width, int height, bool isGeneratingMips = true);
+	// Only creates the image for RGBA8 pixels of this size, RecordUpload fills it
+	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, VkFormat imageFormat, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, int width, int height, bool isGeneratingMips);
+	// Only creates the image for the levels of a cooked block compressed texture, RecordUpload fills it as stored
+	// Levels above firstLevel are left out, the image starts at that level's size
+	Texture(LogicalDevice* pDevice, CommandPool* pCommandPool, const CookedTexture& cooked, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, const VkComponentMapping& swizzle, uint32_t firstLevel = 0);
+	// Picks the device's shared sampler, isUsingMips = false clamps sampling to level 0
+	void SetMipSampling(bool isUsingMips = true);
 
 	VkSampler* GetSampler() { return &m_Sampler; }
 
+	static const uint32_t m_InvalidBindlessIndex = UINT32_MAX;
+	// Slot in the bindless texture table, m_InvalidBindlessIndex when the texture is not in one
+	uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
+	void SetBindlessIndex(uint32_t index) { m_BindlessIndex = index; }
+
+	// Cooked level the image's level 0 was taken from
+	uint32_t GetFirstLevel() const { return m_FirstLevel; }
+	// Trades images with a texture of the same format, sampler and bindless slot stay where they are
+	// Lets a shared texture change its resident levels while everything that references it keeps the same pointer
+	void SwapImage(Texture& other);
+
+	// Bytes RecordUpload reads from staging, RGBA8 level 0 or every cooked level back to back
+	VkDeviceSize GetUploadSize() const { return m_UploadSize; }
+	// Copies from staging and blits the mip chain if there is one to generate, leaves every level in SHADER_READ_ONLY_OPTIMAL
+	// A context that releases to another family hands the image over in that layout, blits need the graphics queue
+	void RecordUpload(UploadContext* pUploadContext, VkBuffer stagingBuffer, VkDeviceSize stagingOffset);
+
+	// Decodes a file or an embedded glb image to RGBA8, returns nullptr on failure, safe to call from any thread
+	static unsigned char* LoadPixels(const std::string& texturePath, int* pWidth, int* pHeight);
+	static void FreePixels(unsigned char* pPixels);
+
 private:
-	VkSampler m_Sampler;
-	void CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height);
+	// Owned by the device's sampler cache
+	VkSampler m_Sampler = VK_NULL_HANDLE;
+	uint32_t m_BindlessIndex = m_InvalidBindlessIndex;
+
+	// Relative to the start of the upload in staging
+	std::vector<VkBufferImageCopy> m_UploadRegions;
+	VkDeviceSize m_UploadSize = 0;
+	bool m_IsBlittingMips = false;
+	int m_Width = 0;
+	int m_Height = 0;
+	uint32_t m_FirstLevel = 0;
+
+	void CreateForPixels(int width, int height, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, bool isGeneratingMips);
+	void CreateFromPixels(const unsigned char* pPixels, int width, int height, VkFormat imageFormat, VkImageTiling tiling, VkImageUsageFlagBits usage, VkMemoryPropertyFlagBits properties, bool isGeneratingMips);
+	// Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled, leaves every level in SHADER_READ_ONLY_OPTIMAL
+	void RecordMipmaps(VkCommandBuffer commandBuffer);
 };
\ No newline at end of file
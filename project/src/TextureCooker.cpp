@@ -0,0 +1,700 @@
+#include "TextureCooker.h"
+#include "Texture.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <algorithm>
+#include <array>
+
+// «KTX 20»\r\n\x1A\n
+const unsigned char CookedTexture::m_Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+CookedTexture::CookedTexture(const std::string& ktx2Path)
+	: m_pMapping(new MappedFile(ktx2Path))
+{
+	if (!m_pMapping->IsValid() || m_pMapping->GetSize() < sizeof(Header))
+	{
+		return;
+	}
+
+	const unsigned char* pData = m_pMapping->GetData();
+	const size_t fileSize = m_pMapping->GetSize();
+
+	Header header{};
+	memcpy(&header, pData, sizeof(Header));
+
+	const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+	const uint32_t blockSize = GetBlockSize(format);
+
+	// Only what the cooker writes, no arrays, cube maps, volumes or supercompression
+	if (memcmp(header.identifier, m_Identifier, sizeof(m_Identifier)) != 0 || blockSize == 0 || header.supercompressionScheme != 0
+		|| header.levelCount == 0 || header.faceCount != 1 || header.layerCount > 1 || header.pixelDepth > 0)
+	{
+		return;
+	}
+
+	if (sizeof(Header) + sizeof(LevelIndex) * header.levelCount > fileSize || static_cast<size_t>(header.kvdByteOffset) + header.kvdByteLength > fileSize)
+	{
+		return;
+	}
+
+	ReadKeyValueData(pData + header.kvdByteOffset, header.kvdByteLength);
+
+	std::vector<Level> levels(header.levelCount);
+
+	for (uint32_t i{}; i < header.levelCount; ++i)
+	{
+		LevelIndex index{};
+		memcpy(&index, pData + sizeof(Header) + sizeof(LevelIndex) * i, sizeof(LevelIndex));
+
+		Level& level = levels[i];
+		level.width = std::max(header.pixelWidth >> i, 1u);
+		level.height = std::max(header.pixelHeight >> i, 1u);
+		level.pData = pData + index.byteOffset;
+		level.size = static_cast<size_t>(index.byteLength);
+
+		// Truncated file or a level that is not made of whole blocks
+		const size_t expectedSize = static_cast<size_t>((level.width + 3) / 4) * ((level.height + 3) / 4) * blockSize;
+
+		if (index.byteOffset + index.byteLength > fileSize || level.size != expectedSize)
+		{
+			return;
+		}
+	}
+
+	m_Format = format;
+	m_Levels = std::move(levels);
+}
+
+CookedTexture::~CookedTexture()
+{
+	delete m_pMapping;
+}
+
+size_t CookedTexture::GetDataSize() const
+{
+	size_t size = 0;
+	for (const Level& level : m_Levels)
+	{
+		size += level.size;
+	}
+
+	return size;
+}
+
+void CookedTexture::ReadKeyValueData(const unsigned char* pData, size_t size)
+{
+	size_t offset = 0;
+
+	while (offset + sizeof(uint32_t) <= size)
+	{
+		uint32_t length = 0;
+		memcpy(&length, pData + offset, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		if (offset + length > size)
+		{
+			return;
+		}
+
+		// Key and value are both terminated, the key by the first zero
+		const std::string entry(reinterpret_cast<const char*>(pData + offset), length);
+		const size_t keyEnd = entry.find('\0');
+
+		if (keyEnd != std::string::npos && entry.compare(0, keyEnd, "KTXwriter") == 0)
+		{
+			m_Writer = entry.substr(keyEnd + 1);
+			m_Writer.erase(std::find(m_Writer.begin(), m_Writer.end(), '\0'), m_Writer.end());
+		}
+
+		offset = (offset + length + 3) & ~static_cast<size_t>(3);
+	}
+}
+
+bool CookedTexture::Write(const std::string& ktx2Path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<unsigned char>>& levels, const std::string& writer)
+{
+	const uint32_t blockSize = GetBlockSize(format);
+
+	if (blockSize == 0 || levels.empty())
+	{
+		return false;
+	}
+
+	const std::vector<uint32_t> dfd = BuildDataFormatDescriptor(format);
+
+	// A single KTXwriter entry, its length is not padded but the entry is
+	const std::string keyValue = std::string("KTXwriter") + '\0' + writer + '\0';
+	const uint32_t keyValueLength = static_cast<uint32_t>(keyValue.size());
+
+	std::vector<unsigned char> kvd(sizeof(uint32_t) + keyValue.size());
+	memcpy(kvd.data(), &keyValueLength, sizeof(uint32_t));
+	memcpy(kvd.data() + sizeof(uint32_t), keyValue.data(), keyValue.size());
+	kvd.resize((kvd.size() + 3) & ~static_cast<size_t>(3), 0);
+
+	Header header{};
+	memcpy(header.identifier, m_Identifier, sizeof(m_Identifier));
+	header.vkFormat = static_cast<uint32_t>(format);
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + sizeof(LevelIndex) * levels.size());
+	header.dfdByteLength = static_cast<uint32_t>(sizeof(uint32_t) * dfd.size());
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+	// Smallest level first, every level starts on a whole block
+	std::vector<LevelIndex> index(levels.size());
+	size_t offset = header.kvdByteOffset + header.kvdByteLength;
+
+	for (size_t i = levels.size(); i-- > 0;)
+	{
+		offset = (offset + blockSize - 1) / blockSize * blockSize;
+		index[i] = { offset, levels[i].size(), levels[i].size() };
+		offset += levels[i].size();
+	}
+
+	// Write next to the real file first so a crash never leaves a truncated texture behind
+	const std::string tempPath = ktx2Path + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(index.data()), sizeof(LevelIndex) * index.size());
+	file.write(reinterpret_cast<const char*>(dfd.data()), sizeof(uint32_t) * dfd.size());
+	file.write(reinterpret_cast<const char*>(kvd.data()), kvd.size());
+
+	size_t written = header.kvdByteOffset + header.kvdByteLength;
+	const char padding[16]{};
+
+	for (size_t i = levels.size(); i-- > 0;)
+	{
+		file.write(padding, index[i].byteOffset - written);
+		file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+		written = index[i].byteOffset + index[i].byteLength;
+	}
+
+	file.close();
+
+	if (!file)
+	{
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, ktx2Path, error);
+
+	return !error;
+}
+
+uint32_t CookedTexture::GetBlockSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+std::vector<uint32_t> CookedTexture::BuildDataFormatDescriptor(VkFormat format)
+{
+	// Color models and channel ids of the Khronos data format specification
+	const uint32_t bc1ColorModel = 128;
+	const uint32_t bc3ColorModel = 130;
+	const uint32_t bc5ColorModel = 132;
+	const uint32_t alphaChannel = 15;
+	const uint32_t linearQualifier = 0x10;
+
+	uint32_t colorModel = bc1ColorModel;
+	// Channel id and bit offset of every 64 bit half of the block
+	std::vector<std::pair<uint32_t, uint32_t>> samples{ { 0, 0 } };
+
+	if (format == VK_FORMAT_BC3_SRGB_BLOCK)
+	{
+		colorModel = bc3ColorModel;
+		samples = { { alphaChannel, 0 }, { 0, 64 } };
+	}
+	else if (format == VK_FORMAT_BC5_UNORM_BLOCK)
+	{
+		colorModel = bc5ColorModel;
+		samples = { { 0, 0 }, { 1, 64 } };
+	}
+
+	const bool isSrgb = format != VK_FORMAT_BC5_UNORM_BLOCK;
+	const uint32_t descriptorBlockSize = static_cast<uint32_t>(24 + 16 * samples.size());
+
+	std::vector<uint32_t> words;
+	words.push_back(sizeof(uint32_t) + descriptorBlockSize);
+	// Khronos vendor, basic descriptor type, version 2
+	words.push_back(0);
+	words.push_back(2 | descriptorBlockSize << 16);
+	// BT.709 primaries, sRGB or linear transfer, straight alpha
+	words.push_back(colorModel | 1 << 8 | (isSrgb ? 2u : 1u) << 16);
+	// 4x4 texel block, dimensions are stored minus one
+	words.push_back(3 | 3 << 8);
+	words.push_back(GetBlockSize(format));
+	words.push_back(0);
+
+	for (const auto& [channel, bitOffset] : samples)
+	{
+		// Alpha is never sRGB encoded
+		const uint32_t channelType = channel | (isSrgb && channel == alphaChannel ? linearQualifier : 0);
+
+		// 64 bits stored minus one, no sample position, full range
+		words.push_back(bitOffset | 63 << 16 | channelType << 24);
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(UINT32_MAX);
+	}
+
+	return words;
+}
+
+CookedTexture* TextureCooker::Load(const std::string& texturePath, TextureSlot slot)
+{
+	const std::string cookedPath = GetCookedPath(texturePath, slot);
+
+	if (IsUpToDate(texturePath, cookedPath))
+	{
+		CookedTexture* pCooked = new CookedTexture(cookedPath);
+
+		if (pCooked->IsValid() && pCooked->GetWriter() == GetWriter())
+		{
+			return pCooked;
+		}
+
+		delete pCooked;
+	}
+
+	if (!Cook(texturePath, slot, cookedPath))
+	{
+		return nullptr;
+	}
+
+	CookedTexture* pCooked = new CookedTexture(cookedPath);
+
+	if (!pCooked->IsValid())
+	{
+		delete pCooked;
+		return nullptr;
+	}
+
+	return pCooked;
+}
+
+std::string TextureCooker::GetCookedPath(const std::string& texturePath, TextureSlot slot)
+{
+	static const char* slotNames[] = { "albedo", "normal", "metalrough" };
+
+	std::string path = texturePath;
+
+	// "<file>#<offset>:<size>" is no file name, the offset alone tells the images of a glb apart
+	const size_t hashIndex = texturePath.rfind('#');
+	const size_t colonIndex = texturePath.rfind(':');
+
+	if (hashIndex != std::string::npos && colonIndex != std::string::npos && colonIndex > hashIndex)
+	{
+		path = texturePath.substr(0, hashIndex) + '.' + texturePath.substr(hashIndex + 1, colonIndex - hashIndex - 1);
+	}
+
+	return path + '.' + slotNames[static_cast<int>(slot)] + ".ktx2";
+}
+
+VkComponentMapping TextureCooker::GetSwizzle(TextureSlot slot)
+{
+	// Roughness and metalness sit in red and green, the shaders read them from green and blue like glTF stores them
+	if (slot == TextureSlot::MetalRough)
+	{
+		return { VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_ONE };
+	}
+
+	// Normals only keep x and y, the shader rebuilds z
+	return { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+}
+
+bool TextureCooker::Cook(const std::string& texturePath, TextureSlot slot, const std::string& cookedPath)
+{
+	int width = 0;
+	int height = 0;
+	unsigned char* pPixels = Texture::LoadPixels(texturePath, &width, &height);
+
+	if (!pPixels)
+	{
+		return false;
+	}
+
+	std::vector<MipLevel> chain(1);
+	chain[0].pixels.assign(pPixels, pPixels + static_cast<size_t>(width) * height * 4);
+	chain[0].width = static_cast<uint32_t>(width);
+	chain[0].height = static_cast<uint32_t>(height);
+	Texture::FreePixels(pPixels);
+
+	VkFormat format = VK_FORMAT_BC5_UNORM_BLOCK;
+
+	if (slot == TextureSlot::Diffuse)
+	{
+		// Alpha tested materials need a real alpha channel, everything else gets the smaller BC1
+		bool hasAlpha = false;
+		for (size_t i = 3; i < chain[0].pixels.size() && !hasAlpha; i += 4)
+		{
+			hasAlpha = chain[0].pixels[i] < 255;
+		}
+
+		format = hasAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	}
+
+	while (chain.back().width > 1 || chain.back().height > 1)
+	{
+		MipLevel next{};
+		Downsample(chain.back(), next, slot);
+		chain.push_back(std::move(next));
+	}
+
+	std::vector<std::vector<unsigned char>> levels;
+	levels.reserve(chain.size());
+
+	for (const MipLevel& level : chain)
+	{
+		levels.push_back(EncodeLevel(level, format, slot));
+	}
+
+	return CookedTexture::Write(cookedPath, format, chain[0].width, chain[0].height, levels, GetWriter());
+}
+
+bool TextureCooker::IsUpToDate(const std::string& texturePath, const std::string& cookedPath)
+{
+	std::error_code error;
+	const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+
+	if (error)
+	{
+		return false;
+	}
+
+	const size_t hashIndex = texturePath.rfind('#');
+	const std::string sourcePath = hashIndex == std::string::npos ? texturePath : texturePath.substr(0, hashIndex);
+	const auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+
+	// Shipped without its source, the cooked file is all there is
+	return error || cookedTime >= sourceTime;
+}
+
+std::string TextureCooker::GetWriter()
+{
+	return "VulkanRenderer TextureCooker " + std::to_string(g_TEXTURE_COOK_VERSION);
+}
+
+void TextureCooker::Downsample(const MipLevel& source, MipLevel& target, TextureSlot slot)
+{
+	target.width = std::max(source.width / 2, 1u);
+	target.height = std::max(source.height / 2, 1u);
+	target.pixels.resize(static_cast<size_t>(target.width) * target.height * 4);
+
+	for (uint32_t y{}; y < target.height; ++y)
+	{
+		for (uint32_t x{}; x < target.width; ++x)
+		{
+			// The last row or column of an odd size is dropped, a side of 1 samples itself twice
+			const uint32_t x0 = std::min(x * 2, source.width - 1);
+			const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+			const uint32_t y0 = std::min(y * 2, source.height - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+
+			const unsigned char* pTexels[4] = {
+				&source.pixels[(static_cast<size_t>(y0) * source.width + x0) * 4],
+				&source.pixels[(static_cast<size_t>(y0) * source.width + x1) * 4],
+				&source.pixels[(static_cast<size_t>(y1) * source.width + x0) * 4],
+				&source.pixels[(static_cast<size_t>(y1) * source.width + x1) * 4]
+			};
+
+			unsigned char* pOut = &target.pixels[(static_cast<size_t>(y) * target.width + x) * 4];
+
+			if (slot == TextureSlot::Normal)
+			{
+				glm::vec3 normal{ 0.0f };
+				for (const unsigned char* pTexel : pTexels)
+				{
+					normal += glm::vec3(pTexel[0], pTexel[1], pTexel[2]) / 255.0f * 2.0f - 1.0f;
+				}
+
+				const float length = glm::length(normal);
+				normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+				for (int c{}; c < 3; ++c)
+				{
+					pOut[c] = static_cast<unsigned char>(std::lround((normal[c] * 0.5f + 0.5f) * 255.0f));
+				}
+				pOut[3] = 255;
+			}
+			else
+			{
+				for (int c{}; c < 4; ++c)
+				{
+					// Albedo is stored sRGB encoded, averaging the encoded values would darken every level
+					if (slot == TextureSlot::Diffuse && c < 3)
+					{
+						float sum = 0.0f;
+						for (const unsigned char* pTexel : pTexels)
+						{
+							sum += SrgbToLinear(pTexel[c]);
+						}
+
+						pOut[c] = LinearToSrgb(sum * 0.25f);
+					}
+					else
+					{
+						pOut[c] = static_cast<unsigned char>((pTexels[0][c] + pTexels[1][c] + pTexels[2][c] + pTexels[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+}
+
+std::vector<unsigned char> TextureCooker::EncodeLevel(const MipLevel& level, VkFormat format, TextureSlot slot)
+{
+	const uint32_t blockSize = CookedTexture::GetBlockSize(format);
+	const uint32_t blocksX = (level.width + 3) / 4;
+	const uint32_t blocksY = (level.height + 3) / 4;
+
+	std::vector<unsigned char> blocks(static_cast<size_t>(blocksX) * blocksY * blockSize);
+	unsigned char texels[16 * 4];
+
+	// glTF keeps roughness in green and metalness in blue
+	const int firstChannel = slot == TextureSlot::MetalRough ? 1 : 0;
+
+	for (uint32_t blockY{}; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX{}; blockX < blocksX; ++blockX)
+		{
+			// Blocks hanging over the edge repeat the last row and column
+			for (uint32_t i{}; i < 16; ++i)
+			{
+				const uint32_t x = std::min(blockX * 4 + i % 4, level.width - 1);
+				const uint32_t y = std::min(blockY * 4 + i / 4, level.height - 1);
+				memcpy(&texels[i * 4], &level.pixels[(static_cast<size_t>(y) * level.width + x) * 4], 4);
+			}
+
+			unsigned char* pBlock = &blocks[(static_cast<size_t>(blockY) * blocksX + blockX) * blockSize];
+
+			switch (format)
+			{
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+				EncodeColorBlock(texels, pBlock);
+				break;
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				EncodeChannelBlock(texels, 3, pBlock);
+				EncodeColorBlock(texels, pBlock + 8);
+				break;
+			default:
+				EncodeChannelBlock(texels, firstChannel, pBlock);
+				EncodeChannelBlock(texels, firstChannel + 1, pBlock + 8);
+				break;
+			}
+		}
+	}
+
+	return blocks;
+}
+
+void TextureCooker::EncodeColorBlock(const unsigned char* pTexels, unsigned char* pBlock)
+{
+	glm::vec3 colors[16];
+	glm::vec3 mean{ 0.0f };
+
+	for (int i{}; i < 16; ++i)
+	{
+		colors[i] = glm::vec3(pTexels[i * 4], pTexels[i * 4 + 1], pTexels[i * 4 + 2]);
+		mean += colors[i];
+	}
+	mean /= 16.0f;
+
+	glm::mat3 covariance{ 0.0f };
+	for (const glm::vec3& color : colors)
+	{
+		const glm::vec3 offset = color - mean;
+		covariance += glm::outerProduct(offset, offset);
+	}
+
+	// Principal axis by power iteration, a handful of steps is plenty for 16 colors
+	glm::vec3 axis{ 1.0f };
+	for (int i{}; i < 8; ++i)
+	{
+		const glm::vec3 next = covariance * axis;
+		const float length = glm::length(next);
+
+		if (length < 1e-6f)
+		{
+			break;
+		}
+
+		axis = next / length;
+	}
+	axis = glm::normalize(axis);
+
+	float minProjection = FLT_MAX;
+	float maxProjection = -FLT_MAX;
+	for (const glm::vec3& color : colors)
+	{
+		const float projection = glm::dot(color - mean, axis);
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	auto packRgb565 = [](const glm::vec3& color)
+	{
+		const glm::vec3 clamped = glm::clamp(color, 0.0f, 255.0f);
+		const uint16_t r = static_cast<uint16_t>(std::lround(clamped.x * 31.0f / 255.0f));
+		const uint16_t g = static_cast<uint16_t>(std::lround(clamped.y * 63.0f / 255.0f));
+		const uint16_t b = static_cast<uint16_t>(std::lround(clamped.z * 31.0f / 255.0f));
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	};
+
+	auto unpackRgb565 = [](uint16_t color)
+	{
+		const uint32_t r = color >> 11 & 31;
+		const uint32_t g = color >> 5 & 63;
+		const uint32_t b = color & 31;
+		return glm::vec3(r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+	};
+
+	uint16_t color0 = packRgb565(mean + axis * maxProjection);
+	uint16_t color1 = packRgb565(mean + axis * minProjection);
+
+	// color0 > color1 selects the four color mode, equal endpoints only ever use index 0
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+
+	if (color0 != color1)
+	{
+		glm::vec3 palette[4];
+		palette[0] = unpackRgb565(color0);
+		palette[1] = unpackRgb565(color1);
+		palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+		palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+
+		for (int i{}; i < 16; ++i)
+		{
+			uint32_t bestIndex = 0;
+			float bestDistance = FLT_MAX;
+
+			for (uint32_t p{}; p < 4; ++p)
+			{
+				const glm::vec3 offset = colors[i] - palette[p];
+				const float distance = glm::dot(offset, offset);
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i * 2);
+		}
+	}
+
+	// Little endian regardless of the host
+	pBlock[0] = static_cast<unsigned char>(color0 & 0xFF);
+	pBlock[1] = static_cast<unsigned char>(color0 >> 8);
+	pBlock[2] = static_cast<unsigned char>(color1 & 0xFF);
+	pBlock[3] = static_cast<unsigned char>(color1 >> 8);
+	for (int i{}; i < 4; ++i)
+	{
+		pBlock[4 + i] = static_cast<unsigned char>(indices >> (i * 8) & 0xFF);
+	}
+}
+
+void TextureCooker::EncodeChannelBlock(const unsigned char* pTexels, int channel, unsigned char* pBlock)
+{
+	int minValue = 255;
+	int maxValue = 0;
+
+	for (int i{}; i < 16; ++i)
+	{
+		minValue = std::min(minValue, static_cast<int>(pTexels[i * 4 + channel]));
+		maxValue = std::max(maxValue, static_cast<int>(pTexels[i * 4 + channel]));
+	}
+
+	pBlock[0] = static_cast<unsigned char>(maxValue);
+	pBlock[1] = static_cast<unsigned char>(minValue);
+
+	uint64_t indices = 0;
+
+	if (maxValue > minValue)
+	{
+		// Eight value mode, indices 0 and 1 are the endpoints, 2 to 7 step from the first towards the second
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 1; i < 7; ++i)
+		{
+			palette[i + 1] = ((7 - i) * maxValue + i * minValue + 3) / 7;
+		}
+
+		for (int i{}; i < 16; ++i)
+		{
+			const int value = pTexels[i * 4 + channel];
+			uint64_t bestIndex = 0;
+			int bestDistance = INT_MAX;
+
+			for (int p{}; p < 8; ++p)
+			{
+				const int distance = std::abs(value - palette[p]);
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = static_cast<uint64_t>(p);
+				}
+			}
+
+			indices |= bestIndex << (i * 3);
+		}
+	}
+
+	for (int i{}; i < 6; ++i)
+	{
+		pBlock[2 + i] = static_cast<unsigned char>(indices >> (i * 8) & 0xFF);
+	}
+}
+
+float TextureCooker::SrgbToLinear(unsigned char value)
+{
+	static const std::array<float, 256> table = []()
+	{
+		std::array<float, 256> values{};
+		for (size_t i{}; i < values.size(); ++i)
+		{
+			const float encoded = static_cast<float>(i) / 255.0f;
+			values[i] = encoded <= 0.04045f ? encoded / 12.92f : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+
+	return table[value];
+}
+
+unsigned char TextureCooker::LinearToSrgb(float value)
+{
+	const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return static_cast<unsigned char>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+}
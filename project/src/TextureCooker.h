@@ -0,0 +1,126 @@
+#pragma once
+#include "Structs.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class MappedFile;
+
+// Bump whenever the encoders change, stale cooked files are then rebuilt on the next launch
+const uint32_t g_TEXTURE_COOK_VERSION = 1;
+
+// Single face, single layer KTX2 file without supercompression, every level is a slice of the read-only mapping
+class CookedTexture
+{
+public:
+	struct Level
+	{
+		const unsigned char* pData;
+		size_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	explicit CookedTexture(const std::string& ktx2Path);
+	~CookedTexture();
+
+	CookedTexture(const CookedTexture&) = delete;
+	CookedTexture(CookedTexture&&) noexcept = delete;
+	CookedTexture& operator=(const CookedTexture&) = delete;
+	CookedTexture& operator=(CookedTexture&&) noexcept = delete;
+
+	bool IsValid() const { return !m_Levels.empty(); }
+	VkFormat GetFormat() const { return m_Format; }
+	uint32_t GetWidth() const { return m_Levels.empty() ? 0 : m_Levels[0].width; }
+	uint32_t GetHeight() const { return m_Levels.empty() ? 0 : m_Levels[0].height; }
+	// Level 0 first
+	const std::vector<Level>& GetLevels() const { return m_Levels; }
+	// Every level back to back, what the staging buffer and the image take
+	size_t GetDataSize() const;
+	// KTXwriter value, tells which cooker version wrote the file
+	const std::string& GetWriter() const { return m_Writer; }
+
+	// Levels are passed level 0 first and hold whole blocks, the file stores them smallest first as KTX2 requires
+	static bool Write(const std::string& ktx2Path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<unsigned char>>& levels, const std::string& writer);
+	// Bytes per 4x4 block of the formats the cooker writes, 0 for anything else
+	static uint32_t GetBlockSize(VkFormat format);
+
+private:
+	struct Header
+	{
+		unsigned char identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct LevelIndex
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static const unsigned char m_Identifier[12];
+
+	MappedFile* m_pMapping = nullptr;
+	VkFormat m_Format = VK_FORMAT_UNDEFINED;
+	std::vector<Level> m_Levels;
+	std::string m_Writer;
+
+	void ReadKeyValueData(const unsigned char* pData, size_t size);
+	// Basic data format descriptor for one 4x4 block, prefixed with its total size
+	static std::vector<uint32_t> BuildDataFormatDescriptor(VkFormat format);
+};
+
+// Encodes material images into block compressed KTX2 files with their whole mip chain, next to the source
+// Albedo becomes BC1, or BC3 when it has alpha, normals keep x and y in BC5, roughness and metalness share one BC5
+class TextureCooker
+{
+public:
+	// Maps the cooked file, cooking it first when it is missing, older than the source or from another cooker version
+	// A cooked file without its source is used as is, returns nullptr when neither can be read
+	// Safe to call from several threads as long as they cook different files
+	static CookedTexture* Load(const std::string& texturePath, TextureSlot slot);
+	// "<file>.<slot>.ktx2", embedded glb images use "<glb>.<offset>.<slot>.ktx2"
+	static std::string GetCookedPath(const std::string& texturePath, TextureSlot slot);
+	// Cooked channels are not where the shaders read them for every slot, the image view moves them back
+	static VkComponentMapping GetSwizzle(TextureSlot slot);
+
+private:
+	// RGBA8
+	struct MipLevel
+	{
+		std::vector<unsigned char> pixels;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	static bool Cook(const std::string& texturePath, TextureSlot slot, const std::string& cookedPath);
+	static bool IsUpToDate(const std::string& texturePath, const std::string& cookedPath);
+	static std::string GetWriter();
+
+	// 2x2 box filter, albedo is averaged in linear space and normals are renormalized
+	static void Downsample(const MipLevel& source, MipLevel& target, TextureSlot slot);
+	static std::vector<unsigned char> EncodeLevel(const MipLevel& level, VkFormat format, TextureSlot slot);
+	// BC1 block from the RGB of 16 RGBA8 texels, endpoints fit along the principal axis of the colors
+	static void EncodeColorBlock(const unsigned char* pTexels, unsigned char* pBlock);
+	// BC4 block from one channel of 16 RGBA8 texels, also the alpha half of BC3 and either half of BC5
+	static void EncodeChannelBlock(const unsigned char* pTexels, int channel, unsigned char* pBlock);
+
+	static float SrgbToLinear(unsigned char value);
+	static unsigned char LinearToSrgb(float value);
+};
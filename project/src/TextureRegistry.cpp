@@ -0,0 +1,303 @@
+#include "TextureRegistry.h"
+#include "LogicalDevice.h"
+#include "SamplerCache.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "TextureUploadBatch.h"
+#include "BindlessTextureTable.h"
+#include "TextureStreamer.h"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+
+TextureRegistry::TextureRegistry(LogicalDevice* pDevice, CommandPool* pCommandPool)
+	: m_pDevice(pDevice)
+	, m_pCommandPool(pCommandPool)
+{
+}
+
+TextureRegistry::~TextureRegistry()
+{
+	EndBatch();
+
+	// Anything still referenced goes down with the registry
+	for (auto& [key, entry] : m_Entries)
+	{
+		delete entry.pTexture;
+	}
+}
+
+Texture* TextureRegistry::Acquire(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage)
+{
+	const std::string key = MakeKey(texturePath, format, usage);
+
+	if (Texture* pTexture = FindExisting(key))
+	{
+		return pTexture;
+	}
+
+	int width = 0;
+	int height = 0;
+	unsigned char* pPixels = Texture::LoadPixels(texturePath, &width, &height);
+
+	if (!pPixels)
+	{
+		throw std::runtime_error("failed to load texture image!");
+	}
+
+	Texture* pTexture = Insert(key, pPixels, width, height, format, usage);
+
+	// A batch reads the pixels when it is submitted
+	if (m_pBatch)
+	{
+		m_BatchPixels.push_back(pPixels);
+	}
+	else
+	{
+		Texture::FreePixels(pPixels);
+	}
+
+	return pTexture;
+}
+
+Texture* TextureRegistry::Acquire(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage, const unsigned char* pPixels, int width, int height)
+{
+	const std::string key = MakeKey(texturePath, format, usage);
+
+	if (Texture* pTexture = FindExisting(key))
+	{
+		return pTexture;
+	}
+
+	return Insert(key, pPixels, width, height, format, usage);
+}
+
+Texture* TextureRegistry::AcquireCooked(const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage)
+{
+	// The cooked path already differs per slot, the format is whatever the cooker picked
+	const std::string key = MakeKey(TextureCooker::GetCookedPath(texturePath, slot), VK_FORMAT_UNDEFINED, usage);
+
+	if (Texture* pTexture = FindExisting(key))
+	{
+		return pTexture;
+	}
+
+	CookedTexture* pCooked = TextureCooker::Load(texturePath, slot);
+
+	if (!pCooked)
+	{
+		throw std::runtime_error("failed to load texture image!");
+	}
+
+	Texture* pTexture = Insert(key, texturePath, *pCooked, slot, usage);
+
+	if (m_pBatch)
+	{
+		m_BatchCooked.push_back(pCooked);
+	}
+	else
+	{
+		delete pCooked;
+	}
+
+	return pTexture;
+}
+
+Texture* TextureRegistry::AcquireCooked(const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage, const CookedTexture& cooked)
+{
+	const std::string key = MakeKey(TextureCooker::GetCookedPath(texturePath, slot), VK_FORMAT_UNDEFINED, usage);
+
+	if (Texture* pTexture = FindExisting(key))
+	{
+		return pTexture;
+	}
+
+	return Insert(key, texturePath, cooked, slot, usage);
+}
+
+void TextureRegistry::Release(Texture* pTexture)
+{
+	if (!pTexture)
+	{
+		return;
+	}
+
+	auto keyIt = m_Keys.find(pTexture);
+
+	if (keyIt == m_Keys.end())
+	{
+		throw std::runtime_error("released a texture the registry does not own!");
+	}
+
+	auto entryIt = m_Entries.find(keyIt->second);
+
+	if (--entryIt->second.referenceCount == 0)
+	{
+		if (m_pStreamer)
+		{
+			m_pStreamer->Unregister(entryIt->second.pTexture);
+		}
+
+		if (m_pBindlessTable)
+		{
+			m_pBindlessTable->Remove(entryIt->second.pTexture);
+		}
+
+		delete entryIt->second.pTexture;
+		m_Entries.erase(entryIt);
+		m_Keys.erase(keyIt);
+	}
+}
+
+void TextureRegistry::BeginBatch()
+{
+	if (!m_pBatch)
+	{
+		m_pBatch = new TextureUploadBatch(m_pDevice);
+	}
+}
+
+void TextureRegistry::EndBatch()
+{
+	if (!m_pBatch)
+	{
+		return;
+	}
+
+	m_pBatch->Submit();
+
+	delete m_pBatch;
+	m_pBatch = nullptr;
+
+	for (unsigned char* pPixels : m_BatchPixels)
+	{
+		Texture::FreePixels(pPixels);
+	}
+	m_BatchPixels.clear();
+
+	for (CookedTexture* pCooked : m_BatchCooked)
+	{
+		delete pCooked;
+	}
+	m_BatchCooked.clear();
+}
+
+void TextureRegistry::SetMipSampling(bool isUsingMips)
+{
+	for (auto& [key, entry] : m_Entries)
+	{
+		entry.pTexture->SetMipSampling(isUsingMips);
+
+		if (m_pBindlessTable)
+		{
+			m_pBindlessTable->Update(entry.pTexture);
+		}
+	}
+}
+
+void TextureRegistry::PrintStats() const
+{
+	VkDeviceSize residentBytes = 0;
+	for (const auto& [key, entry] : m_Entries)
+	{
+		residentBytes += entry.size;
+	}
+
+	std::cout << "Texture registry: " << m_Entries.size() << " unique textures (" << residentBytes / (1024.0 * 1024.0) << " MB), "
+		<< m_HitCount << " hits, " << m_MissCount << " misses, " << m_SavedBytes / (1024.0 * 1024.0) << " MB saved, "
+		<< m_pDevice->GetSamplerCache()->GetSamplerCount() << " shared samplers\n";
+}
+
+std::string TextureRegistry::MakeKey(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage)
+{
+	// The same image in sRGB and linear formats are two different textures
+	return texturePath + '|' + std::to_string(format) + '|' + std::to_string(usage);
+}
+
+Texture* TextureRegistry::FindExisting(const std::string& key)
+{
+	auto it = m_Entries.find(key);
+
+	if (it == m_Entries.end())
+	{
+		return nullptr;
+	}
+
+	++it->second.referenceCount;
+	++m_HitCount;
+	m_SavedBytes += it->second.size;
+
+	return it->second.pTexture;
+}
+
+Texture* TextureRegistry::Insert(const std::string& key, const unsigned char* pPixels, int width, int height, VkFormat format, VkImageUsageFlags usage)
+{
+	Texture* pTexture = new Texture(m_pDevice, m_pCommandPool, format, static_cast<VkImageUsageFlagBits>(usage), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, width, height, m_IsGeneratingMips);
+
+	TextureUploadBatch singleUpload{ m_pDevice };
+	TextureUploadBatch& batch = m_pBatch ? *m_pBatch : singleUpload;
+	batch.Add(pTexture, pPixels);
+	FlushUploads(batch);
+
+	// Every level of the chain counts, roughly a third on top of level 0
+	VkDeviceSize size = 0;
+	for (uint32_t level{}; level < pTexture->GetMipLevels(); ++level)
+	{
+		const VkDeviceSize levelWidth = std::max(width >> level, 1);
+		const VkDeviceSize levelHeight = std::max(height >> level, 1);
+		size += levelWidth * levelHeight * 4;
+	}
+
+	return AddEntry(key, pTexture, size);
+}
+
+Texture* TextureRegistry::Insert(const std::string& key, const std::string& texturePath, const CookedTexture& cooked, TextureSlot slot, VkImageUsageFlags usage)
+{
+	// Streamed textures only upload their small levels, the streamer adds the rest when they are needed
+	const uint32_t firstLevel = m_pStreamer ? m_pStreamer->GetBaseLevel(cooked) : 0;
+
+	Texture* pTexture = new Texture(m_pDevice, m_pCommandPool, cooked, static_cast<VkImageUsageFlagBits>(usage), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, TextureCooker::GetSwizzle(slot), firstLevel);
+
+	TextureUploadBatch singleUpload{ m_pDevice };
+	TextureUploadBatch& batch = m_pBatch ? *m_pBatch : singleUpload;
+	batch.Add(pTexture, cooked);
+	FlushUploads(batch);
+
+	AddEntry(key, pTexture, pTexture->GetUploadSize());
+
+	if (m_pStreamer)
+	{
+		m_pStreamer->Register(pTexture, texturePath, slot, usage, cooked);
+	}
+
+	return pTexture;
+}
+
+Texture* TextureRegistry::AddEntry(const std::string& key, Texture* pTexture, VkDeviceSize size)
+{
+	pTexture->SetMipSampling();
+
+	// Uploaded later in a batch, but nothing indexes the slot before the texture is handed out
+	if (m_pBindlessTable)
+	{
+		m_pBindlessTable->Add(pTexture);
+	}
+
+	Entry& entry = m_Entries[key];
+	entry.pTexture = pTexture;
+	entry.referenceCount = 1;
+	entry.size = size;
+
+	m_Keys[pTexture] = key;
+	++m_MissCount;
+
+	return pTexture;
+}
+
+void TextureRegistry::FlushUploads(TextureUploadBatch& batch)
+{
+	if (&batch != m_pBatch || batch.GetPendingBytes() >= m_MaxBatchBytes)
+	{
+		batch.Submit();
+	}
+}
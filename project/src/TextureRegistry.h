@@ -0,0 +1,103 @@
+#pragma once
+#include "Structs.h"
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class LogicalDevice;
+class CommandPool;
+class Texture;
+class CookedTexture;
+class TextureUploadBatch;
+class BindlessTextureTable;
+class TextureStreamer;
+
+// Owns every material texture, one per path, format and usage, shared by all models that reference it
+class TextureRegistry
+{
+public:
+	TextureRegistry(LogicalDevice* pDevice, CommandPool* pCommandPool);
+	~TextureRegistry();
+
+	TextureRegistry(const TextureRegistry&) = delete;
+	TextureRegistry(TextureRegistry&&) noexcept = delete;
+	TextureRegistry& operator=(const TextureRegistry&) = delete;
+	TextureRegistry& operator=(TextureRegistry&&) noexcept = delete;
+
+	// Decodes and uploads on the first request, later ones only add a reference
+	Texture* Acquire(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage);
+	// Same for RGBA8 pixels that were already decoded elsewhere, they are only uploaded when the key is new
+	Texture* Acquire(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage, const unsigned char* pPixels, int width, int height);
+	// Block compressed file cooked from the image for this slot, cooked first when missing or stale, uploaded as stored
+	Texture* AcquireCooked(const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage);
+	// Same for a cooked file that was already mapped elsewhere, it is only uploaded when the key is new
+	Texture* AcquireCooked(const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage, const CookedTexture& cooked);
+	// Destroys the texture with its last reference, nullptr is ignored
+	void Release(Texture* pTexture);
+
+	// Textures created until EndBatch are staged together once it is called
+	// They must not be used before EndBatch, pixels and cooked files passed in must stay alive until then
+	void BeginBatch();
+	void EndBatch();
+
+	// Every texture created from here on gets a slot in the table, which must outlive the registry's textures
+	void SetBindlessTable(BindlessTextureTable* pBindlessTable) { m_pBindlessTable = pBindlessTable; }
+
+	// Cooked textures created from here on start at the streamer's base level and are streamed from there
+	// The streamer must outlive the registry's textures
+	void SetStreamer(TextureStreamer* pStreamer) { m_pStreamer = pStreamer; }
+
+	// Applies to textures created from here on
+	void SetMipGeneration(bool isGenerating) { m_IsGeneratingMips = isGenerating; }
+	// Switches every texture to the shared sampler for this, false clamps sampling to level 0
+	// Rewrites the bindless table, per-model descriptor sets need rewriting after
+	void SetMipSampling(bool isUsingMips);
+
+	uint32_t GetHitCount() const { return m_HitCount; }
+	uint32_t GetMissCount() const { return m_MissCount; }
+	// Image memory the hits would have allocated as separate textures
+	VkDeviceSize GetSavedBytes() const { return m_SavedBytes; }
+	void PrintStats() const;
+
+private:
+	struct Entry
+	{
+		Texture* pTexture = nullptr;
+		uint32_t referenceCount = 0;
+		// At creation, streamed textures change it later
+		VkDeviceSize size = 0;
+	};
+
+	LogicalDevice* m_pDevice;
+	CommandPool* m_pCommandPool;
+
+	std::unordered_map<std::string, Entry> m_Entries;
+	std::unordered_map<Texture*, std::string> m_Keys;
+
+	bool m_IsGeneratingMips = true;
+	BindlessTextureTable* m_pBindlessTable = nullptr;
+	TextureStreamer* m_pStreamer = nullptr;
+
+	// Data a batch holds back is bounded, a larger batch is staged in several parts
+	static const VkDeviceSize m_MaxBatchBytes = 64ull * 1024 * 1024;
+
+	TextureUploadBatch* m_pBatch = nullptr;
+	// Decoded by the registry itself during a batch, freed once it is submitted
+	std::vector<unsigned char*> m_BatchPixels;
+	std::vector<CookedTexture*> m_BatchCooked;
+
+	uint32_t m_HitCount = 0;
+	uint32_t m_MissCount = 0;
+	VkDeviceSize m_SavedBytes = 0;
+
+	static std::string MakeKey(const std::string& texturePath, VkFormat format, VkImageUsageFlags usage);
+	// Returns the shared texture and counts a hit, nullptr when the key is new
+	Texture* FindExisting(const std::string& key);
+	Texture* Insert(const std::string& key, const unsigned char* pPixels, int width, int height, VkFormat format, VkImageUsageFlags usage);
+	Texture* Insert(const std::string& key, const std::string& texturePath, const CookedTexture& cooked, TextureSlot slot, VkImageUsageFlags usage);
+	Texture* AddEntry(const std::string& key, Texture* pTexture, VkDeviceSize size);
+	// Stages right away outside of a batch
+	void FlushUploads(TextureUploadBatch& batch);
+};
@@ -0,0 +1,445 @@
+#include "TextureStreamer.h"
+#include "LogicalDevice.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "TextureUploadBatch.h"
+#include "UploadContext.h"
+#include "BindlessTextureTable.h"
+#include "ThreadPool.h"
+#include "Model.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+// Reads a byte of every page the upload will copy, so the file is paged in on the worker instead of the render thread
+static void TouchPages(const CookedTexture& cooked, uint32_t firstLevel)
+{
+	const size_t pageSize = 4096;
+	unsigned char sum = 0;
+
+	const std::vector<CookedTexture::Level>& levels = cooked.GetLevels();
+	for (size_t level = firstLevel; level < levels.size(); ++level)
+	{
+		const volatile unsigned char* pData = levels[level].pData;
+		for (size_t offset{}; offset < levels[level].size; offset += pageSize)
+		{
+			sum += pData[offset];
+		}
+	}
+
+	(void)sum;
+}
+
+TextureStreamer::TextureStreamer(LogicalDevice* pDevice, CommandPool* pCommandPool, BindlessTextureTable* pBindlessTable, uint32_t framesInFlight, VkDeviceSize budget, uint32_t baseSize)
+	: m_pDevice(pDevice)
+	, m_pCommandPool(pCommandPool)
+	, m_pBindlessTable(pBindlessTable)
+	, m_FramesInFlight(framesInFlight)
+	, m_Budget(budget)
+	, m_BaseSize(baseSize)
+{
+	m_pThreadPool = new ThreadPool{ m_ThreadCount };
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Reads still queued skip the file, the pool waits for the ones already running
+	m_IsStopping = true;
+	delete m_pThreadPool;
+
+	for (LoadedLevels& loaded : m_Loaded)
+	{
+		delete loaded.pCooked;
+	}
+
+	// The device is idle by now
+	for (const UploadedImage& uploaded : m_UploadedImages)
+	{
+		delete uploaded.pImage;
+	}
+
+	FreeRetiredImages(true);
+}
+
+uint32_t TextureStreamer::GetBaseLevel(const CookedTexture& cooked) const
+{
+	const std::vector<CookedTexture::Level>& levels = cooked.GetLevels();
+
+	for (uint32_t level{}; level < levels.size(); ++level)
+	{
+		if (std::max(levels[level].width, levels[level].height) <= m_BaseSize)
+		{
+			return level;
+		}
+	}
+
+	return levels.empty() ? 0 : static_cast<uint32_t>(levels.size()) - 1;
+}
+
+void TextureStreamer::Register(Texture* pTexture, const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage, const CookedTexture& cooked)
+{
+	// Already as sharp as it gets
+	if (pTexture->GetFirstLevel() == 0)
+	{
+		return;
+	}
+
+	Entry& entry = m_Entries[pTexture];
+	entry.texturePath = texturePath;
+	entry.slot = slot;
+	entry.usage = usage;
+	entry.serial = m_NextSerial++;
+	entry.size = std::max(cooked.GetWidth(), cooked.GetHeight());
+	entry.baseLevel = pTexture->GetFirstLevel();
+	entry.residentLevel = entry.baseLevel;
+	entry.wantedLevel = entry.baseLevel;
+	entry.lastNeededFrame = m_FrameNumber;
+
+	for (const CookedTexture::Level& level : cooked.GetLevels())
+	{
+		entry.levelSizes.push_back(static_cast<VkDeviceSize>(level.size));
+	}
+
+	m_ResidentBytes += GetLevelBytes(entry, entry.residentLevel);
+}
+
+void TextureStreamer::Unregister(Texture* pTexture)
+{
+	auto it = m_Entries.find(pTexture);
+
+	if (it == m_Entries.end())
+	{
+		return;
+	}
+
+	// A read still in flight finds no entry with its serial and is dropped
+	if (it->second.isLoading)
+	{
+		m_PendingBytes -= GetPendingBytes(it->second);
+	}
+
+	m_ResidentBytes -= GetLevelBytes(it->second, it->second.residentLevel);
+	m_Entries.erase(it);
+}
+
+void TextureStreamer::BeginFrame()
+{
+	++m_FrameNumber;
+
+	FreeRetiredImages(false);
+	UploadLoaded();
+	SwapInUploaded();
+
+	// Models raise it again if they still need the detail
+	for (auto& [pTexture, entry] : m_Entries)
+	{
+		entry.wantedLevel = static_cast<uint32_t>(entry.levelSizes.size()) - 1;
+	}
+}
+
+void TextureStreamer::RequestModel(Model* pModel, const glm::vec3& cameraPosition, float projectionScale)
+{
+	const glm::vec4& sphere = pModel->GetBoundingSphere();
+	float pixelDiameter = 0.0f;
+
+	for (const glm::mat4& transform : pModel->GetInstances())
+	{
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+		const float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+		const float radius = sphere.w * scale;
+		const float distance = glm::length(center - cameraPosition);
+
+		// Inside the bounds any part of the model can be right in front of the camera
+		if (distance <= radius)
+		{
+			pixelDiameter = FLT_MAX;
+			break;
+		}
+
+		pixelDiameter = std::max(pixelDiameter, 2.0f * radius / distance * projectionScale);
+	}
+
+	for (TextureSlot slot : { TextureSlot::Diffuse, TextureSlot::Normal, TextureSlot::MetalRough })
+	{
+		auto it = m_Entries.find(pModel->GetTexture(slot));
+
+		if (it == m_Entries.end())
+		{
+			continue;
+		}
+
+		Entry& entry = it->second;
+		const uint32_t lastLevel = static_cast<uint32_t>(entry.levelSizes.size()) - 1;
+
+		// Assumes the texture spans the model once, one texel per pixel of its projected diameter is enough
+		uint32_t level = lastLevel;
+		if (pixelDiameter > 0.0f)
+		{
+			const float texelsPerPixel = static_cast<float>(entry.size) / pixelDiameter;
+			level = texelsPerPixel > 1.0f ? std::min(static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel))), lastLevel) : 0;
+		}
+
+		entry.wantedLevel = std::min(entry.wantedLevel, level);
+	}
+}
+
+void TextureStreamer::EndFrame()
+{
+	std::vector<Texture*> requests;
+	std::vector<Texture*> victims;
+
+	for (auto& [pTexture, entry] : m_Entries)
+	{
+		if (entry.wantedLevel <= entry.residentLevel)
+		{
+			entry.lastNeededFrame = m_FrameNumber;
+		}
+
+		if (entry.isLoading)
+		{
+			continue;
+		}
+
+		if (entry.wantedLevel < entry.residentLevel)
+		{
+			requests.push_back(pTexture);
+		}
+		else if (entry.wantedLevel > entry.residentLevel && entry.residentLevel < entry.baseLevel)
+		{
+			victims.push_back(pTexture);
+		}
+	}
+
+	// Blurriest first, then the least recently needed go first
+	std::sort(requests.begin(), requests.end(), [this](Texture* pLeft, Texture* pRight)
+	{
+		const Entry& left = m_Entries[pLeft];
+		const Entry& right = m_Entries[pRight];
+		return left.residentLevel - left.wantedLevel > right.residentLevel - right.wantedLevel;
+	});
+
+	std::sort(victims.begin(), victims.end(), [this](Texture* pLeft, Texture* pRight)
+	{
+		return m_Entries[pLeft].lastNeededFrame < m_Entries[pRight].lastNeededFrame;
+	});
+
+	uint32_t startedCount = 0;
+	size_t nextVictim = 0;
+
+	for (Texture* pTexture : requests)
+	{
+		if (startedCount >= m_MaxLoadsPerFrame)
+		{
+			break;
+		}
+
+		Entry& entry = m_Entries[pTexture];
+		const int64_t growth = static_cast<int64_t>(GetLevelBytes(entry, entry.wantedLevel)) - static_cast<int64_t>(GetLevelBytes(entry, entry.residentLevel));
+
+		// Evicted levels are only freed once the smaller image is swapped in, the budget counts them as gone right away
+		while (IsOverBudget(growth) && nextVictim < victims.size() && startedCount < m_MaxLoadsPerFrame)
+		{
+			Texture* pVictim = victims[nextVictim++];
+			Entry& victim = m_Entries[pVictim];
+
+			StartLoad(pVictim, victim, std::min(victim.wantedLevel, victim.baseLevel));
+			++m_EvictedCount;
+			++startedCount;
+		}
+
+		// Everything resident is still needed, the rest waits until something leaves the view
+		if (IsOverBudget(growth) || startedCount >= m_MaxLoadsPerFrame)
+		{
+			break;
+		}
+
+		StartLoad(pTexture, entry, entry.wantedLevel);
+		++startedCount;
+	}
+}
+
+void TextureStreamer::PrintStats() const
+{
+	std::cout << "Texture streaming: " << m_Entries.size() << " textures, " << m_ResidentBytes / (1024.0 * 1024.0) << " MB of "
+		<< m_Budget / (1024.0 * 1024.0) << " MB resident, " << m_StreamedInCount << " streamed in, " << m_EvictedCount << " evicted\n";
+}
+
+VkDeviceSize TextureStreamer::GetLevelBytes(const Entry& entry, uint32_t firstLevel)
+{
+	VkDeviceSize size = 0;
+	for (size_t level = firstLevel; level < entry.levelSizes.size(); ++level)
+	{
+		size += entry.levelSizes[level];
+	}
+
+	return size;
+}
+
+int64_t TextureStreamer::GetPendingBytes(const Entry& entry)
+{
+	return static_cast<int64_t>(GetLevelBytes(entry, entry.loadingLevel)) - static_cast<int64_t>(GetLevelBytes(entry, entry.residentLevel));
+}
+
+bool TextureStreamer::IsOverBudget(int64_t extraBytes) const
+{
+	return static_cast<int64_t>(m_ResidentBytes) + m_PendingBytes + extraBytes > static_cast<int64_t>(m_Budget);
+}
+
+void TextureStreamer::StartLoad(Texture* pTexture, Entry& entry, uint32_t firstLevel)
+{
+	entry.isLoading = true;
+	entry.loadingLevel = firstLevel;
+	m_PendingBytes += GetPendingBytes(entry);
+
+	const std::string texturePath = entry.texturePath;
+	const TextureSlot slot = entry.slot;
+	const uint64_t serial = entry.serial;
+
+	m_pThreadPool->Enqueue([this, pTexture, serial, texturePath, slot, firstLevel]()
+	{
+		CookedTexture* pCooked = nullptr;
+
+		if (!m_IsStopping)
+		{
+			// The registry cooked it already, this only maps the file
+			pCooked = TextureCooker::Load(texturePath, slot);
+
+			if (pCooked)
+			{
+				TouchPages(*pCooked, firstLevel);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock{ m_LoadedMutex };
+		m_Loaded.push_back({ pTexture, serial, firstLevel, pCooked });
+	});
+}
+
+void TextureStreamer::UploadLoaded()
+{
+	std::vector<LoadedLevels> loaded;
+
+	{
+		std::lock_guard<std::mutex> lock{ m_LoadedMutex };
+		loaded.swap(m_Loaded);
+	}
+
+	if (loaded.empty())
+	{
+		return;
+	}
+
+	UploadContext* pTransferContext = m_pDevice->GetTransferContext();
+	TextureUploadBatch batch{ m_pDevice, pTransferContext };
+
+	for (const LoadedLevels& levels : loaded)
+	{
+		auto it = m_Entries.find(levels.pTexture);
+
+		// Released while its levels were read
+		if (it == m_Entries.end() || it->second.serial != levels.serial)
+		{
+			continue;
+		}
+
+		Entry& entry = it->second;
+
+		// Stays at the levels it has, a later frame asks again
+		if (!levels.pCooked || levels.pCooked->GetLevels().size() != entry.levelSizes.size())
+		{
+			entry.isLoading = false;
+			m_PendingBytes -= GetPendingBytes(entry);
+			continue;
+		}
+
+		Texture* pImage = new Texture(m_pDevice, m_pCommandPool, *levels.pCooked, static_cast<VkImageUsageFlagBits>(entry.usage), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, TextureCooker::GetSwizzle(entry.slot), levels.firstLevel);
+		batch.Add(pImage, *levels.pCooked);
+		m_UploadedImages.push_back({ levels.pTexture, levels.serial, pImage, 0 });
+	}
+
+	// The file data is copied into staging here, the ticket covers every batch the copies may have been split over
+	batch.Submit();
+
+	for (UploadedImage& uploaded : m_UploadedImages)
+	{
+		if (uploaded.ticket == 0)
+		{
+			uploaded.ticket = pTransferContext->GetTicket();
+		}
+	}
+
+	for (const LoadedLevels& levels : loaded)
+	{
+		delete levels.pCooked;
+	}
+}
+
+void TextureStreamer::SwapInUploaded()
+{
+	UploadContext* pTransferContext = m_pDevice->GetTransferContext();
+
+	auto uploadedEnd = std::remove_if(m_UploadedImages.begin(), m_UploadedImages.end(), [this, pTransferContext](const UploadedImage& uploaded)
+	{
+		// Without a transfer queue the upload is flushed ahead of this frame, which is early enough
+		if (!pTransferContext->IsHandedOff(uploaded.ticket))
+		{
+			return false;
+		}
+
+		auto it = m_Entries.find(uploaded.pTexture);
+
+		// Released meanwhile, the acquire that is still to run names the image so it goes the way of a swapped out one
+		if (it == m_Entries.end() || it->second.serial != uploaded.serial)
+		{
+			m_RetiredImages.push_back({ uploaded.pImage, m_FrameNumber });
+			return true;
+		}
+
+		Entry& entry = it->second;
+		entry.isLoading = false;
+		m_PendingBytes -= GetPendingBytes(entry);
+
+		if (uploaded.pImage->GetFirstLevel() < entry.residentLevel)
+		{
+			++m_StreamedInCount;
+		}
+
+		m_ResidentBytes = m_ResidentBytes + GetLevelBytes(entry, uploaded.pImage->GetFirstLevel()) - GetLevelBytes(entry, entry.residentLevel);
+		entry.residentLevel = uploaded.pImage->GetFirstLevel();
+
+		// Frames in flight keep reading the old image through the old slot, the new image gets a slot of its own
+		Texture* pTexture = uploaded.pTexture;
+		pTexture->SwapImage(*uploaded.pImage);
+		uploaded.pImage->SetBindlessIndex(pTexture->GetBindlessIndex());
+		m_pBindlessTable->Add(pTexture);
+
+		m_RetiredImages.push_back({ uploaded.pImage, m_FrameNumber });
+		return true;
+	});
+
+	m_UploadedImages.erase(uploadedEnd, m_UploadedImages.end());
+}
+
+void TextureStreamer::FreeRetiredImages(bool isFreeingAll)
+{
+	// Every frame that could have recorded the old slot has waited for its fence framesInFlight frames later
+	auto retiredEnd = std::remove_if(m_RetiredImages.begin(), m_RetiredImages.end(), [this, isFreeingAll](const RetiredImage& retired)
+	{
+		if (!isFreeingAll && retired.frame + m_FramesInFlight > m_FrameNumber)
+		{
+			return false;
+		}
+
+		// Uploads that were never swapped in have no slot
+		if (retired.pTexture->GetBindlessIndex() != Texture::m_InvalidBindlessIndex)
+		{
+			m_pBindlessTable->Remove(retired.pTexture);
+		}
+
+		delete retired.pTexture;
+		return true;
+	});
+
+	m_RetiredImages.erase(retiredEnd, m_RetiredImages.end());
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "Structs.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+class LogicalDevice;
+class CommandPool;
+class Texture;
+class CookedTexture;
+class BindlessTextureTable;
+class ThreadPool;
+class Model;
+
+// Keeps only the mip levels of cooked textures that the models using them need on screen, within a memory budget
+// Textures start out with the levels no bigger than the base size, sharper levels are read on worker threads
+// and swapped in as a new image in a new bindless slot, the old image and slot are freed once no frame in flight reads them
+// The new images are uploaded on the device's transfer context and only swapped in once it handed them to the graphics queue
+// When the budget runs out, the textures that went longest without needing their sharpest levels drop them first
+class TextureStreamer
+{
+public:
+	TextureStreamer(LogicalDevice* pDevice, CommandPool* pCommandPool, BindlessTextureTable* pBindlessTable, uint32_t framesInFlight, VkDeviceSize budget, uint32_t baseSize);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer(TextureStreamer&&) noexcept = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(TextureStreamer&&) noexcept = delete;
+
+	// Sharpest level a new texture starts with, the first one no bigger than the base size
+	uint32_t GetBaseLevel(const CookedTexture& cooked) const;
+	// The registry hands over every cooked texture it created from the base level, and takes it back before destroying it
+	void Register(Texture* pTexture, const std::string& texturePath, TextureSlot slot, VkImageUsageFlags usage, const CookedTexture& cooked);
+	void Unregister(Texture* pTexture);
+
+	// Once per frame after waiting for its fence and before recording, swaps in what the workers read since the last frame
+	void BeginFrame();
+	// Every model that may be drawn this frame, projectionScale turns radius over distance into pixels
+	void RequestModel(Model* pModel, const glm::vec3& cameraPosition, float projectionScale);
+	// Starts reading the levels requested this frame, evicting to stay within the budget
+	void EndFrame();
+
+	VkDeviceSize GetResidentBytes() const { return m_ResidentBytes; }
+	void PrintStats() const;
+
+private:
+	struct Entry
+	{
+		std::string texturePath;
+		TextureSlot slot = TextureSlot::Diffuse;
+		VkImageUsageFlags usage = 0;
+		// Tells a load apart from one for an earlier texture at the same address
+		uint64_t serial = 0;
+		// Bytes per level, level 0 first
+		std::vector<VkDeviceSize> levelSizes;
+		// Larger side of level 0 in texels
+		uint32_t size = 0;
+		uint32_t baseLevel = 0;
+		uint32_t residentLevel = 0;
+		// Sharpest level any model asked for this frame
+		uint32_t wantedLevel = 0;
+		uint64_t lastNeededFrame = 0;
+		bool isLoading = false;
+		uint32_t loadingLevel = 0;
+	};
+
+	struct LoadedLevels
+	{
+		Texture* pTexture;
+		uint64_t serial;
+		uint32_t firstLevel;
+		// nullptr when the file could not be read
+		CookedTexture* pCooked;
+	};
+
+	struct UploadedImage
+	{
+		Texture* pTexture;
+		uint64_t serial;
+		Texture* pImage;
+		// Transfer context batch the upload was recorded in
+		uint64_t ticket;
+	};
+
+	struct RetiredImage
+	{
+		// Holds the old image and slot
+		Texture* pTexture;
+		uint64_t frame;
+	};
+
+	// Reads started per frame, bounds the uploads and swaps of the next one
+	static const uint32_t m_MaxLoadsPerFrame = 4;
+	// Reading mostly waits on the disk, a couple of workers keep it busy
+	static const uint32_t m_ThreadCount = 2;
+
+	LogicalDevice* m_pDevice;
+	CommandPool* m_pCommandPool;
+	BindlessTextureTable* m_pBindlessTable;
+	uint32_t m_FramesInFlight;
+	VkDeviceSize m_Budget;
+	uint32_t m_BaseSize;
+
+	std::unordered_map<Texture*, Entry> m_Entries;
+	uint64_t m_NextSerial = 1;
+	uint64_t m_FrameNumber = 0;
+
+	VkDeviceSize m_ResidentBytes = 0;
+	// What the reads in flight will add, evictions count negative
+	int64_t m_PendingBytes = 0;
+
+	ThreadPool* m_pThreadPool = nullptr;
+	std::mutex m_LoadedMutex;
+	std::vector<LoadedLevels> m_Loaded;
+	std::atomic<bool> m_IsStopping{ false };
+
+	std::vector<UploadedImage> m_UploadedImages;
+	std::vector<RetiredImage> m_RetiredImages;
+
+	uint32_t m_StreamedInCount = 0;
+	uint32_t m_EvictedCount = 0;
+
+	// Bytes of every level from firstLevel down to the smallest one
+	static VkDeviceSize GetLevelBytes(const Entry& entry, uint32_t firstLevel);
+	// Change in resident bytes once the entry's read in flight is swapped in
+	static int64_t GetPendingBytes(const Entry& entry);
+	bool IsOverBudget(int64_t extraBytes) const;
+	void StartLoad(Texture* pTexture, Entry& entry, uint32_t firstLevel);
+	// Uploads what the workers read since the last frame
+	void UploadLoaded();
+	// Swaps in the images the graphics queue took over
+	void SwapInUploaded();
+	void FreeRetiredImages(bool isFreeingAll);
+};
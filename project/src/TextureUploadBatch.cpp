@@ -0,0 +1,55 @@
+#include "TextureUploadBatch.h"
+#include "LogicalDevice.h"
+#include "UploadContext.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include <cstring>
+
+TextureUploadBatch::TextureUploadBatch(LogicalDevice* pDevice, UploadContext* pUploadContext)
+	: m_pDevice(pDevice)
+	, m_pUploadContext(pUploadContext ? pUploadContext : pDevice->GetUploadContext())
+{
+}
+
+void TextureUploadBatch::Add(Texture* pTexture, const unsigned char* pPixels)
+{
+	m_PendingUploads.push_back({ pTexture, pPixels, nullptr });
+	m_PendingBytes += pTexture->GetUploadSize();
+}
+
+void TextureUploadBatch::Add(Texture* pTexture, const CookedTexture& cooked)
+{
+	m_PendingUploads.push_back({ pTexture, nullptr, &cooked });
+	m_PendingBytes += pTexture->GetUploadSize();
+}
+
+void TextureUploadBatch::Submit()
+{
+	UploadContext* pUploadContext = m_pUploadContext;
+
+	for (const PendingUpload& upload : m_PendingUploads)
+	{
+		const UploadContext::Staging staging = pUploadContext->AllocateStaging(upload.pTexture->GetUploadSize());
+
+		if (upload.pCooked)
+		{
+			// Levels go back to back in file order from the texture's first one, the way it laid out its copy regions
+			const std::vector<CookedTexture::Level>& levels = upload.pCooked->GetLevels();
+			VkDeviceSize offset = 0;
+			for (size_t level = upload.pTexture->GetFirstLevel(); level < levels.size(); ++level)
+			{
+				memcpy(staging.pData + offset, levels[level].pData, levels[level].size);
+				offset += levels[level].size;
+			}
+		}
+		else
+		{
+			memcpy(staging.pData, upload.pPixels, static_cast<size_t>(upload.pTexture->GetUploadSize()));
+		}
+
+		upload.pTexture->RecordUpload(pUploadContext, staging.buffer, staging.offset);
+	}
+
+	m_PendingUploads.clear();
+	m_PendingBytes = 0;
+}
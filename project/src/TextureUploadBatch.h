@@ -0,0 +1,49 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+class LogicalDevice;
+class Texture;
+class CookedTexture;
+class UploadContext;
+
+// Holds back the textures of a batch and stages them all at once in the device's upload context
+// Data handed to Add is only read by Submit and must stay alive until then
+// The textures are usable by anything submitted to the graphics queue after the context's next flush, or once handed off by a transfer context
+class TextureUploadBatch
+{
+public:
+	// Stages in the device's upload context when pUploadContext is nullptr
+	explicit TextureUploadBatch(LogicalDevice* pDevice, UploadContext* pUploadContext = nullptr);
+	~TextureUploadBatch() = default;
+
+	TextureUploadBatch(const TextureUploadBatch&) = delete;
+	TextureUploadBatch(TextureUploadBatch&&) noexcept = delete;
+	TextureUploadBatch& operator=(const TextureUploadBatch&) = delete;
+	TextureUploadBatch& operator=(TextureUploadBatch&&) noexcept = delete;
+
+	// RGBA8 level 0 of a texture created for pixels
+	void Add(Texture* pTexture, const unsigned char* pPixels);
+	// Every level of a texture created for this cooked file, from the texture's first level on
+	void Add(Texture* pTexture, const CookedTexture& cooked);
+
+	bool IsEmpty() const { return m_PendingUploads.empty(); }
+	VkDeviceSize GetPendingBytes() const { return m_PendingBytes; }
+
+	// Copies everything added since the last call into the staging ring and records the uploads, without submitting
+	void Submit();
+
+private:
+	struct PendingUpload
+	{
+		Texture* pTexture;
+		const unsigned char* pPixels;
+		const CookedTexture* pCooked;
+	};
+
+	LogicalDevice* m_pDevice;
+	UploadContext* m_pUploadContext;
+
+	std::vector<PendingUpload> m_PendingUploads;
+	VkDeviceSize m_PendingBytes = 0;
+};
@@ -0,0 +1,126 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	m_Workers.reserve(threadCount);
+	for (uint32_t i{}; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Tasks.push(std::move(task));
+	}
+	m_Condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::atomic<size_t> nextIndex{ 0 };
+	std::exception_ptr exception{};
+	std::mutex exceptionMutex{};
+
+	auto runRange = [&]()
+	{
+		for (size_t i = nextIndex++; i < count; i = nextIndex++)
+		{
+			try
+			{
+				func(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock{ exceptionMutex };
+				if (!exception)
+				{
+					exception = std::current_exception();
+				}
+			}
+		}
+	};
+
+	// No point waking more workers than there is work
+	const size_t helperCount = std::min(static_cast<size_t>(m_Workers.size()), count - 1);
+
+	std::mutex doneMutex{};
+	std::condition_variable doneCondition{};
+	size_t helpersDone = 0;
+
+	for (size_t i{}; i < helperCount; ++i)
+	{
+		Enqueue([&]()
+		{
+			runRange();
+
+			std::lock_guard<std::mutex> lock{ doneMutex };
+			++helpersDone;
+			doneCondition.notify_one();
+		});
+	}
+
+	// The calling thread works too instead of idling
+	runRange();
+
+	std::unique_lock<std::mutex> lock{ doneMutex };
+	doneCondition.wait(lock, [&]() { return helpersDone == helperCount; });
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_Condition.wait(lock, [this]() { return m_IsStopping || !m_Tasks.empty(); });
+
+			if (m_IsStopping && m_Tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+class ThreadPool
+{
+public:
+	// 0 uses one worker per hardware thread, minus the calling thread
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) noexcept = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+	void Enqueue(std::function<void()> task);
+
+	// Runs func(i) for every i in [0, count) on the workers and the calling thread, blocks until all are done
+	// The first exception thrown by func is rethrown on the calling thread
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_IsStopping = false;
+
+	void WorkerLoop();
+};
@@ -0,0 +1,486 @@
+#include "UploadContext.h"
+#include "LogicalDevice.h"
+#include "Buffer.h"
+#include <stdexcept>
+#include <cstring>
+
+UploadContext::UploadContext(LogicalDevice* pDevice, uint32_t queueFamilyIndex, VkDeviceSize ringSize, UploadContext* pAcquiringContext)
+	: m_pDevice(pDevice)
+	, m_QueueFamilyIndex(queueFamilyIndex)
+	, m_pAcquiringContext(pAcquiringContext)
+	, m_RingSize(ringSize)
+{
+	vkGetDeviceQueue(m_pDevice->GetVkDevice(), queueFamilyIndex, 0, &m_Queue);
+
+	// A queue without graphics only knows the transfer stage, the acquire makes the writes visible to the rest
+	m_BufferReadStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	m_BufferReadAccess = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	if (!m_pAcquiringContext)
+	{
+		m_BufferReadStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		m_BufferReadAccess |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	if (vkCreateCommandPool(m_pDevice->GetVkDevice(), &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	Buffer::CreateBuffer(m_pDevice, m_RingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_RingBuffer, m_RingAllocation, MemoryCategory::Staging);
+	m_pRingData = m_RingAllocation.pMapped;
+}
+
+UploadContext::~UploadContext()
+{
+	WaitIdle();
+
+	for (const Batch& batch : m_FreeBatches)
+	{
+		vkDestroyFence(m_pDevice->GetVkDevice(), batch.fence, nullptr);
+		vkDestroySemaphore(m_pDevice->GetVkDevice(), batch.semaphore, nullptr);
+	}
+
+	// Frees the command buffers with it
+	vkDestroyCommandPool(m_pDevice->GetVkDevice(), m_CommandPool, nullptr);
+
+	vkDestroyBuffer(m_pDevice->GetVkDevice(), m_RingBuffer, nullptr);
+	m_pDevice->GetMemoryAllocator()->Free(m_RingAllocation);
+}
+
+UploadContext::Staging UploadContext::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+{
+	if (size > m_RingSize)
+	{
+		VkBuffer buffer;
+		MemoryAllocation allocation;
+		Buffer::CreateBuffer(m_pDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, allocation, MemoryCategory::Staging);
+
+		GetCommandBuffer();
+		m_Recording.dedicatedBuffers.emplace_back(buffer, allocation);
+
+		return { allocation.pMapped, buffer, 0 };
+	}
+
+	uint64_t start = 0;
+
+	while (true)
+	{
+		RestartEmptyRing();
+
+		start = (m_RingHead + alignment - 1) / alignment * alignment;
+
+		// An allocation never wraps around the end of the ring
+		if (start % m_RingSize + size > m_RingSize)
+		{
+			start += m_RingSize - start % m_RingSize;
+		}
+
+		if (start + size - m_RingTail <= m_RingSize)
+		{
+			break;
+		}
+
+		// Only the batch being recorded holds the ring
+		if (m_InFlight.empty())
+		{
+			Flush();
+		}
+
+		// An empty ring restarts at its beginning and always fits, something has to be in flight here
+		if (m_InFlight.empty())
+		{
+			throw std::runtime_error("staging ring is full without a batch holding it!");
+		}
+
+		RetireOldest(true);
+	}
+
+	GetCommandBuffer();
+	m_RingHead = start + size;
+
+	const VkDeviceSize offset = start % m_RingSize;
+	return { m_pRingData + offset, m_RingBuffer, offset };
+}
+
+VkCommandBuffer UploadContext::GetCommandBuffer()
+{
+	if (m_IsRecording)
+	{
+		return m_Recording.commandBuffer;
+	}
+
+	if (!m_FreeBatches.empty())
+	{
+		m_Recording = std::move(m_FreeBatches.back());
+		m_FreeBatches.pop_back();
+	}
+	else
+	{
+		m_Recording = Batch{};
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = m_CommandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_pDevice->GetVkDevice(), &allocInfo, &m_Recording.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(m_pDevice->GetVkDevice(), &fenceInfo, nullptr, &m_Recording.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		if (m_pAcquiringContext)
+		{
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			if (vkCreateSemaphore(m_pDevice->GetVkDevice(), &semaphoreInfo, nullptr, &m_Recording.semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload semaphore!");
+			}
+		}
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(m_Recording.commandBuffer, &beginInfo);
+	m_IsRecording = true;
+
+	return m_Recording.commandBuffer;
+}
+
+void UploadContext::UploadBuffer(VkBuffer dstBuffer, const void* pData, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	const Staging staging = AllocateStaging(size);
+	memcpy(staging.pData, pData, static_cast<size_t>(size));
+
+	CopyStaging(staging, dstBuffer, size, dstOffset);
+}
+
+void UploadContext::CopyStaging(const Staging& staging, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = staging.offset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(GetCommandBuffer(), staging.buffer, dstBuffer, 1, &copyRegion);
+
+	m_HasBufferWrites = true;
+}
+
+void UploadContext::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	// The source may have been written earlier in this batch
+	RecordBufferBarrier();
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(GetCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+
+	m_HasBufferWrites = true;
+}
+
+void UploadContext::ReleaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (!m_pAcquiringContext || size == 0)
+	{
+		return;
+	}
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = m_QueueFamilyIndex;
+	barrier.dstQueueFamilyIndex = m_pAcquiringContext->GetQueueFamilyIndex();
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	// The acquire repeats the barrier, what it makes visible is up to the acquiring context
+	m_Recording.bufferReleases.push_back(barrier);
+}
+
+void UploadContext::ReleaseImage(VkImage image, uint32_t mipLevels)
+{
+	if (!m_pAcquiringContext)
+	{
+		return;
+	}
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = m_QueueFamilyIndex;
+	barrier.dstQueueFamilyIndex = m_pAcquiringContext->GetQueueFamilyIndex();
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	m_Recording.imageReleases.push_back(barrier);
+}
+
+void UploadContext::HandOff()
+{
+	if (!m_pAcquiringContext)
+	{
+		return;
+	}
+
+	// In submission order, a batch is only handed off after the ones before it
+	for (Batch& batch : m_InFlight)
+	{
+		if (batch.isHandedOff)
+		{
+			continue;
+		}
+
+		if (vkGetFenceStatus(m_pDevice->GetVkDevice(), batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		if (!batch.bufferReleases.empty() || !batch.imageReleases.empty())
+		{
+			m_pAcquiringContext->Acquire(batch.semaphore, batch.bufferReleases, batch.imageReleases);
+			batch.acquireTicket = m_pAcquiringContext->GetTicket();
+		}
+
+		batch.isHandedOff = true;
+		m_HandedOffTicket = batch.ticket;
+	}
+}
+
+void UploadContext::FinishHandOff()
+{
+	if (!m_pAcquiringContext)
+	{
+		return;
+	}
+
+	Flush();
+
+	std::vector<VkFence> fences;
+	for (const Batch& batch : m_InFlight)
+	{
+		if (!batch.isHandedOff)
+		{
+			fences.push_back(batch.fence);
+		}
+	}
+
+	if (!fences.empty())
+	{
+		vkWaitForFences(m_pDevice->GetVkDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+	}
+
+	HandOff();
+}
+
+void UploadContext::Acquire(VkSemaphore semaphore, const std::vector<VkBufferMemoryBarrier>& bufferBarriers, const std::vector<VkImageMemoryBarrier>& imageBarriers)
+{
+	std::vector<VkBufferMemoryBarrier> bufferAcquires = bufferBarriers;
+	for (VkBufferMemoryBarrier& barrier : bufferAcquires)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	std::vector<VkImageMemoryBarrier> imageAcquires = imageBarriers;
+	for (VkImageMemoryBarrier& barrier : imageAcquires)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	// Chained to the semaphore wait, which waits at the transfer stage
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, static_cast<uint32_t>(bufferAcquires.size()), bufferAcquires.data(), static_cast<uint32_t>(imageAcquires.size()), imageAcquires.data());
+
+	m_Recording.waitSemaphores.push_back(semaphore);
+}
+
+bool UploadContext::IsComplete(uint64_t ticket)
+{
+	while (!m_InFlight.empty() && IsRetirable(m_InFlight.front()))
+	{
+		RetireOldest(false);
+	}
+
+	return m_CompletedTicket >= ticket;
+}
+
+void UploadContext::Flush()
+{
+	if (!m_IsRecording)
+	{
+		return;
+	}
+
+	RecordBufferBarrier();
+	vkEndCommandBuffer(m_Recording.commandBuffer);
+
+	const std::vector<VkPipelineStageFlags> waitStages(m_Recording.waitSemaphores.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+	const bool isReleasing = !m_Recording.bufferReleases.empty() || !m_Recording.imageReleases.empty();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_Recording.waitSemaphores.size());
+	submitInfo.pWaitSemaphores = m_Recording.waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_Recording.commandBuffer;
+	submitInfo.signalSemaphoreCount = isReleasing ? 1 : 0;
+	submitInfo.pSignalSemaphores = &m_Recording.semaphore;
+
+	if (vkQueueSubmit(m_Queue, 1, &submitInfo, m_Recording.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit uploads!");
+	}
+
+	m_Recording.ticket = m_NextTicket++;
+	m_Recording.ringEnd = m_RingHead;
+	m_InFlight.push_back(std::move(m_Recording));
+	m_IsRecording = false;
+	++m_SubmitCount;
+
+	// Frees what already finished without blocking
+	IsComplete(0);
+}
+
+void UploadContext::Wait(uint64_t ticket)
+{
+	if (m_IsRecording && ticket >= m_NextTicket)
+	{
+		Flush();
+	}
+
+	while (m_CompletedTicket < ticket && !m_InFlight.empty())
+	{
+		RetireOldest(true);
+	}
+}
+
+void UploadContext::RecordBufferBarrier()
+{
+	if (!m_HasBufferWrites)
+	{
+		return;
+	}
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = m_BufferReadAccess;
+
+	vkCmdPipelineBarrier(m_Recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, m_BufferReadStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	m_HasBufferWrites = false;
+}
+
+bool UploadContext::IsRetirable(const Batch& batch)
+{
+	if (vkGetFenceStatus(m_pDevice->GetVkDevice(), batch.fence) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// The semaphore is only signaled again once the acquire waited for it
+	return !m_pAcquiringContext || (batch.isHandedOff && m_pAcquiringContext->IsComplete(batch.acquireTicket));
+}
+
+void UploadContext::RestartEmptyRing()
+{
+	if (m_RingTail != m_RingHead)
+	{
+		return;
+	}
+
+	// Batches still in flight end where the ring is empty, they hold none of it
+	for (Batch& batch : m_InFlight)
+	{
+		batch.ringEnd = 0;
+	}
+
+	m_RingHead = 0;
+	m_RingTail = 0;
+}
+
+void UploadContext::RetireOldest(bool isWaiting)
+{
+	if (isWaiting)
+	{
+		vkWaitForFences(m_pDevice->GetVkDevice(), 1, &m_InFlight.front().fence, VK_TRUE, UINT64_MAX);
+
+		if (m_pAcquiringContext)
+		{
+			HandOff();
+			m_pAcquiringContext->Wait(m_InFlight.front().acquireTicket);
+		}
+	}
+
+	Batch batch = std::move(m_InFlight.front());
+	m_InFlight.pop_front();
+
+	m_RingTail = batch.ringEnd;
+	m_CompletedTicket = batch.ticket;
+
+	for (auto& [buffer, allocation] : batch.dedicatedBuffers)
+	{
+		vkDestroyBuffer(m_pDevice->GetVkDevice(), buffer, nullptr);
+		m_pDevice->GetMemoryAllocator()->Free(allocation);
+	}
+	batch.dedicatedBuffers.clear();
+	batch.bufferReleases.clear();
+	batch.imageReleases.clear();
+	batch.waitSemaphores.clear();
+	batch.isHandedOff = false;
+	batch.acquireTicket = 0;
+
+	vkResetFences(m_pDevice->GetVkDevice(), 1, &batch.fence);
+	vkResetCommandBuffer(batch.commandBuffer, 0);
+	m_FreeBatches.push_back(std::move(batch));
+}
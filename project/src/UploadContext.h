@@ -0,0 +1,140 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "MemoryAllocator.h"
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
+
+class LogicalDevice;
+
+// Records every upload copy and layout transition into one command buffer, staged through one persistently mapped ring
+// A flush submits them with a fence and returns right away, callers only wait for the ticket of the data they need
+// Work submitted to the graphics queue after a flush sees the uploads without waiting, render thread only
+// A context on another queue family releases what it uploads to an acquiring context, which takes it over once the copies completed
+class UploadContext
+{
+public:
+	struct Staging
+	{
+		unsigned char* pData;
+		VkBuffer buffer;
+		VkDeviceSize offset;
+	};
+
+	UploadContext(LogicalDevice* pDevice, uint32_t queueFamilyIndex, VkDeviceSize ringSize, UploadContext* pAcquiringContext = nullptr);
+	~UploadContext();
+
+	UploadContext(const UploadContext&) = delete;
+	UploadContext(UploadContext&&) noexcept = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+	UploadContext& operator=(UploadContext&&) noexcept = delete;
+
+	// Copy offsets must be multiples of the texel or block size, 16 covers every format the renderer uploads
+	static const VkDeviceSize m_DefaultAlignment = 16;
+
+	// Room for size bytes that commands recorded from here on may read, valid until their batch completes
+	// Flushes and waits for older batches when the ring is full, requests larger than the ring get a buffer of their own
+	Staging AllocateStaging(VkDeviceSize size, VkDeviceSize alignment = m_DefaultAlignment);
+	// Command buffer of the batch being recorded, begun on first use
+	VkCommandBuffer GetCommandBuffer();
+
+	// Stages the data right away and records the copy, the source may be freed when this returns
+	void UploadBuffer(VkBuffer dstBuffer, const void* pData, VkDeviceSize size, VkDeviceSize dstOffset);
+	// Records the copy out of staging the caller already wrote, for data produced straight into the ring
+	// Fill it before allocating more, a full ring flushes the batch
+	void CopyStaging(const Staging& staging, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset);
+	// Ordered after every buffer write recorded before it
+	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset);
+
+	uint32_t GetQueueFamilyIndex() const { return m_QueueFamilyIndex; }
+	// What it uploads belongs to the acquiring context's family only once handed off, nothing else may use it before
+	bool IsReleasing() const { return m_pAcquiringContext != nullptr; }
+	// Release the range or every level to the acquiring family after the writes recorded so far, nothing to do without one
+	void ReleaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+	// Moves the levels from TRANSFER_DST_OPTIMAL to SHADER_READ_ONLY_OPTIMAL on the way
+	void ReleaseImage(VkImage image, uint32_t mipLevels);
+	// Once per frame before the acquiring context flushes, records the acquires of every batch that completed into it
+	// Its flush waits for the batch's semaphore, which is signaled by then, so no frame waits on the copies
+	void HandOff();
+	// Flushes, blocks until this queue finished every batch and hands them all off, the acquiring queue is not waited for
+	// Commands recorded into the acquiring context afterwards may read everything released so far
+	void FinishHandOff();
+	// The acquiring context flushes the acquire ahead of the next frame, always true for a context that does not release
+	bool IsHandedOff(uint64_t ticket) const { return !m_pAcquiringContext || m_HandedOffTicket >= ticket; }
+	// Acquiring side of a release by another family, the next flush waits for the semaphore before running the batch
+	void Acquire(VkSemaphore semaphore, const std::vector<VkBufferMemoryBarrier>& bufferBarriers, const std::vector<VkImageMemoryBarrier>& imageBarriers);
+
+	// What the batch being recorded completes with
+	uint64_t GetTicket() const { return m_NextTicket; }
+	bool IsComplete(uint64_t ticket);
+	// Submits the batch being recorded, if anything was, without waiting
+	void Flush();
+	// Blocks until the batch with this ticket completed, flushing it first if it is still being recorded
+	// Also covers everything submitted to the queue before it, e.g. frames that still read a buffer
+	void Wait(uint64_t ticket);
+	void WaitIdle() { Wait(m_NextTicket); }
+
+	uint32_t GetSubmitCount() const { return m_SubmitCount; }
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		uint64_t ticket = 0;
+		// Ring position after the batch's last allocation, everything before it is free once the batch completes
+		uint64_t ringEnd = 0;
+		// Staging too large for the ring
+		std::vector<std::pair<VkBuffer, MemoryAllocation>> dedicatedBuffers;
+		// Signaled by batches with releases, waited on by the acquiring context
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		std::vector<VkBufferMemoryBarrier> bufferReleases;
+		std::vector<VkImageMemoryBarrier> imageReleases;
+		bool isHandedOff = false;
+		// Acquiring context's batch that waits for the semaphore, the batch is reused once that one completed
+		uint64_t acquireTicket = 0;
+		// Semaphores of other families' batches this one acquires from
+		std::vector<VkSemaphore> waitSemaphores;
+	};
+
+	LogicalDevice* m_pDevice;
+	uint32_t m_QueueFamilyIndex;
+	UploadContext* m_pAcquiringContext;
+	VkQueue m_Queue = VK_NULL_HANDLE;
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+	VkBuffer m_RingBuffer = VK_NULL_HANDLE;
+	MemoryAllocation m_RingAllocation;
+	unsigned char* m_pRingData = nullptr;
+	VkDeviceSize m_RingSize;
+	// Positions only grow, the offset in the ring is the position modulo its size
+	uint64_t m_RingHead = 0;
+	uint64_t m_RingTail = 0;
+
+	Batch m_Recording;
+	bool m_IsRecording = false;
+	// A copy since the last barrier wrote a buffer
+	bool m_HasBufferWrites = false;
+	// Where buffer writes are read after the barrier, only transfers on a queue that releases them
+	VkPipelineStageFlags m_BufferReadStages = 0;
+	VkAccessFlags m_BufferReadAccess = 0;
+
+	// Oldest first, they complete in submission order
+	std::deque<Batch> m_InFlight;
+	// Command buffers and fences of completed batches, reused before allocating new ones
+	std::vector<Batch> m_FreeBatches;
+
+	uint64_t m_NextTicket = 1;
+	uint64_t m_CompletedTicket = 0;
+	uint64_t m_HandedOffTicket = 0;
+	uint32_t m_SubmitCount = 0;
+
+	// Makes buffer writes recorded so far visible to transfers, vertex input and shaders after it
+	void RecordBufferBarrier();
+	// Completed and, when releasing, acquired by a batch of the acquiring context that completed as well
+	bool IsRetirable(const Batch& batch);
+	void RetireOldest(bool isWaiting);
+	// Nothing holds the ring anymore, start over at its beginning so a whole ring fits again
+	void RestartEmptyRing();
+};
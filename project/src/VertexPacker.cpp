@@ -0,0 +1,112 @@
+#include "VertexPacker.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+glm::vec4 VertexPacker::Pack(VertexFormat format, const Vertex* pVertices, uint32_t count, unsigned char* pPositions, unsigned char* pAttributes)
+{
+	if (format == VertexFormat::Full)
+	{
+		for (uint32_t i{}; i < count; ++i)
+		{
+			const Vertex& vertex = pVertices[i];
+			const VertexAttributes attributes{ vertex.normal, vertex.tangent, vertex.color, vertex.texCoord };
+
+			std::memcpy(pPositions + sizeof(glm::vec3) * i, &vertex.pos, sizeof(glm::vec3));
+			std::memcpy(pAttributes + sizeof(VertexAttributes) * i, &attributes, sizeof(VertexAttributes));
+		}
+
+		return glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+
+	glm::vec3 minimum{ 0.0f };
+	glm::vec3 maximum{ 0.0f };
+
+	if (count > 0)
+	{
+		minimum = pVertices[0].pos;
+		maximum = pVertices[0].pos;
+	}
+
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		minimum = glm::min(minimum, pVertices[i].pos);
+		maximum = glm::max(maximum, pVertices[i].pos);
+	}
+
+	// A cube instead of the box keeps the scale uniform, costing a bit of precision on the shorter axes
+	const glm::vec3 extent = maximum - minimum;
+	float scale = std::max({ extent.x, extent.y, extent.z });
+
+	if (scale <= 0.0f)
+	{
+		scale = 1.0f;
+	}
+
+	const uint32_t attributeStride = VertexStreams::GetAttributeStride(format);
+
+	for (uint32_t i{}; i < count; ++i)
+	{
+		const Vertex& vertex = pVertices[i];
+		PackedPosition packedPosition{};
+		PackedAttributes packedAttributes{};
+
+		const glm::vec3 position = glm::clamp((vertex.pos - minimum) / scale, 0.0f, 1.0f);
+		const glm::vec2 normal = EncodeOctahedral(vertex.normal);
+		const glm::vec2 tangent = EncodeOctahedral(glm::vec3{ vertex.tangent });
+
+		for (int axis{}; axis < 3; ++axis)
+		{
+			packedPosition.position[axis] = static_cast<uint16_t>(std::lround(position[axis] * 65535.0f));
+		}
+
+		packedPosition.position[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+
+		for (int axis{}; axis < 2; ++axis)
+		{
+			packedAttributes.normal[axis] = static_cast<int16_t>(std::lround(normal[axis] * 32767.0f));
+			packedAttributes.tangent[axis] = static_cast<int16_t>(std::lround(tangent[axis] * 32767.0f));
+			packedAttributes.texCoord[axis] = glm::packHalf1x16(vertex.texCoord[axis]);
+		}
+
+		for (int channel{}; channel < 3; ++channel)
+		{
+			packedAttributes.color[channel] = static_cast<uint8_t>(std::lround(glm::clamp(vertex.color[channel], 0.0f, 1.0f) * 255.0f));
+		}
+
+		packedAttributes.color[3] = 255;
+
+		std::memcpy(pPositions + sizeof(PackedPosition) * i, &packedPosition, sizeof(PackedPosition));
+		std::memcpy(pAttributes + static_cast<size_t>(attributeStride) * i, &packedAttributes, attributeStride);
+	}
+
+	return glm::vec4{ minimum, scale };
+}
+
+glm::mat4 VertexPacker::GetDequantizationTransform(const glm::vec4& dequantization)
+{
+	return glm::scale(glm::translate(glm::mat4{ 1.0f }, glm::vec3{ dequantization }), glm::vec3{ dequantization.w });
+}
+
+glm::vec2 VertexPacker::EncodeOctahedral(const glm::vec3& vector)
+{
+	const float length = std::abs(vector.x) + std::abs(vector.y) + std::abs(vector.z);
+
+	if (length == 0.0f)
+	{
+		return glm::vec2{ 0.0f };
+	}
+
+	const glm::vec3 projected = vector / length;
+	glm::vec2 encoded{ projected.x, projected.y };
+
+	// The lower half folds over the diagonals onto the corners
+	if (projected.z < 0.0f)
+	{
+		encoded.x = (1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return glm::clamp(encoded, -1.0f, 1.0f);
+}
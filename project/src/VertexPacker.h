@@ -0,0 +1,18 @@
+#pragma once
+#include "Structs.h"
+#include <cstdint>
+
+// Splits Vertex data into the position and attribute streams of a VertexFormat on its way to the vertex buffers
+class VertexPacker
+{
+public:
+	// Writes count vertices split into the position and attribute streams at the strides of the format, Full only splits them
+	// Returns the dequantization of the positions, offset in xyz and uniform scale in w, which is 0, 0, 0, 1 for Full
+	static glm::vec4 Pack(VertexFormat format, const Vertex* pVertices, uint32_t count, unsigned char* pPositions, unsigned char* pAttributes);
+
+	// Maps packed unorm positions back to mesh space, uniform so normals stay valid under it
+	static glm::mat4 GetDequantizationTransform(const glm::vec4& dequantization);
+
+	// Unit vector to the octahedron unfolded onto [-1, 1]^2, a zero vector maps to the origin
+	static glm::vec2 EncodeOctahedral(const glm::vec3& vector);
+};
@@ -0,0 +1,136 @@
+#include "VertexWelder.h"
+#include <cstring>
+
+VertexWelder::VertexWelder(std::vector<Vertex>& vertices, size_t expectedVertexCount)
+	: m_Vertices(vertices)
+{
+	// Stay at or below half full so probe sequences remain short
+	size_t capacity = 64;
+	while (capacity < expectedVertexCount * 2)
+	{
+		capacity *= 2;
+	}
+
+	m_Slots.assign(capacity, Slot{ 0, m_EmptySlot });
+	m_Mask = capacity - 1;
+
+	m_Vertices.clear();
+	m_Vertices.reserve(expectedVertexCount);
+}
+
+uint32_t VertexWelder::Insert(const Vertex& vertex)
+{
+	const uint64_t hash = Hash(vertex);
+	const uint32_t shortHash = static_cast<uint32_t>(hash >> 32);
+
+	for (size_t slotIndex = hash & m_Mask; ; slotIndex = (slotIndex + 1) & m_Mask)
+	{
+		Slot& slot = m_Slots[slotIndex];
+
+		if (slot.index == m_EmptySlot)
+		{
+			slot.hash = shortHash;
+			slot.index = static_cast<uint32_t>(m_Vertices.size());
+			m_Vertices.push_back(vertex);
+
+			const uint32_t index = slot.index;
+
+			if (m_Vertices.size() * 2 > m_Slots.size())
+			{
+				Grow();
+			}
+
+			return index;
+		}
+
+		if (slot.hash == shortHash && memcmp(&m_Vertices[slot.index], &vertex, sizeof(Vertex)) == 0)
+		{
+			return slot.index;
+		}
+	}
+}
+
+void VertexWelder::Weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<Vertex> source;
+	source.swap(vertices);
+
+	// Unindexed primitives draw their vertices in order
+	if (indices.empty())
+	{
+		indices.resize(source.size());
+		for (size_t i{}; i < indices.size(); ++i)
+		{
+			indices[i] = static_cast<uint32_t>(i);
+		}
+	}
+
+	// Remap every source vertex once, then rewrite the indices through the remap table
+	VertexWelder welder{ vertices, source.size() };
+	std::vector<uint32_t> remap(source.size());
+
+	for (size_t i{}; i < source.size(); ++i)
+	{
+		remap[i] = welder.Insert(source[i]);
+	}
+
+	for (uint32_t& index : indices)
+	{
+		index = remap[index];
+	}
+
+	vertices.shrink_to_fit();
+}
+
+uint64_t VertexWelder::Hash(const Vertex& vertex)
+{
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex is hashed in 8 byte words and a 4 byte tail");
+
+	// Multiply-rotate over the raw 8 byte words, finished with the murmur3 64 bit mixer
+	uint64_t words[(sizeof(Vertex) + sizeof(uint32_t)) / sizeof(uint64_t)]{};
+	memcpy(words, &vertex, sizeof(Vertex));
+
+	uint64_t hash = 0x9E3779B97F4A7C15ull;
+	for (uint64_t word : words)
+	{
+		hash ^= word * 0xC2B2AE3D27D4EB4Full;
+		hash = (hash << 31) | (hash >> 33);
+		hash *= 0x9E3779B97F4A7C15ull;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+void VertexWelder::Grow()
+{
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(m_Slots);
+
+	m_Slots.assign(oldSlots.size() * 2, Slot{ 0, m_EmptySlot });
+	m_Mask = m_Slots.size() - 1;
+
+	// Rehash from the stored vertices, the 32 bit slot hash does not hold the low bits used for placement
+	for (const Slot& oldSlot : oldSlots)
+	{
+		if (oldSlot.index == m_EmptySlot)
+		{
+			continue;
+		}
+
+		const uint64_t hash = Hash(m_Vertices[oldSlot.index]);
+		size_t slotIndex = hash & m_Mask;
+
+		while (m_Slots[slotIndex].index != m_EmptySlot)
+		{
+			slotIndex = (slotIndex + 1) & m_Mask;
+		}
+
+		m_Slots[slotIndex] = oldSlot;
+	}
+}
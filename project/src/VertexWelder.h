@@ -0,0 +1,42 @@
+#pragma once
+#include "Structs.h"
+#include <vector>
+#include <cstdint>
+
+// Merges bitwise identical vertices, open addressing with linear probing over a power of two table
+// Each slot keeps the vertex hash next to its index so most probes never touch the vertex data
+class VertexWelder
+{
+public:
+	// Welded vertices are appended to the cleared output vector
+	// expectedVertexCount sizes the table up front, it still grows when it fills up
+	VertexWelder(std::vector<Vertex>& vertices, size_t expectedVertexCount = 0);
+
+	VertexWelder(const VertexWelder&) = delete;
+	VertexWelder(VertexWelder&&) noexcept = delete;
+	VertexWelder& operator=(const VertexWelder&) = delete;
+	VertexWelder& operator=(VertexWelder&&) noexcept = delete;
+
+	// Returns the index of the vertex, appending it to the output when it was not seen before
+	uint32_t Insert(const Vertex& vertex);
+
+	// Welds an unindexed or indexed stream in place, indices are rewritten to point into the welded vertices
+	static void Weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static uint64_t Hash(const Vertex& vertex);
+
+private:
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t index;
+	};
+
+	static const uint32_t m_EmptySlot = UINT32_MAX;
+
+	std::vector<Vertex>& m_Vertices;
+	std::vector<Slot> m_Slots;
+	size_t m_Mask = 0;
+
+	void Grow();
+};
@@ -22,6 +22,13 @@
 #include "Camera.h"
 #include "Timer.h"
 #include "ModelLoader.h"
+#include "ClusterCuller.h"
+#include "TextureRegistry.h"
+#include "BindlessTextureTable.h"
+#include "TextureStreamer.h"
+#include "UploadContext.h"
+#include "MemoryAllocator.h"
+#include "GeometryArena.h"
 
 #include <unordered_map> // unordered_map
 #include <stdexcept> // runtime_error
@@ -47,6 +54,51 @@ const std::string g_MODEL_PATH = "resources/models/Sponza.gltf";
 
 const int g_MAX_FRAMES_IN_FLIGHT = 2;
 
+// Bound to material slots the model has no texture for, normals get a flat one
+const std::string g_DEFAULT_TEXTURE_PATH = "resources/models/white.png";
+const std::string g_DEFAULT_NORMAL_PATH = "resources/textures/flat_normal.png";
+const VkImageUsageFlags g_TEXTURE_USAGE = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+// Blit a full mip chain for every texture at upload
+const bool g_GENERATE_MIPS = true;
+// Upload block compressed KTX2 files cooked next to every image instead of decoding it, falls back to RGBA8 without BC support
+const bool g_COOK_TEXTURES = true;
+// Time the G-buffer pass on the GPU, first sampling every mip level, then clamped to level 0, keep the camera still meanwhile
+const bool g_BENCHMARK_MIPS = false;
+const int g_BENCHMARK_FRAMES = 200;
+
+// Bring the window up first and stream models in on a background thread, textures start out as placeholders
+const bool g_ASYNC_LOADING = true;
+// Decoded textures uploaded per frame while streaming, bounds the hitch of each frame
+const int g_STREAMED_TEXTURES_PER_FRAME = 4;
+// Decoded textures uploaded per submission when loading up front, the loader holds at most this many back anyway
+const int g_TEXTURE_UPLOAD_BATCH = 8;
+// Bind every material texture once per frame as one descriptor indexed array, falls back to per-model sets without descriptor indexing
+const bool g_BINDLESS_TEXTURES = true;
+const uint32_t g_MAX_BINDLESS_TEXTURES = 4096;
+// Keep only the mip levels of cooked textures that their models need on screen, needs cooked and bindless textures
+const bool g_TEXTURE_STREAMING = true;
+// Streamed levels are evicted beyond this, levels no larger than the base size stay resident regardless
+const VkDeviceSize g_TEXTURE_BUDGET_MB = 256;
+const uint32_t g_STREAMING_BASE_SIZE = 64;
+// Print device memory use against the budget of every heap this often, in seconds, 0 only prints it after loading
+const float g_MEMORY_REPORT_INTERVAL = 10.0f;
+// Heaps whose use passes this share of their budget are flagged, and reported right away when one gets there
+const float g_MEMORY_WARNING_SHARE = 0.9f;
+// Decode glTF primitives on worker threads
+const bool g_PARALLEL_LOADING = true;
+// Reorder indices and vertices for the vertex cache, overdraw and fetch locality, prints ACMR/ATVR per primitive
+const bool g_OPTIMIZE_MESHES = true;
+// Skip meshlets outside the frustum or facing away from the camera
+const bool g_CLUSTER_CULLING = true;
+// Build simplified levels of detail at load time and pick one per instance from its projected error
+const bool g_GENERATE_LODS = true;
+const float g_LOD_ERROR_PIXELS = 1.0f;
+// Layout of the vertex buffers, the packed ones quantize positions per mesh and are drawn with the *Packed.vert shaders
+const VertexFormat g_VERTEX_FORMAT = VertexFormat::Packed;
+// Print loader timings (primitive extraction, vertex welding) before loading
+const bool g_BENCHMARK_LOADER = false;
+const int g_BENCHMARK_ITERATIONS = 5;
+
 const std::vector<const char*> g_ValidationLayers = 
 {
     "VK_LAYER_KHRONOS_validation"
@@ -68,10 +120,17 @@ class HelloTriangleApplication
 public:
     void Run()
     {
-        LoadModels();
+        if (!g_ASYNC_LOADING)
+        {
+            LoadModels();
+        }
         InitWindow();
         InitVulkan();
         InitCamera();
+        if (g_ASYNC_LOADING)
+        {
+            StartLoadingModels();
+        }
         MainLoop();
         Cleanup();
     }
@@ -111,16 +170,74 @@ private:
 	std::vector<Model*> m_pOpaqueModels;
 	std::vector<Model*> m_pTransparentModels;
 
+    // Rebuilt every frame from the visible meshlets, shared by all passes
+    ClusterCuller m_ClusterCuller;
+    std::vector<DrawCommand> m_OpaqueDraws;
+    std::vector<DrawCommand> m_TransparentDraws;
+
     Camera* m_pCamera;
     Timer m_Timer;
 
-	Buffer* m_pVertexBuffer;
-	Buffer* m_pIndexBuffer;
+    // Seconds since the last memory report and budget check
+    float m_MemoryReportTime = 0.0f;
+    float m_MemoryCheckTime = 0.0f;
+    bool m_IsNearMemoryBudget = false;
+
+    // Two timestamps per frame in flight around the G-buffer pass, only created when benchmarking
+    VkQueryPool m_TimestampQueryPool = VK_NULL_HANDLE;
+    float m_TimestampPeriod = 1.0f;
+    std::vector<bool> m_IsTimestampWritten;
+
+    // 0 measures with mips, 1 without, 2 is done
+    int m_MipBenchmarkPhase = 0;
+    int m_MipBenchmarkFrames = 0;
+    int m_MipBenchmarkSkippedFrames = 0;
+    double m_MipBenchmarkTotalMs = 0.0;
+    double m_MipBenchmarkWithMipsMs = 0.0;
+
+    // Vertices and indices of every model, models are added as they stream in
+    GeometryArena* m_pGeometryArena = nullptr;
+	Buffer* m_pInstanceBuffer;
+
+    // Filled part of the instance buffer while streaming, new models are appended behind it
+    uint32_t m_StreamedInstanceCount = 0;
+    // Streamed models by the transfer ticket of their geometry, drawn once the graphics queue took it over
+    std::vector<std::pair<uint64_t, std::vector<Model*>>> m_pUploadingModels;
+    // Uploaded models whose CPU streams the loader may still read, freed once it is done with them
+    std::vector<Model*> m_pModelsHoldingGeometry;
+    // Models whose material sets still show placeholders, per frame as every frame's set is rewritten on its own turn
+    std::array<std::vector<Model*>, g_MAX_FRAMES_IN_FLIGHT> m_pPendingMaterialModels;
+    // Buffers that were grown out of, by the frame they were replaced in
+    struct RetiredBuffer
+    {
+        Buffer* pBuffer;
+        uint64_t frame;
+    };
+    std::vector<RetiredBuffer> m_RetiredBuffers;
+    uint64_t m_FrameNumber = 0;
+
+    // Shared material textures, models hold references
+    TextureRegistry* m_pTextureRegistry = nullptr;
+    // Block compressed cooked textures, only when asked for and the device samples BC formats
+    bool m_IsCookingTextures = false;
+    // Every material texture in one array, only when asked for and the device supports descriptor indexing
+    BindlessTextureTable* m_pBindlessTable = nullptr;
+    // Streams mip levels of cooked textures in and out, only with cooked and bindless textures
+    TextureStreamer* m_pTextureStreamer = nullptr;
+    // UBO and G-buffer of every frame, all draws share them when bindless instead of binding per-model sets
+    DescriptorSets* m_pFrameDescriptorSets = nullptr;
+    // Bound in place of material textures that have not arrived yet
+    Texture* m_pPlaceholderTexture = nullptr;
+    Texture* m_pPlaceholderNormal = nullptr;
+
+    ModelLoader* m_pModelLoader = nullptr;
+    std::chrono::high_resolution_clock::time_point m_LoadStartTime;
 
     std::vector<Buffer*> m_UniformBuffers;
     std::vector<void*> m_UniformBuffersMapped;
 
-	DescriptorPool* m_pDescriptorPool;
+    // One pool per batch of streamed models, a single one when everything is loaded up front
+	std::vector<DescriptorPool*> m_pDescriptorPools;
 
     Image* m_pDepthImage;
 
@@ -149,14 +266,35 @@ private:
         CreateGraphicsPipeline();
         CreateDepthImage();
         CreateFrameBuffers();
-        CreateTextureImage();
-        CreateVertexBuffer();
-        CreateIndexBuffer();
+        CreateTextureRegistry();
+        CreatePlaceholderTextures();
+        if (g_ASYNC_LOADING)
+        {
+            CreateStreamingBuffers();
+        }
+        else
+        {
+            CreateTextureImage();
+            CreateGeometryArena();
+            CreateInstanceBuffer();
+            ReleaseModelLoader();
+        }
         CreateUniformBuffers();
-        CreateDescriptorPool();
-        CreateDescriptorSets();
+        if (m_pBindlessTable)
+        {
+            CreateFrameDescriptorSets();
+        }
+        else if (!g_ASYNC_LOADING)
+        {
+            CreateDescriptorPool();
+            CreateDescriptorSets();
+        }
         CreateCommandBuffers();
         CreateSyncObjects();
+        if (g_BENCHMARK_MIPS)
+        {
+            CreateTimestampQueries();
+        }
     }
 
     void CreateInstance()
@@ -200,15 +338,48 @@ private:
     void CreateDescriptorSetLayout()
     {
 		m_pDescriptorSetLayout = new DescriptorSetLayout(m_pDevice);
+
+        if (g_BINDLESS_TEXTURES && m_pDevice->IsDescriptorIndexingEnabled())
+        {
+            m_pBindlessTable = new BindlessTextureTable(m_pDevice, std::min(g_MAX_BINDLESS_TEXTURES, m_pDevice->GetMaxBindlessTextures()));
+            std::cout << "Bindless material textures, " << m_pBindlessTable->GetCapacity() << " slots\n";
+        }
+    }
+
+    // Set 0 is the per-model or per-frame set, set 1 the bindless texture table
+    std::vector<VkDescriptorSetLayout> GetPipelineSetLayouts()
+    {
+        std::vector<VkDescriptorSetLayout> setLayouts{ *m_pDescriptorSetLayout->GetDescriptorSetLayout() };
+
+        if (m_pBindlessTable)
+        {
+            setLayouts.push_back(*m_pBindlessTable->GetDescriptorSetLayout());
+        }
+
+        return setLayouts;
     }
 
     void CreateGraphicsPipeline()
     {
-		m_pCombineGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pCombineRenderPass, m_pDescriptorSetLayout->GetDescriptorSetLayout(), "resources/shaders/combineVert.spv", "resources/shaders/combineFrag.spv");
-		m_pTransparentGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pRenderPass, m_pDescriptorSetLayout->GetDescriptorSetLayout(), "resources/shaders/vert.spv", "resources/shaders/frag.spv", true);
-		m_pDeferredGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pDeferredRenderPass, m_pDescriptorSetLayout->GetDescriptorSetLayout(), "resources/shaders/deferredVert.spv", "resources/shaders/deferredFrag.spv");
-		m_pDepthGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pDepthRenderPass, m_pDescriptorSetLayout->GetDescriptorSetLayout(), "resources/shaders/depth.spv");
-		m_pGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pRenderPass, m_pDescriptorSetLayout->GetDescriptorSetLayout(), "resources/shaders/vert.spv", "resources/shaders/frag.spv");
+        // Every pipeline shares one layout, so sets bound once stay bound across pipeline switches
+        const std::vector<VkDescriptorSetLayout> setLayouts = GetPipelineSetLayouts();
+
+        // Bindless shaders read material textures from the array instead of the model's set
+        const char* pDeferredFragShader = m_pBindlessTable ? "resources/shaders/deferredFragBindless.spv" : "resources/shaders/deferredFrag.spv";
+        const char* pFragShader = m_pBindlessTable ? "resources/shaders/fragBindless.spv" : "resources/shaders/frag.spv";
+
+        // Vertex shaders decode the layout the geometry arena holds
+        const bool isPacked = g_VERTEX_FORMAT != VertexFormat::Full;
+        const char* pVertShader = isPacked ? "resources/shaders/vertPacked.spv" : "resources/shaders/vert.spv";
+        const char* pDeferredVertShader = isPacked ? "resources/shaders/deferredVertPacked.spv" : "resources/shaders/deferredVert.spv";
+        const char* pCombineVertShader = isPacked ? "resources/shaders/combineVertPacked.spv" : "resources/shaders/combineVert.spv";
+        const char* pDepthShader = isPacked ? "resources/shaders/depthPacked.spv" : "resources/shaders/depth.spv";
+
+		m_pCombineGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pCombineRenderPass, setLayouts, pCombineVertShader, "resources/shaders/combineFrag.spv", g_VERTEX_FORMAT);
+		m_pTransparentGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pRenderPass, setLayouts, pVertShader, pFragShader, true, g_VERTEX_FORMAT);
+		m_pDeferredGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pDeferredRenderPass, setLayouts, pDeferredVertShader, pDeferredFragShader, g_VERTEX_FORMAT);
+		m_pDepthGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pDepthRenderPass, setLayouts, pDepthShader, g_VERTEX_FORMAT);
+		m_pGraphicsPipeline = new GraphicsPipeline(m_pDevice, m_pRenderPass, setLayouts, pVertShader, pFragShader, g_VERTEX_FORMAT);
     }
 
     void CreateCommandPool()
@@ -225,7 +396,7 @@ private:
 		VkImageAspectFlagBits aspects = VK_IMAGE_ASPECT_DEPTH_BIT;
 		VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		VkImageLayout newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		m_pDepthImage = new Image(m_pDevice, m_pCommandPool, swapchainExtent, FindDepthFormat(), tiling, usage, properties, aspects, oldLayout, newLayout);
+		m_pDepthImage = new Image(m_pDevice, m_pCommandPool, swapchainExtent, FindDepthFormat(), tiling, usage, properties, aspects, oldLayout, newLayout, MemoryCategory::Depth);
     }
 
     VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -263,198 +434,536 @@ private:
 		m_pSwapchain->CreateDeferredFramebuffers(m_pDeferredRenderPass->GetRenderPass(), *m_pDepthImage->GetImageView());
 	}
 
-    void CreateTextureImage()
+    void CreateTextureRegistry()
     {
-		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL;
-		VkImageUsageFlagBits usage = static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-		VkMemoryPropertyFlagBits properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        
-        // Loop over all meshes and create a texture for each one
-		for (Model* pModel : m_pOpaqueModels)
-		{
-			// Diffuse texture
-			if (pModel->GetDiffuseTexturePath().empty())
-			{
-                // Create a default texture for the model
-                pModel->SetDiffuseTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetDiffuseTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
-			}
-            else
+        m_pTextureRegistry = new TextureRegistry(m_pDevice, m_pCommandPool);
+        m_pTextureRegistry->SetMipGeneration(g_GENERATE_MIPS);
+        m_pTextureRegistry->SetBindlessTable(m_pBindlessTable);
+
+        m_IsCookingTextures = g_COOK_TEXTURES && m_pDevice->IsBcCompressionEnabled();
+
+        // Swapped images need a fresh slot while frames in flight keep reading the old one, per-model sets cannot do that
+        if (g_TEXTURE_STREAMING && m_IsCookingTextures && m_pBindlessTable)
+        {
+            m_pTextureStreamer = new TextureStreamer(m_pDevice, m_pCommandPool, m_pBindlessTable, g_MAX_FRAMES_IN_FLIGHT, g_TEXTURE_BUDGET_MB * 1024 * 1024, g_STREAMING_BASE_SIZE);
+            m_pTextureRegistry->SetStreamer(m_pTextureStreamer);
+        }
+    }
+
+    VkFormat GetTextureFormat(TextureSlot slot) const
+    {
+        // Normals are data, everything else is color
+        return slot == TextureSlot::Normal ? VK_FORMAT_R8G8B8A8_UNORM : m_pSwapchain->GetSwapChainImageFormat();
+    }
+
+    Texture* AcquireTexture(const std::string& texturePath, TextureSlot slot)
+    {
+        if (m_IsCookingTextures)
+        {
+            return m_pTextureRegistry->AcquireCooked(texturePath, slot, g_TEXTURE_USAGE);
+        }
+
+        return m_pTextureRegistry->Acquire(texturePath, GetTextureFormat(slot), g_TEXTURE_USAGE);
+    }
+
+    // Slots without a texture share the default one
+    // Slots with a path stay empty until their image is uploaded and show the placeholder meanwhile
+    void AcquireModelTextures(Model* pModel)
+    {
+        for (TextureSlot slot : { TextureSlot::Diffuse, TextureSlot::Normal, TextureSlot::MetalRough })
+        {
+            const std::string& texturePath = pModel->GetTexturePath(slot);
+
+            if (texturePath.empty())
             {
-                // Create a texture for the model
-                pModel->SetDiffuseTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, pModel->GetDiffuseTexturePath()));
-                pModel->GetDiffuseTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                pModel->SetTexture(slot, AcquireTexture(slot == TextureSlot::Normal ? g_DEFAULT_NORMAL_PATH : g_DEFAULT_TEXTURE_PATH, slot));
             }
+        }
+    }
+
+    void CreateTextureImage()
+    {
+        std::vector<Model*> models = m_pOpaqueModels;
+        models.insert(models.end(), m_pTransparentModels.begin(), m_pTransparentModels.end());
+
+		for (Model* pModel : models)
+		{
+            AcquireModelTextures(pModel);
+        }
+
+        // Every unique image is decoded once on the loader's workers, uploaded here in batches while the rest still decode
+        const auto startTime = std::chrono::high_resolution_clock::now();
+
+        m_pModelLoader->SetTextureCooking(m_IsCookingTextures);
+        m_pModelLoader->LoadTexturesAsync(models);
+
+        while (m_pModelLoader->WaitForLoadedTextures())
+        {
+            UploadLoadedTextures(g_TEXTURE_UPLOAD_BATCH);
+        }
+
+        auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "Loaded textures in " << loadTime << " ms, " << m_pDevice->GetUploadContext()->GetSubmitCount() << " upload submissions so far\n";
+        m_pTextureRegistry->PrintStats();
+        PrintStreamingStats();
+        m_pDevice->GetMemoryAllocator()->PrintStats();
+        m_pDevice->GetMemoryAllocator()->PrintBudgets(g_MEMORY_WARNING_SHARE);
+    }
+
+    void LoadModels()
+    {
+		// Kept alive until the geometry is uploaded, a cache hit maps the baked streams straight from disk
+		m_pModelLoader = new ModelLoader{};
+		m_pModelLoader->SetParallelLoading(g_PARALLEL_LOADING);
+		m_pModelLoader->SetMeshOptimization(g_OPTIMIZE_MESHES);
+		m_pModelLoader->SetLodGeneration(g_GENERATE_LODS);
+
+        const std::string extension = g_MODEL_PATH.substr(g_MODEL_PATH.find_last_of('.') + 1);
+
+        if (g_BENCHMARK_LOADER && (extension == "gltf" || extension == "glb"))
+        {
+            m_pModelLoader->BenchmarkPrimitiveExtraction(g_MODEL_PATH, g_BENCHMARK_ITERATIONS);
+        }
+
+        if (g_BENCHMARK_LOADER)
+        {
+            m_pModelLoader->BenchmarkVertexWelding(g_MODEL_PATH, g_BENCHMARK_ITERATIONS);
+        }
+
+        const std::vector<Model*> models = m_pModelLoader->LoadModel(g_MODEL_PATH);
+        m_pModelLoader->PrintMeshOptimizationReport();
 
-			// Normal texture
-            if (pModel->GetNormalTexturePath().empty())
+        for (Model* pModel : models)
+        {
+            if (!pModel->IsTransparent())
             {
-                // Create a default normal for the model
-                pModel->SetNormalTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), VK_FORMAT_R8G8B8A8_UNORM, tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetNormalTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                m_pOpaqueModels.push_back(pModel);
             }
             else
             {
-                // Create a normal for the model
-                pModel->SetNormalTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), VK_FORMAT_R8G8B8A8_UNORM, tiling, usage, properties, pModel->GetNormalTexturePath()));
-                pModel->GetNormalTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                m_pTransparentModels.push_back(pModel);
             }
+        }
+    }
 
-			// MetalRough texture
-            if (pModel->GetMetalRoughTexturePath().empty())
-            {
-                // Create a default texture for the model
-                pModel->SetMetalRoughTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetMetalRoughTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
-            }
-            else
+    void StartLoadingModels()
+    {
+        m_pModelLoader = new ModelLoader{};
+        m_pModelLoader->SetParallelLoading(g_PARALLEL_LOADING);
+        m_pModelLoader->SetMeshOptimization(g_OPTIMIZE_MESHES);
+        m_pModelLoader->SetLodGeneration(g_GENERATE_LODS);
+        m_pModelLoader->SetTextureCooking(m_IsCookingTextures);
+
+        m_LoadStartTime = std::chrono::high_resolution_clock::now();
+        m_pModelLoader->LoadModelAsync(g_MODEL_PATH);
+    }
+
+    void CreatePlaceholderTextures()
+    {
+        // Same defaults models without a texture use, so the placeholders are the registry's entries for them
+        m_pPlaceholderTexture = AcquireTexture(g_DEFAULT_TEXTURE_PATH, TextureSlot::Diffuse);
+        m_pPlaceholderNormal = AcquireTexture(g_DEFAULT_NORMAL_PATH, TextureSlot::Normal);
+    }
+
+    void CreateStreamingBuffers()
+    {
+        // Adds blocks as models arrive instead of moving what is already uploaded
+        m_pGeometryArena = new GeometryArena(m_pDevice, m_pCommandPool, g_MAX_FRAMES_IN_FLIGHT, g_VERTEX_FORMAT);
+
+        // Start small, the instance buffer grows geometrically as models arrive
+        const VkDeviceSize initialInstanceCount = 1 << 10;
+
+        // Transfer source so a grown buffer can take over the contents of the old one
+        m_pInstanceBuffer = new Buffer(sizeof(InstanceData) * initialInstanceCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pDevice, m_pCommandPool);
+    }
+
+    // Replaces pBuffer with one of at least requiredSize bytes holding the same first usedSize bytes
+    Buffer* ReserveBuffer(Buffer* pBuffer, VkDeviceSize usedSize, VkDeviceSize requiredSize, VkBufferUsageFlags usage)
+    {
+        if (requiredSize <= pBuffer->GetSize())
+        {
+            return pBuffer;
+        }
+
+        Buffer* pGrownBuffer = new Buffer(std::max(requiredSize, pBuffer->GetSize() * 2), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pDevice, m_pCommandPool);
+
+        if (usedSize > 0)
+        {
+            // Ranges still on the transfer queue have to reach the graphics family before the copy reads them
+            // Only waits for the transfer queue, the acquires are recorded ahead of the copy
+            m_pDevice->GetTransferContext()->FinishHandOff();
+            pGrownBuffer->CopyBuffer(pBuffer->GetBuffer(), usedSize);
+        }
+
+        // Frames in flight and the copy still read the old buffer, it goes once none of them can
+        m_RetiredBuffers.push_back({ pBuffer, m_FrameNumber });
+
+        return pGrownBuffer;
+    }
+
+    // Every frame that could have read a retired buffer has waited for its fence framesInFlight frames later
+    // The copy out of it was flushed ahead of the frame it was recorded in
+    void FreeRetiredBuffers(bool isFreeingAll)
+    {
+        auto retiredEnd = std::remove_if(m_RetiredBuffers.begin(), m_RetiredBuffers.end(), [this, isFreeingAll](const RetiredBuffer& retired)
+        {
+            if (!isFreeingAll && retired.frame + g_MAX_FRAMES_IN_FLIGHT > m_FrameNumber)
             {
-                // Create a texture for the model
-                pModel->SetMetalRoughTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, pModel->GetMetalRoughTexturePath()));
-                pModel->GetMetalRoughTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                return false;
             }
+
+            delete retired.pBuffer;
+            return true;
+        });
+
+        m_RetiredBuffers.erase(retiredEnd, m_RetiredBuffers.end());
+    }
+
+    void ProcessLoadedModels()
+    {
+        if (!g_ASYNC_LOADING || !m_pModelLoader)
+        {
+            return;
         }
 
-        // Loop over all meshes and create a texture for each one
-        for (Model* pModel : m_pTransparentModels)
+        std::vector<Model*> models;
+
+        if (m_pModelLoader->TakeLoadedModels(models))
+        {
+            UploadStreamedModels(models);
+        }
+
+        ReleaseModelGeometry();
+
+        AddUploadedModels();
+
+        UploadLoadedTextures(g_STREAMED_TEXTURES_PER_FRAME);
+
+        if (m_pModelLoader->IsAsyncLoadFinished() && m_pUploadingModels.empty())
+        {
+            auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_LoadStartTime).count();
+            std::cout << "Streamed " << m_pOpaqueModels.size() + m_pTransparentModels.size() << " models in " << loadTime << " ms\n";
+            m_pTextureRegistry->PrintStats();
+            PrintStreamingStats();
+            m_pGeometryArena->PrintStats();
+            m_pDevice->GetMemoryAllocator()->PrintStats();
+            m_pDevice->GetMemoryAllocator()->PrintBudgets(g_MEMORY_WARNING_SHARE);
+
+            ReleaseModelLoader();
+        }
+    }
+
+    // Asks for the mip levels every model needs at its distance, swaps in what arrived and starts reading the rest
+    void UpdateTextureStreaming()
+    {
+        if (!m_pTextureStreamer)
         {
-            // Diffuse texture
-            if (pModel->GetDiffuseTexturePath().empty())
+            return;
+        }
+
+        const float projectionScale = m_pCamera->projectionMatrix[1][1] * m_pSwapchain->GetSwapchainExtent().height * 0.5f;
+
+        m_pTextureStreamer->BeginFrame();
+
+        for (const std::vector<Model*>* pModels : { &m_pOpaqueModels, &m_pTransparentModels })
+        {
+            for (Model* pModel : *pModels)
             {
-                // Create a default texture for the model
-                pModel->SetDiffuseTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetDiffuseTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                m_pTextureStreamer->RequestModel(pModel, m_pCamera->origin, projectionScale);
             }
-            else
+        }
+
+        m_pTextureStreamer->EndFrame();
+    }
+
+    // Checks the budgets once a second and reports as soon as a heap nears its budget, prints them all every report interval
+    void ReportMemory(float elapsed)
+    {
+        MemoryAllocator* pAllocator = m_pDevice->GetMemoryAllocator();
+
+        m_MemoryCheckTime += elapsed;
+        m_MemoryReportTime += elapsed;
+
+        if (m_MemoryCheckTime >= 1.0f)
+        {
+            m_MemoryCheckTime = 0.0f;
+
+            const bool isNearBudget = pAllocator->IsNearBudget(g_MEMORY_WARNING_SHARE);
+
+            if (isNearBudget && !m_IsNearMemoryBudget)
             {
-                // Create a texture for the model
-                pModel->SetDiffuseTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, pModel->GetDiffuseTexturePath()));
-                pModel->GetDiffuseTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                std::cout << "Device memory is close to oversubscribed\n";
+                pAllocator->PrintBudgets(g_MEMORY_WARNING_SHARE);
             }
 
-            // Normal texture
-            if (pModel->GetNormalTexturePath().empty())
+            m_IsNearMemoryBudget = isNearBudget;
+        }
+
+        if (g_MEMORY_REPORT_INTERVAL > 0.0f && m_MemoryReportTime >= g_MEMORY_REPORT_INTERVAL)
+        {
+            m_MemoryReportTime = 0.0f;
+            pAllocator->PrintBudgets(g_MEMORY_WARNING_SHARE);
+        }
+    }
+
+    void PrintStreamingStats() const
+    {
+        if (m_pTextureStreamer)
+        {
+            m_pTextureStreamer->PrintStats();
+        }
+    }
+
+    void UploadStreamedModels(const std::vector<Model*>& models)
+    {
+        // The whole batch goes into one contiguous range of the instance buffer
+        uint32_t instanceCount = 0;
+
+        for (Model* pModel : models)
+        {
+            pModel->SetFirstInstance(m_StreamedInstanceCount + instanceCount);
+            instanceCount += pModel->GetInstanceCount();
+        }
+
+        const VkBufferUsageFlags transferFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        m_pInstanceBuffer = ReserveBuffer(m_pInstanceBuffer, sizeof(InstanceData) * m_StreamedInstanceCount, sizeof(InstanceData) * (m_StreamedInstanceCount + instanceCount), transferFlags | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+        // Copied beside the frames on the transfer queue, the models are only drawn once it handed the ranges over
+        UploadContext* pTransferContext = m_pDevice->GetTransferContext();
+        AddToGeometryArena(models, pTransferContext);
+
+        // After adding, the transforms include the dequantization packing picked
+        std::vector<InstanceData> instances;
+        instances.reserve(instanceCount);
+
+        for (Model* pModel : models)
+        {
+            for (uint32_t i{}; i < pModel->GetInstanceCount(); ++i)
             {
-                // Create a default normal for the model
-                pModel->SetNormalTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), VK_FORMAT_R8G8B8A8_UNORM, tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetNormalTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                instances.push_back({ pModel->GetInstanceTransform(i) });
             }
-            else
+        }
+
+        m_pInstanceBuffer->Upload(instances.data(), sizeof(InstanceData) * instances.size(), sizeof(InstanceData) * m_StreamedInstanceCount, pTransferContext);
+
+        m_StreamedInstanceCount += static_cast<uint32_t>(instances.size());
+
+        if (!m_pBindlessTable)
+        {
+            m_pDescriptorPools.push_back(new DescriptorPool(g_MAX_FRAMES_IN_FLIGHT, static_cast<int>(models.size()), m_pDevice));
+        }
+
+        for (Model* pModel : models)
+        {
+            AcquireModelTextures(pModel);
+
+            if (!m_pBindlessTable)
             {
-                // Create a normal for the model
-                pModel->SetNormalTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), VK_FORMAT_R8G8B8A8_UNORM, tiling, usage, properties, pModel->GetNormalTexturePath()));
-                pModel->GetNormalTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                pModel->SetDescriptorSets(new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPools.back()->GetDescriptorPool(), m_UniformBuffers, GetMaterialTexture(pModel, TextureSlot::Diffuse), GetMaterialTexture(pModel, TextureSlot::Normal), GetMaterialTexture(pModel, TextureSlot::MetalRough), m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]));
             }
+        }
+
+        m_pUploadingModels.emplace_back(pTransferContext->GetTicket(), models);
+    }
 
-            // MetalRough texture
-            if (pModel->GetMetalRoughTexturePath().empty())
+    // Draws the streamed models whose geometry the graphics queue took over, without a transfer queue right after their upload
+    void AddUploadedModels()
+    {
+        UploadContext* pTransferContext = m_pDevice->GetTransferContext();
+
+        auto uploadedEnd = std::remove_if(m_pUploadingModels.begin(), m_pUploadingModels.end(), [this, pTransferContext](const std::pair<uint64_t, std::vector<Model*>>& uploading)
+        {
+            if (!pTransferContext->IsHandedOff(uploading.first))
             {
-                // Create a default texture for the model
-                pModel->SetMetalRoughTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, "resources/models/white.png"));
-                pModel->GetMetalRoughTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                return false;
             }
-            else
+
+            for (Model* pModel : uploading.second)
             {
-                // Create a texture for the model
-                pModel->SetMetalRoughTexture(new Texture(m_pDevice, m_pCommandPool, m_pSwapchain->GetSwapchainExtent(), m_pSwapchain->GetSwapChainImageFormat(), tiling, usage, properties, pModel->GetMetalRoughTexturePath()));
-                pModel->GetMetalRoughTexture()->CreateSampler(m_pPhysicalDevice->GetVkPhysicalDevice());
+                if (!pModel->IsTransparent())
+                {
+                    m_pOpaqueModels.push_back(pModel);
+                }
+                else
+                {
+                    m_pTransparentModels.push_back(pModel);
+                }
             }
+
+            return true;
+        });
+
+        m_pUploadingModels.erase(uploadedEnd, m_pUploadingModels.end());
+    }
+
+    Texture* GetMaterialTexture(Model* pModel, TextureSlot slot) const
+    {
+        if (Texture* pTexture = pModel->GetTexture(slot))
+        {
+            return pTexture;
         }
+
+        return slot == TextureSlot::Normal ? m_pPlaceholderNormal : m_pPlaceholderTexture;
     }
 
-    void LoadModels()
+    MaterialIndices GetMaterialIndices(Model* pModel) const
+    {
+        return { GetMaterialTexture(pModel, TextureSlot::Diffuse)->GetBindlessIndex(), GetMaterialTexture(pModel, TextureSlot::Normal)->GetBindlessIndex(), GetMaterialTexture(pModel, TextureSlot::MetalRough)->GetBindlessIndex(), 0 };
+    }
+
+    // Takes up to maxCount decoded textures and uploads them with one staging buffer and one submission
+    void UploadLoadedTextures(int maxCount)
     {
-		ModelLoader modelLoader{};
+        std::vector<LoadedTexture> textures;
+        LoadedTexture texture{};
 
-        for (Model* pModel : modelLoader.LoadModel(g_MODEL_PATH))
+        while (static_cast<int>(textures.size()) < maxCount && m_pModelLoader->TakeLoadedTexture(texture))
         {
-            if (!pModel->IsTransparent())
+            textures.push_back(texture);
+        }
+
+        if (textures.empty())
+        {
+            return;
+        }
+
+        // Slots with a path are still empty, so nothing is released before the batch is submitted
+        m_pTextureRegistry->BeginBatch();
+
+        for (const LoadedTexture& loaded : textures)
+        {
+            for (const TextureUser& user : loaded.users)
             {
-                m_pOpaqueModels.push_back(pModel);
+                Texture* pTexture = loaded.pCooked
+                    ? m_pTextureRegistry->AcquireCooked(loaded.path, user.slot, g_TEXTURE_USAGE, *loaded.pCooked)
+                    : m_pTextureRegistry->Acquire(loaded.path, GetTextureFormat(user.slot), g_TEXTURE_USAGE, loaded.pPixels, loaded.width, loaded.height);
+
+                m_pTextureRegistry->Release(user.pModel->GetTexture(user.slot));
+                user.pModel->SetTexture(user.slot, pTexture);
             }
-            else
+        }
+
+        m_pTextureRegistry->EndBatch();
+
+        for (LoadedTexture& loaded : textures)
+        {
+            // Models loaded up front get their sets once every texture is in
+            // Frames still in flight may read the sets, each is rewritten once its own frame comes around again
+            for (const TextureUser& user : loaded.users)
             {
-                m_pTransparentModels.push_back(pModel);
+                if (user.pModel->GetDescriptorSets())
+                {
+                    for (std::vector<Model*>& pendingModels : m_pPendingMaterialModels)
+                    {
+                        pendingModels.push_back(user.pModel);
+                    }
+                }
             }
+
+            loaded.Release();
         }
     }
 
-    void CreateVertexBuffer()
+    // The current frame's fence was waited on, so its sets are no longer read by the GPU
+    void UpdatePendingMaterials()
     {
-        VkBufferUsageFlags bufferFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        VkMemoryPropertyFlags propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        for (Model* pModel : m_pPendingMaterialModels[m_CurrentFrame])
+        {
+            pModel->GetDescriptorSets()->UpdateMaterial(m_CurrentFrame, GetMaterialTexture(pModel, TextureSlot::Diffuse), GetMaterialTexture(pModel, TextureSlot::Normal), GetMaterialTexture(pModel, TextureSlot::MetalRough));
+        }
 
-		// Add the size of the vertices of each model to the total buffer size
-		std::vector<Vertex> vertices;
-		VkDeviceSize bufferSize = 0;
+        m_pPendingMaterialModels[m_CurrentFrame].clear();
+    }
 
-        uint32_t vertexOffset = 0;
-        uint32_t indexOffset = 0;
+    void CreateGeometryArena()
+    {
+        m_pGeometryArena = new GeometryArena(m_pDevice, m_pCommandPool, g_MAX_FRAMES_IN_FLIGHT, g_VERTEX_FORMAT);
 
-		for (Model* pModel : m_pOpaqueModels)
-		{
-            pModel->SetVertexOffset(vertexOffset);
-            pModel->SetFirstIndex(indexOffset);
-
-            vertexOffset += static_cast<uint32_t>(pModel->GetVertices().size());
-            indexOffset += static_cast<uint32_t>(pModel->GetIndices().size());
-
-			bufferSize += sizeof(pModel->GetVertices()[0]) * pModel->GetVertices().size();
-			
-			for (const Vertex& vertex : pModel->GetVertices())
-			{
-				vertices.push_back(vertex);
-			}
-		}
+        std::vector<Model*> models = m_pOpaqueModels;
+        models.insert(models.end(), m_pTransparentModels.begin(), m_pTransparentModels.end());
 
-        for (Model* pModel : m_pTransparentModels)
-        {
-            pModel->SetVertexOffset(vertexOffset);
-            pModel->SetFirstIndex(indexOffset);
+        AddToGeometryArena(models, m_pDevice->GetUploadContext());
+        ReleaseModelGeometry();
+
+        m_pGeometryArena->PrintStats();
+    }
 
-            vertexOffset += static_cast<uint32_t>(pModel->GetVertices().size());
-            indexOffset += static_cast<uint32_t>(pModel->GetIndices().size());
+    void AddToGeometryArena(const std::vector<Model*>& models, UploadContext* pUploadContext)
+    {
+        MeshCache* pMeshCache = m_pModelLoader->GetMeshCache();
 
-            bufferSize += sizeof(pModel->GetVertices()[0]) * pModel->GetVertices().size();
+        // Baked streams are packed straight from the mapping into staging, at the offsets the cache gave the models
+        if (pMeshCache->IsLoaded())
+        {
+            m_pGeometryArena->Add(models, pUploadContext, pMeshCache->GetVertices(), pMeshCache->GetIndices());
+        }
+        else
+        {
+            m_pGeometryArena->Add(models, pUploadContext);
+            m_pModelsHoldingGeometry.insert(m_pModelsHoldingGeometry.end(), models.begin(), models.end());
+        }
+    }
 
-            for (const Vertex& vertex : pModel->GetVertices())
-            {
-                vertices.push_back(vertex);
-            }
+    // Drawing only needs the counts and offsets, the CPU streams go as soon as the loader stopped reading them
+    void ReleaseModelGeometry()
+    {
+        if (m_pModelsHoldingGeometry.empty() || (m_pModelLoader && !m_pModelLoader->IsGeometryDone()))
+        {
+            return;
         }
 
-        m_pVertexBuffer = new Buffer(bufferSize, bufferFlags, propertyFlags, vertices.data(), m_pDevice, m_pCommandPool);
+        for (Model* pModel : m_pModelsHoldingGeometry)
+        {
+            pModel->ReleaseGeometry();
+        }
+
+        m_pModelsHoldingGeometry.clear();
     }
 
-    void CreateIndexBuffer()
+    void CreateInstanceBuffer()
     {
-        VkBufferUsageFlags bufferFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        VkBufferUsageFlags bufferFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
         VkMemoryPropertyFlags propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-        // Add the size of the vertices of each model to the total buffer size
-        VkDeviceSize bufferSize = 0;
-        std::vector<uint32_t> indices;
+        // Ranges were assigned by the loader, every model draws its instances from firstInstance on
+        uint32_t instanceCount = 0;
         for (Model* pModel : m_pOpaqueModels)
         {
-            bufferSize += sizeof(pModel->GetIndices()[0]) * pModel->GetIndices().size();
+            instanceCount = std::max(instanceCount, pModel->GetFirstInstance() + pModel->GetInstanceCount());
+        }
+        for (Model* pModel : m_pTransparentModels)
+        {
+            instanceCount = std::max(instanceCount, pModel->GetFirstInstance() + pModel->GetInstanceCount());
+        }
 
-            for (const uint32_t index : pModel->GetIndices())
+        std::vector<InstanceData> instances(instanceCount);
+
+        for (Model* pModel : m_pOpaqueModels)
+        {
+            for (uint32_t i{}; i < pModel->GetInstanceCount(); ++i)
             {
-                indices.push_back(index);
+                instances[pModel->GetFirstInstance() + i].model = pModel->GetInstanceTransform(i);
             }
         }
 
         for (Model* pModel : m_pTransparentModels)
         {
-            bufferSize += sizeof(pModel->GetIndices()[0]) * pModel->GetIndices().size();
-
-            for (const uint32_t index : pModel->GetIndices())
+            for (uint32_t i{}; i < pModel->GetInstanceCount(); ++i)
             {
-                indices.push_back(index);
+                instances[pModel->GetFirstInstance() + i].model = pModel->GetInstanceTransform(i);
             }
         }
 
-		m_pIndexBuffer = new Buffer(bufferSize, bufferFlags, propertyFlags, indices.data(), m_pDevice, m_pCommandPool);
+        VkDeviceSize bufferSize = sizeof(InstanceData) * instances.size();
+        m_pInstanceBuffer = new Buffer(bufferSize, bufferFlags, propertyFlags, instances.data(), m_pDevice, m_pCommandPool);
+    }
+
+    void ReleaseModelLoader()
+    {
+        // Unmaps the mesh cache
+        delete m_pModelLoader;
+        m_pModelLoader = nullptr;
     }
 
     void CreateUniformBuffers()
@@ -472,7 +981,14 @@ private:
 
     void CreateDescriptorPool()
     {
-		m_pDescriptorPool = new DescriptorPool(g_MAX_FRAMES_IN_FLIGHT, m_pOpaqueModels.size() + m_pTransparentModels.size(), m_pDevice);
+		m_pDescriptorPools.push_back(new DescriptorPool(g_MAX_FRAMES_IN_FLIGHT, m_pOpaqueModels.size() + m_pTransparentModels.size(), m_pDevice));
+    }
+
+    void CreateFrameDescriptorSets()
+    {
+        // The bindless shaders never read the material bindings of set 0, the placeholders only keep them valid
+        m_pDescriptorPools.push_back(new DescriptorPool(g_MAX_FRAMES_IN_FLIGHT, 1, m_pDevice));
+        m_pFrameDescriptorSets = new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPools.back()->GetDescriptorPool(), m_UniformBuffers, m_pPlaceholderTexture, m_pPlaceholderNormal, m_pPlaceholderTexture, m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]);
     }
 
     void CreateDescriptorSets()
@@ -480,12 +996,12 @@ private:
 		// Create descriptor sets for each model
 		for (Model* pModel : m_pOpaqueModels)
 		{
-            pModel->SetDescriptorSets(new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPool->GetDescriptorPool(), m_UniformBuffers, pModel, m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]));
+            pModel->SetDescriptorSets(new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPools.back()->GetDescriptorPool(), m_UniformBuffers, pModel, m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]));
 		}
 
         for (Model* pModel : m_pTransparentModels)
         {
-            pModel->SetDescriptorSets(new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPool->GetDescriptorPool(), m_UniformBuffers, pModel, m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]));
+            pModel->SetDescriptorSets(new DescriptorSets(g_MAX_FRAMES_IN_FLIGHT, m_pDevice, m_pDescriptorSetLayout->GetDescriptorSetLayout(), m_pDescriptorPools.back()->GetDescriptorPool(), m_UniformBuffers, pModel, m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]));
         }
     }
 
@@ -518,6 +1034,114 @@ private:
         }
     }
 
+    void CreateTimestampQueries()
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_pPhysicalDevice->GetVkPhysicalDevice(), &properties);
+
+        if (!properties.limits.timestampComputeAndGraphics)
+        {
+            std::cout << "GPU timestamps are not supported, skipping the mip benchmark\n";
+            return;
+        }
+
+        m_TimestampPeriod = properties.limits.timestampPeriod;
+        m_IsTimestampWritten.assign(g_MAX_FRAMES_IN_FLIGHT, false);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2 * g_MAX_FRAMES_IN_FLIGHT;
+
+        if (vkCreateQueryPool(m_pDevice->GetVkDevice(), &queryPoolInfo, nullptr, &m_TimestampQueryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    // Call after waiting for the frame's fence, its timestamps are then available
+    void ReadGpuTimings()
+    {
+        if (m_TimestampQueryPool == VK_NULL_HANDLE || !m_IsTimestampWritten[m_CurrentFrame])
+        {
+            return;
+        }
+
+        uint64_t timestamps[2]{};
+        if (vkGetQueryPoolResults(m_pDevice->GetVkDevice(), m_TimestampQueryPool, 2 * m_CurrentFrame, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        {
+            return;
+        }
+
+        UpdateMipBenchmark((timestamps[1] - timestamps[0]) * m_TimestampPeriod / 1e6);
+    }
+
+    void UpdateMipBenchmark(double gBufferMs)
+    {
+        // Streaming changes the scene under the measurement, wait until everything is in
+        if (m_MipBenchmarkPhase >= 2 || m_pModelLoader)
+        {
+            return;
+        }
+
+        // Frames recorded before the last switch are still being read back
+        if (m_MipBenchmarkSkippedFrames < g_MAX_FRAMES_IN_FLIGHT)
+        {
+            ++m_MipBenchmarkSkippedFrames;
+            return;
+        }
+
+        m_MipBenchmarkTotalMs += gBufferMs;
+
+        if (++m_MipBenchmarkFrames < g_BENCHMARK_FRAMES)
+        {
+            return;
+        }
+
+        const double averageMs = m_MipBenchmarkTotalMs / m_MipBenchmarkFrames;
+
+        if (m_MipBenchmarkPhase == 0)
+        {
+            m_MipBenchmarkWithMipsMs = averageMs;
+            SetMipSampling(false);
+        }
+        else
+        {
+            std::cout << "G-buffer pass over " << g_BENCHMARK_FRAMES << " frames\n";
+            std::cout << "\twith mips:    " << m_MipBenchmarkWithMipsMs << " ms\n";
+            std::cout << "\tlevel 0 only: " << averageMs << " ms (" << averageMs / m_MipBenchmarkWithMipsMs << "x)\n";
+            SetMipSampling(true);
+        }
+
+        ++m_MipBenchmarkPhase;
+        m_MipBenchmarkFrames = 0;
+        m_MipBenchmarkSkippedFrames = 0;
+        m_MipBenchmarkTotalMs = 0.0;
+    }
+
+    // Same textures either way, only the samplers' LOD range changes
+    void SetMipSampling(bool isUsingMips)
+    {
+        vkDeviceWaitIdle(m_pDevice->GetVkDevice());
+
+        m_pTextureRegistry->SetMipSampling(isUsingMips);
+
+        // Samplers are baked into the descriptors, the registry already rewrote the bindless table
+        if (m_pBindlessTable)
+        {
+            return;
+        }
+
+        for (Model* pModel : m_pOpaqueModels)
+        {
+            pModel->GetDescriptorSets()->UpdateMaterial(GetMaterialTexture(pModel, TextureSlot::Diffuse), GetMaterialTexture(pModel, TextureSlot::Normal), GetMaterialTexture(pModel, TextureSlot::MetalRough));
+        }
+        for (Model* pModel : m_pTransparentModels)
+        {
+            pModel->GetDescriptorSets()->UpdateMaterial(GetMaterialTexture(pModel, TextureSlot::Diffuse), GetMaterialTexture(pModel, TextureSlot::Normal), GetMaterialTexture(pModel, TextureSlot::MetalRough));
+        }
+    }
+
     void RecreateSwapChain()
     {
         int width = 0;
@@ -539,6 +1163,12 @@ private:
 		CreateFrameBuffers();
 
 		// Update descriptor sets with new image views
+		if (m_pFrameDescriptorSets)
+		{
+			m_pFrameDescriptorSets->UpdateDescriptorSets(m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]);
+			return;
+		}
+
 		for (Model* pModel : m_pOpaqueModels)
 		{
 			pModel->GetDescriptorSets()->UpdateDescriptorSets(m_pSwapchain->GetGBufferAlbedoImages()[0], m_pSwapchain->GetGBufferNormalImages()[0], m_pSwapchain->GetGBufferMetalRoughImages()[0]);
@@ -549,6 +1179,15 @@ private:
 		}
     }
 
+    void ReleaseModelTextures(Model* pModel)
+    {
+        for (TextureSlot slot : { TextureSlot::Diffuse, TextureSlot::Normal, TextureSlot::MetalRough })
+        {
+            m_pTextureRegistry->Release(pModel->GetTexture(slot));
+            pModel->SetTexture(slot, nullptr);
+        }
+    }
+
     void CleanupSwapChain()
     {
 		m_pSwapchain->CleanupSwapChain(m_pDepthImage);
@@ -563,6 +1202,7 @@ private:
             DrawFrame();
             m_Timer.Update();
 			m_pCamera->Update(m_Timer.GetElapsed());
+            ReportMemory(m_Timer.GetElapsed());
         }
 		m_Timer.Stop();
 
@@ -581,6 +1221,18 @@ private:
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        if (m_TimestampQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(commandBuffer, m_TimestampQueryPool, 2 * m_CurrentFrame, 2);
+        }
+
+        if (m_pBindlessTable)
+        {
+            // Frame set and texture array stay bound through every pass, draws only push their material indices
+            std::array<VkDescriptorSet, 2> descriptorSets = { m_pFrameDescriptorSets->GetDescriptorSets()[m_CurrentFrame], m_pBindlessTable->GetDescriptorSet() };
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pDeferredGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+        }
+
         auto swapChainExtent = m_pSwapchain->GetSwapchainExtent();
 
         VkRenderPassBeginInfo depthPrePassInfo{};
@@ -615,24 +1267,12 @@ private:
             scissor.extent = swapChainExtent;
             vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-            VkBuffer vertexBuffers[] = { m_pVertexBuffer->GetBuffer() };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-
-            vkCmdBindIndexBuffer(commandBuffer, m_pIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-            for (Model* pModel : m_pOpaqueModels)
-            {
-                uint32_t indexCount = static_cast<uint32_t>(pModel->GetIndices().size());
-                uint32_t firstIndex = pModel->GetFirstIndex();
-                int32_t vertexOffset = static_cast<int32_t>(pModel->GetVertexOffset());
+            // Bindings 0 and 2 hold the vertex streams of the arena block a draw reads from and are bound with its indices, binding 1 the per-instance transforms
+            VkBuffer instanceBuffer = m_pInstanceBuffer->GetBuffer();
+            VkDeviceSize instanceOffset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
 
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    m_pDepthGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), 0, 1,
-                    &pModel->GetDescriptorSets()->GetDescriptorSets()[m_CurrentFrame], 0, nullptr);
-
-                vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, vertexOffset, 0);
-            }
+            RecordDraws(commandBuffer, m_pDepthGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), m_OpaqueDraws, true);
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -650,35 +1290,27 @@ private:
         deferredRenderPassInfo.clearValueCount = static_cast<uint32_t>(deferredClearValues.size());
         deferredRenderPassInfo.pClearValues = deferredClearValues.data();
 
+        if (m_TimestampQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_TimestampQueryPool, 2 * m_CurrentFrame);
+        }
+
         vkCmdBeginRenderPass(commandBuffer, &deferredRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
             vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *m_pDeferredGraphicsPipeline->GetGraphicsPipeline());
 
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
 
-            vkCmdBindIndexBuffer(commandBuffer, m_pIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-            // Draw all models
-            for (Model* pModel : m_pOpaqueModels)
-            {
-                uint32_t indexCount = static_cast<uint32_t>(pModel->GetIndices().size());
-                uint32_t firstIndex = pModel->GetFirstIndex();
-                int32_t vertexOffset = static_cast<int32_t>(pModel->GetVertexOffset());
-
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pDeferredGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), 0, 1, &pModel->GetDescriptorSets()->GetDescriptorSets()[m_CurrentFrame], 0, nullptr);
-
-                vkCmdDrawIndexed(
-                    commandBuffer,
-                    indexCount,
-                    1,
-                    firstIndex,
-                    vertexOffset,
-                    0
-                );
-            }
+            RecordDraws(commandBuffer, m_pDeferredGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), m_OpaqueDraws);
 
         vkCmdEndRenderPass(commandBuffer);
 
+        if (m_TimestampQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampQueryPool, 2 * m_CurrentFrame + 1);
+            m_IsTimestampWritten[m_CurrentFrame] = true;
+        }
+
 		// Transition images from color attachment to shader read only
         auto& albedoImage = m_pSwapchain->GetGBufferAlbedoImages();
         auto& normalImage = m_pSwapchain->GetGBufferNormalImages();
@@ -712,9 +1344,7 @@ private:
 
             vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *m_pCombineGraphicsPipeline->GetGraphicsPipeline());
 
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-
-            vkCmdBindIndexBuffer(commandBuffer, m_pIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
 
             PushConstants pc = { glm::vec4(swapChainExtent.width, swapChainExtent.height, 0, 0), glm::vec4(m_pCamera->forward, 0) };
 
@@ -727,24 +1357,7 @@ private:
                 &pc
             );
 
-            // Draw all models
-            for (Model* pModel : m_pOpaqueModels)
-            {
-                uint32_t indexCount = static_cast<uint32_t>(pModel->GetIndices().size());
-                uint32_t firstIndex = pModel->GetFirstIndex();
-                int32_t vertexOffset = static_cast<int32_t>(pModel->GetVertexOffset());
-
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pCombineGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), 0, 1, &pModel->GetDescriptorSets()->GetDescriptorSets()[m_CurrentFrame], 0, nullptr);
-
-                vkCmdDrawIndexed(
-                    commandBuffer,
-                    indexCount,
-                    1,
-                    firstIndex,
-                    vertexOffset,
-                    0
-                );
-            }
+            RecordDraws(commandBuffer, m_pCombineGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), m_OpaqueDraws);
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -764,32 +1377,13 @@ private:
 
         vkCmdBeginRenderPass(commandBuffer, &transparentRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-
-            vkCmdBindIndexBuffer(commandBuffer, m_pIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
 
             vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *m_pTransparentGraphicsPipeline->GetGraphicsPipeline());
 
             // TODO: Sort transparent models by distance from camera before drawing
 
-            // Draw all models
-            for (Model* pModel : m_pTransparentModels)
-            {
-                uint32_t indexCount = static_cast<uint32_t>(pModel->GetIndices().size());
-                uint32_t firstIndex = pModel->GetFirstIndex();
-                int32_t vertexOffset = static_cast<int32_t>(pModel->GetVertexOffset());
-
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pTransparentGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), 0, 1, &pModel->GetDescriptorSets()->GetDescriptorSets()[m_CurrentFrame], 0, nullptr);
-
-                vkCmdDrawIndexed(
-                    commandBuffer,
-                    indexCount,
-                    1,
-                    firstIndex,
-                    vertexOffset,
-                    0
-                );
-            }
+            RecordDraws(commandBuffer, m_pTransparentGraphicsPipeline->GetPipelineLayout()->GetPipelineLayout(), m_TransparentDraws);
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -809,10 +1403,92 @@ private:
         }
     }
 
+    void BuildDrawLists()
+    {
+        m_OpaqueDraws.clear();
+        m_TransparentDraws.clear();
+        m_ClusterCuller.ResetStats();
+
+        const float projectionScale = m_pCamera->projectionMatrix[1][1] * m_pSwapchain->GetSwapchainExtent().height * 0.5f;
+
+        m_ClusterCuller.SetLodErrorThreshold(g_LOD_ERROR_PIXELS);
+        m_ClusterCuller.Update(m_pCamera->projectionMatrix * m_pCamera->viewMatrix, m_pCamera->origin, projectionScale);
+
+        for (Model* pModel : m_pOpaqueModels)
+        {
+            if (g_CLUSTER_CULLING)
+            {
+                m_ClusterCuller.AppendDraws(pModel, m_OpaqueDraws);
+            }
+            else
+            {
+                m_ClusterCuller.AppendFullDraw(pModel, m_OpaqueDraws);
+            }
+        }
+
+        for (Model* pModel : m_pTransparentModels)
+        {
+            if (g_CLUSTER_CULLING)
+            {
+                m_ClusterCuller.AppendDraws(pModel, m_TransparentDraws);
+            }
+            else
+            {
+                m_ClusterCuller.AppendFullDraw(pModel, m_TransparentDraws);
+            }
+        }
+    }
+
+    // Depth-only passes bind the position stream alone
+    void RecordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const std::vector<DrawCommand>& draws, bool positionsOnly = false)
+    {
+        Model* pBoundModel = nullptr;
+        uint32_t boundBlock = GeometryArena::m_InvalidBlock;
+
+        for (const DrawCommand& draw : draws)
+        {
+            // Models in the same arena block share its buffers
+            if (draw.pModel->GetGeometryBlock() != boundBlock)
+            {
+                boundBlock = draw.pModel->GetGeometryBlock();
+                m_pGeometryArena->Bind(commandBuffer, boundBlock, positionsOnly);
+            }
+
+            // Draws of one model are adjacent, only rebind when the model changes
+            if (draw.pModel != pBoundModel)
+            {
+                if (m_pBindlessTable)
+                {
+                    const MaterialIndices material = GetMaterialIndices(draw.pModel);
+                    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(PushConstants), sizeof(MaterialIndices), &material);
+                }
+                else
+                {
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &draw.pModel->GetDescriptorSets()->GetDescriptorSets()[m_CurrentFrame], 0, nullptr);
+                }
+
+                pBoundModel = draw.pModel;
+            }
+
+            vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, static_cast<int32_t>(draw.pModel->GetVertexOffset()), draw.firstInstance);
+        }
+    }
+
     void DrawFrame()
     {
         vkWaitForFences(m_pDevice->GetVkDevice(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
 
+        ReadGpuTimings();
+        ++m_FrameNumber;
+        FreeRetiredBuffers(false);
+        m_pGeometryArena->BeginFrame();
+        ProcessLoadedModels();
+        UpdatePendingMaterials();
+        UpdateTextureStreaming();
+
+        // Streamed copies start right away and run beside this frame
+        m_pDevice->GetTransferContext()->Flush();
+
         uint32_t imageIndex;
         VkResult result = vkAcquireNextImageKHR(m_pDevice->GetVkDevice(), m_pSwapchain->GetSwapchain(), UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -827,6 +1503,7 @@ private:
         }
 
         UpdateUniformBuffer(m_CurrentFrame);
+        BuildDrawLists();
 
         vkResetFences(m_pDevice->GetVkDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
 
@@ -849,6 +1526,11 @@ private:
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
+        // Uploads recorded since the last frame go first, the frame sees them in submission order
+        // Along with the acquires of the streamed copies that completed, later frames start drawing what they carried
+        m_pDevice->GetTransferContext()->HandOff();
+        m_pDevice->GetUploadContext()->Flush();
+
         if (vkQueueSubmit(m_pDevice->GetGraphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to submit draw command buffer!");
@@ -903,14 +1585,32 @@ private:
 
     void Cleanup()
     {
+        // Nothing recorded may reference what is destroyed below, the transfer context hands its last copies over first
+        m_pDevice->GetTransferContext()->WaitIdle();
+        m_pDevice->GetUploadContext()->WaitIdle();
+
+        // Stops a load that is still running, the models it did not hand out yet go with it
+        ReleaseModelLoader();
+
+        for (const std::pair<uint64_t, std::vector<Model*>>& uploading : m_pUploadingModels)
+        {
+            for (Model* pModel : uploading.second)
+            {
+                ReleaseModelTextures(pModel);
+                delete pModel;
+            }
+        }
+
 		for (Model* pModel : m_pOpaqueModels)
 		{
+            ReleaseModelTextures(pModel);
 			delete pModel;
             pModel = nullptr;
 		}
 
 		for (Model* pModel : m_pTransparentModels)
 		{
+            ReleaseModelTextures(pModel);
 			delete pModel;
             pModel = nullptr;
 		}
@@ -923,12 +1623,23 @@ private:
 			delete m_UniformBuffers[i];
         }
 
-        delete m_pDescriptorPool;
+        for (DescriptorPool* pDescriptorPool : m_pDescriptorPools)
+        {
+            delete pDescriptorPool;
+        }
+
+        m_pTextureRegistry->Release(m_pPlaceholderNormal);
+        m_pTextureRegistry->Release(m_pPlaceholderTexture);
+        delete m_pTextureRegistry;
+        delete m_pTextureStreamer;
 
         delete m_pDescriptorSetLayout;
+        delete m_pFrameDescriptorSets;
+        delete m_pBindlessTable;
 
-        delete m_pIndexBuffer;
-		delete m_pVertexBuffer;
+        FreeRetiredBuffers(true);
+        delete m_pInstanceBuffer;
+        delete m_pGeometryArena;
 
 		delete m_pCombineGraphicsPipeline;
         delete m_pTransparentGraphicsPipeline;
@@ -948,6 +1659,11 @@ private:
             vkDestroyFence(m_pDevice->GetVkDevice(), m_InFlightFences[i], nullptr);
         }
 
+        if (m_TimestampQueryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(m_pDevice->GetVkDevice(), m_TimestampQueryPool, nullptr);
+        }
+
         delete m_pCommandPool;
 
         delete m_pDevice;